@@ -749,6 +749,7 @@ CBox*	CBoxVector::GetNext( CBox* pLast )
 ////////////////////////////////////////
 // Stream = Input stream
 // Return value = true:Success / false:Error
+// * Data is not loaded. Its position is recorded and it is skipped.
 bool	CDataBox::Read( CBaseStream& Stream )
 {
 	IMF_INT64	DataSize;
@@ -756,24 +757,57 @@ bool	CDataBox::Read( CBaseStream& Stream )
 	// Read basic fields.
 	if ( !CBox::Read( Stream ) ) return false;
 
-	// [LIMITATION] Data size must be less than 2GB.
 	DataSize = GetDataSize();
-	if ( ( DataSize < 0 ) || ( ( DataSize >> 32 ) != 0 ) ) { SetLastError( E_BOX_SIZE ); return false; }
+	if ( DataSize < 0 ) { SetLastError( E_BOX_SIZE ); return false; }
 
 	// Free data.
 	if ( m_data ) { delete[] m_data; m_data = NULL; }
 
-	if ( DataSize > 0 ) {
-		// Allocate buffer.
-		m_data = new IMF_UINT8 [ static_cast<IMF_UINT32>( DataSize ) ];
-		if ( m_data == NULL ) { SetLastError( E_MEMORY ); return false; }	// Memory error.
-		// Read data.
-		if ( Stream.Read( m_data, static_cast<IMF_UINT32>( DataSize ) ) != static_cast<IMF_UINT32>( DataSize ) ) { SetLastError( E_READ_STREAM ); return false; }
-	}
+	// Save data position and skip data.
+	if ( ( m_DataOffset = Stream.Tell() ) < 0 ) { SetLastError( E_TELL_STREAM ); return false; }
+	m_pSource = &Stream;
+	if ( !Stream.Seek( DataSize, CBaseStream::S_CURRENT ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+
 	if ( CheckReadSize( Stream ) != 0 ) { SetLastError( E_BOX_SIZE ); return false; }
 	return true;
 }
 
+////////////////////////////////////////
+//                                    //
+//           Read data range          //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset in data
+// pBuffer = Buffer to receive data
+// Size = Number of bytes to read
+// Return value = Number of bytes read
+// * The position of the source stream is restored.
+IMF_UINT32	CDataBox::ReadData( IMF_UINT64 Offset, void* pBuffer, IMF_UINT32 Size ) const
+{
+	IMF_INT64	DataSize;
+	IMF_INT64	CurPos;
+	IMF_UINT32	Result;
+
+	// Limit the range.
+	DataSize = GetDataSize();
+	if ( ( DataSize < 0 ) || ( Offset >= static_cast<IMF_UINT64>( DataSize ) ) ) return 0;
+	if ( Size > static_cast<IMF_UINT64>( DataSize ) - Offset ) Size = static_cast<IMF_UINT32>( static_cast<IMF_UINT64>( DataSize ) - Offset );
+
+	// Copy from memory.
+	if ( m_data ) {
+		memcpy( pBuffer, m_data + Offset, Size );
+		return Size;
+	}
+
+	// Read from the source stream.
+	if ( m_pSource == NULL ) return 0;
+	if ( ( CurPos = m_pSource->Tell() ) < 0 ) return 0;
+	if ( !m_pSource->Seek( m_DataOffset + static_cast<IMF_INT64>( Offset ), CBaseStream::S_BEGIN ) ) return 0;
+	Result = m_pSource->Read( pBuffer, Size );
+	if ( !m_pSource->Seek( CurPos, CBaseStream::S_BEGIN ) ) return 0;
+	return Result;
+}
+
 ////////////////////////////////////////
 //                                    //
 //               Write                //
@@ -781,21 +815,39 @@ bool	CDataBox::Read( CBaseStream& Stream )
 ////////////////////////////////////////
 // Stream = Output stream
 // Return value = true:Success / false:Error
+// * Data which is not loaded is copied from the source stream.
 bool	CDataBox::Write( CBaseStream& Stream ) const
 {
+	const IMF_UINT32	COPY_BUFSIZE = 65536;
 	IMF_INT64	DataSize;
+	IMF_UINT64	Offset;
+	IMF_UINT32	CopySize;
+	IMF_UINT8*	pBuffer;
+	bool		Result;
 
-	// [LIMITATION] Data size must be less than 2GB.
+	// [LIMITATION] Data size in memory must be less than 4GB.
 	DataSize = GetDataSize();
-	if ( ( DataSize < 0 ) || ( ( DataSize >> 32 ) != 0 ) ) return false;
+	if ( ( DataSize < 0 ) || ( m_data && ( ( DataSize >> 32 ) != 0 ) ) ) return false;
 
 	// Write basic fields.
 	if ( !CBox::Write( Stream ) ) return false;
 
 	if ( DataSize > 0 ) {
-		if ( m_data == NULL ) return false;
-		// Write data.
-		if ( Stream.Write( m_data, static_cast<IMF_UINT32>( DataSize ) ) != static_cast<IMF_UINT32>( DataSize ) ) return false;
+		if ( m_data ) {
+			// Write data.
+			if ( Stream.Write( m_data, static_cast<IMF_UINT32>( DataSize ) ) != static_cast<IMF_UINT32>( DataSize ) ) return false;
+		} else {
+			// Copy data from the source stream.
+			pBuffer = new IMF_UINT8 [ COPY_BUFSIZE ];
+			if ( pBuffer == NULL ) return false;
+			Result = true;
+			for( Offset=0; Result && ( Offset < static_cast<IMF_UINT64>( DataSize ) ); Offset += CopySize ) {
+				CopySize = ( static_cast<IMF_UINT64>( DataSize ) - Offset < COPY_BUFSIZE ) ? static_cast<IMF_UINT32>( DataSize - Offset ) : COPY_BUFSIZE;
+				Result = ( ReadData( Offset, pBuffer, CopySize ) == CopySize ) && ( Stream.Write( pBuffer, CopySize ) == CopySize );
+			}
+			delete[] pBuffer;
+			if ( !Result ) return false;
+		}
 	}
 	return true;
 }
@@ -301,15 +301,22 @@ namespace NAlsImf {
 	//                          CDataBox class                          //
 	//////////////////////////////////////////////////////////////////////
 	// Base class of boxes with binary data.
+	// Read() does not load the data. It only records the data position, so
+	// the source stream must be kept open while the data is accessed through
+	// ReadData(), Write() or Dump().
 	class	CDataBox : public CBox {
 	protected:
-		CDataBox( IMF_UINT32 type, const IMF_UINT8* usertype = NULL ) : CBox( type, usertype ), m_data( NULL ) {}
+		CDataBox( IMF_UINT32 type, const IMF_UINT8* usertype = NULL ) : CBox( type, usertype ), m_data( NULL ), m_pSource( NULL ), m_DataOffset( 0 ) {}
 	public:
 		virtual	~CDataBox( void ) { if ( m_data ) delete[] m_data; }
 		bool		Read( CBaseStream& Stream );
 		bool		Write( CBaseStream& Stream ) const;
+		IMF_UINT32	ReadData( IMF_UINT64 Offset, void* pBuffer, IMF_UINT32 Size ) const;
 	public:
-		IMF_UINT8*	m_data;
+		IMF_UINT8*		m_data;			// Data in memory (NULL: data is in m_pSource)
+	protected:
+		CBaseStream*	m_pSource;		// Stream to read the data from
+		IMF_INT64		m_DataOffset;	// Data position in m_pSource
 	};
 
 	//////////////////////////////////////////////////////////////////////
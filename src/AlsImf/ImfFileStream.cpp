@@ -48,6 +48,13 @@ Contents : File stream classes
 #include	<string>
 #include	"ImfFileStream.h"
 
+#if !defined( _MSC_VER )
+#include	<fcntl.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+#endif
+
 using namespace NAlsImf;
 
 //////////////////////////////////////////////////////////////////////
@@ -281,6 +288,212 @@ bool	CFileReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                        CMmapReader class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Open                //
+//                                    //
+////////////////////////////////////////
+// pFilename = File name to open.
+// Mode = MR_POPULATE:Read the whole file into memory at once
+// Return value = true:Success / false:Error
+// * Fails for files which are not regular files (e.g. pipes), empty
+//   files, and files which do not fit into the address space.
+bool	CMmapReader::Open( const char* pFilename, IMF_UINT32 Mode )
+{
+	// Check double open.
+	if ( m_pData != NULL ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+
+#if defined( _MSC_VER )
+	// Not supported, CFileReader is used instead.
+	SetLastError( E_OPEN_STREAM );
+	return false;
+#else
+	bool		Result = true;
+	struct stat	Stat;
+	void*		pData;
+	int			Flags = MAP_PRIVATE;
+	int			fd = -1;
+
+	try {
+		// Open a file.
+		fd = open( pFilename, O_RDONLY );
+		if ( fd == -1 ) throw E_OPEN_STREAM;
+
+		// Check file type and size.
+		if ( fstat( fd, &Stat ) != 0 ) throw E_OPEN_STREAM;
+		if ( !S_ISREG( Stat.st_mode ) || ( Stat.st_size <= 0 ) ) throw E_OPEN_STREAM;
+		if ( static_cast<IMF_UINT64>( Stat.st_size ) > static_cast<IMF_UINT64>( static_cast<size_t>( -1 ) ) ) throw E_OPEN_STREAM;
+
+		// Map the whole file.
+#if defined( MAP_POPULATE )
+		if ( Mode & MR_POPULATE ) Flags |= MAP_POPULATE;
+#endif
+		pData = mmap( NULL, static_cast<size_t>( Stat.st_size ), PROT_READ, Flags, fd, 0 );
+		if ( pData == MAP_FAILED ) throw E_OPEN_STREAM;
+		madvise( pData, static_cast<size_t>( Stat.st_size ), MADV_SEQUENTIAL );
+
+		m_pData = static_cast<const IMF_UINT8*>( pData );
+		m_Size = static_cast<IMF_INT64>( Stat.st_size );
+		m_Pos = m_Advised = 0;
+		Prefetch();
+	}
+	catch( IMF_UINT32 ErrCode ) {
+		SetLastError( ErrCode );
+		Result = false;
+	}
+
+	// The mapping stays valid without the file descriptor.
+	if ( fd != -1 ) close( fd );
+	return Result;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//               Close                //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMmapReader::Close( void )
+{
+	bool	Result = true;
+
+#if !defined( _MSC_VER )
+	if ( m_pData != NULL ) {
+		// Unmap the file.
+		if ( munmap( const_cast<IMF_UINT8*>( m_pData ), static_cast<size_t>( m_Size ) ) != 0 ) {
+			SetLastError( E_CLOSE_STREAM );
+			Result = false;
+		}
+	}
+#endif
+	m_pData = NULL;
+	m_Size = m_Pos = m_Advised = 0;
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Buffer to store read data
+// Size = Number of bytes to read
+// Return value = Actual read byte count
+IMF_UINT32	CMmapReader::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	// Copy data.
+	if ( m_Pos >= m_Size ) return 0;
+	if ( Size > m_Size - m_Pos ) Size = static_cast<IMF_UINT32>( m_Size - m_Pos );
+	memcpy( pBuffer, m_pData + m_Pos, Size );
+	m_Pos += Size;
+	Prefetch();
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Tell                //
+//                                    //
+////////////////////////////////////////
+// Return value = Current file position
+IMF_INT64	CMmapReader::Tell( void )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return -1;
+	}
+	return m_Pos;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset
+// Origin = Starting point
+// Return value = true:Success / false:Error
+// * Seeking beyond the end is allowed (as for files).
+bool	CMmapReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	// Set position.
+	if ( Origin == S_CURRENT ) Offset += m_Pos;
+	else if ( Origin == S_END ) Offset += m_Size;
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	m_Pos = Offset;
+	Prefetch();
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//              Prefetch              //
+//                                    //
+////////////////////////////////////////
+// * Asks the system to read the next few MB ahead of the current
+//   position in the background, so that page faults do not wait for
+//   the storage (e.g. on network file systems).
+void	CMmapReader::Prefetch( void )
+{
+#if !defined( _MSC_VER )
+	const IMF_INT64	Window = 8 << 20;
+	IMF_INT64		Start, End;
+
+	// Restart behind a backward seek, and advise in steps of Window / 2.
+	if ( m_Pos < m_Advised - Window ) m_Advised = m_Pos;
+	if ( ( m_Pos + Window / 2 < m_Advised ) || ( m_Advised >= m_Size ) ) return;
+
+	Start = ( m_Pos > m_Advised ) ? m_Pos : m_Advised;
+	Start -= Start % static_cast<IMF_INT64>( sysconf( _SC_PAGESIZE ) );
+	End = ( m_Pos + Window < m_Size ) ? m_Pos + Window : m_Size;
+	if ( End > Start ) madvise( const_cast<IMF_UINT8*>( m_pData ) + Start, static_cast<size_t>( End - Start ), MADV_WILLNEED );
+	m_Advised = End;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//                Peek                //
+//                                    //
+////////////////////////////////////////
+// Size = Receives the number of bytes from the current position to the
+//        end of file (up to 0xffffffff)
+// Return value = Pointer to the data at the current position (NULL at EOF)
+// * The position is not changed.
+const IMF_UINT8*	CMmapReader::Peek( IMF_UINT32& Size ) const
+{
+	Size = 0;
+	if ( ( m_pData == NULL ) || ( m_Pos >= m_Size ) ) return NULL;
+	Size = ( m_Size - m_Pos > 0xffffffff ) ? 0xffffffff : static_cast<IMF_UINT32>( m_Size - m_Pos );
+	return m_pData + m_Pos;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        CFileWriter class                         //
@@ -73,6 +73,33 @@ namespace NAlsImf {
 		IMF_INT64	m_Offset;		// Offset position
 	};
 
+	//////////////////////////////////////////////////////////////////////
+	//                                                                  //
+	//                        CMmapReader class                         //
+	//                                                                  //
+	//////////////////////////////////////////////////////////////////////
+	// Reads a regular file through a read-only memory mapping (not on
+	// Windows). The data can also be accessed in place by Peek().
+	class	CMmapReader : public CBaseStream {
+	public:
+		enum { MR_POPULATE = 1 };
+		CMmapReader( void ) : m_pData( NULL ), m_Size( 0 ), m_Pos( 0 ), m_Advised( 0 ) {}
+		virtual	~CMmapReader( void ) { Close(); }
+		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size );
+		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size ) { SetLastError( E_READONLY ); return 0; }
+		IMF_INT64	Tell( void );
+		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
+		bool		Open( const char* pFilename, IMF_UINT32 Mode = 0 );
+		bool		Close( void );
+		const IMF_UINT8*	Peek( IMF_UINT32& Size ) const;
+	protected:
+		void		Prefetch( void );
+		const IMF_UINT8*	m_pData;	// Mapped file data
+		IMF_INT64	m_Size;			// File size
+		IMF_INT64	m_Pos;			// Current position
+		IMF_INT64	m_Advised;		// End of the data which is being prefetched
+	};
+
 	//////////////////////////////////////////////////////////////////////
 	//                                                                  //
 	//                        CFileWriter class                         //
@@ -493,6 +493,7 @@ CMp4aWriter::CMp4aWriter( void )
 	memset( m_Language, '\0', sizeof(m_Language) );
 	m_pDecSpecInfo = NULL;
 	m_DecSpecInfoSize = 0;
+	m_PendingSize = 0;
 	m_Use64bit = false;
 	m_UseMeta = false;
 	m_MdatOffset = 0;
@@ -548,6 +549,7 @@ bool	CMp4aWriter::Open( CBaseStream& Stream, IMF_UINT32 Frequency, IMF_UINT16 Ch
 	m_Language[3] = '\0';
 	if ( !SetDecSpecInfo( pDecSpecInfo, DecSpecInfoSize ) ) return false;
 	m_FrameInfo.clear();
+	m_PendingSize = 0;
 	m_Use64bit = Use64bit;
 	m_FileType = FileType;
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
@@ -672,17 +674,52 @@ bool	CMp4aWriter::WriteAuxData( const void* pAuxData, IMF_UINT32 AuxDataSize )
 bool	CMp4aWriter::WriteFrame( const void* pFrame, IMF_UINT32 EncSize, IMF_UINT32 NumSamples, bool SyncFlag )
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+	if ( m_PendingSize != 0 ) { SetLastError( E_MP4A_PENDING_FRAME ); return false; }
 
-	if ( m_pStream->Write( pFrame, EncSize ) != EncSize ) { SetLastError( E_WRITE_STREAM ); return false; }
+	return WriteFrameData( pFrame, EncSize ) && EndFrame( NumSamples, SyncFlag );
+}
+
+////////////////////////////////////////
+//                                    //
+//      Write a part of a frame       //
+//                                    //
+////////////////////////////////////////
+// pData = Pointer to frame data
+// Size = Size of data in bytes
+// Return value = true:Success / false:Error
+// * A frame can be written in several parts, so that it does not have to
+//   be kept in memory. The frame is completed by EndFrame().
+bool	CMp4aWriter::WriteFrameData( const void* pData, IMF_UINT32 Size )
+{
+	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+
+	if ( m_PendingSize + Size > 0xffffffff ) { SetLastError( E_MP4A_FRAME_SIZE ); return false; }
+	if ( m_pStream->Write( pData, Size ) != Size ) { SetLastError( E_WRITE_STREAM ); return false; }
+	m_PendingSize += Size;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Complete a frame          //
+//                                    //
+////////////////////////////////////////
+// NumSamples = Number of samples
+// SyncFlag = true:Sync frame / false:Non-sync frame
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::EndFrame( IMF_UINT32 NumSamples, bool SyncFlag )
+{
+	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
 
 	// In the first frame, SyncFlag must be true.
 	if ( m_FrameInfo.empty() && !SyncFlag ) { SetLastError( E_MP4A_SYNC_FRAME ); return false; }
 
 	CFrameInfo	Info;
-	Info.m_EncSize = EncSize;
+	Info.m_EncSize = static_cast<IMF_UINT32>( m_PendingSize );
 	Info.m_NumSamples = NumSamples;
 	Info.m_SyncFlag = SyncFlag;
 	m_FrameInfo.push_back( Info );
+	m_PendingSize = 0;
 	return true;
 }
 
@@ -729,6 +766,9 @@ bool	CMp4aWriter::Close( void )
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
 
 	try {
+		// All frames must be completed.
+		if ( m_PendingSize != 0 ) throw E_MP4A_PENDING_FRAME;
+
 		// Calculate total size of mdat.
 		TotalSize = 0;
 		for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
@@ -790,6 +830,7 @@ bool	CMp4aWriter::Close( void )
 	if ( m_pDecSpecInfo ) { delete[] m_pDecSpecInfo; m_pDecSpecInfo = NULL; }
 	m_DecSpecInfoSize = 0;
 	m_FrameInfo.clear();
+	m_PendingSize = 0;
 
 	return Result;
 }
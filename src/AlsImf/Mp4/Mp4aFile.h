@@ -134,6 +134,8 @@ namespace NAlsImf {
 	const IMF_UINT32	E_MP4A_ILOC_EXTENT_DATA  = 1031;
 	const IMF_UINT32	E_MP4A_ILOC_EXTENT_SIZE  = 1032;
 	const IMF_UINT32	E_MP4A_OAFI              = 1033;
+	const IMF_UINT32	E_MP4A_FRAME_SIZE        = 1034;
+	const IMF_UINT32	E_MP4A_PENDING_FRAME     = 1035;
 
 	//////////////////////////////////////////////////////////////////////
 	//                                                                  //
@@ -211,6 +213,8 @@ namespace NAlsImf {
 		virtual	bool		WriteTrailer( const void* pTrailer, IMF_UINT32 TrailerSize );
 		virtual	bool		WriteAuxData( const void* pAuxData, IMF_UINT32 AuxDataSize );
 		virtual	bool		WriteFrame( const void* pFrame, IMF_UINT32 EncSize, IMF_UINT32 NumSamples, bool SyncFlag = true );
+		virtual	bool		WriteFrameData( const void* pData, IMF_UINT32 Size );
+		virtual	bool		EndFrame( IMF_UINT32 NumSamples, bool SyncFlag = true );
 		virtual	const void*	GetDecSpecInfo( void ) const { return m_pDecSpecInfo; }
 		virtual	IMF_UINT32	GetDecSpecInfoSize( void ) const { return m_DecSpecInfoSize; }
 		virtual	bool		SetDecSpecInfo( const void* pDecSpecInfo, IMF_UINT32 DecSpecInfoSize );
@@ -260,6 +264,7 @@ namespace NAlsImf {
 		char*					m_pDecSpecInfo;				// Decoder specific info
 		IMF_UINT32				m_DecSpecInfoSize;			// Number of bytes in decoder specific info
 		std::vector<CFrameInfo>	m_FrameInfo;				// Frame information
+		IMF_UINT64				m_PendingSize;				// Bytes written for the unfinished frame
 		bool					m_Use64bit;					// true:Use 64-bit / false:Use 32-bit
 		bool					m_UseMeta;					// true:Create meta box
 		IMF_INT64				m_MdatOffset;				// Offset position of mdat box
@@ -70,7 +70,10 @@ contents : Audio data I/O
 // - msbfirst indicates the original byte order of the audio samples
 // - b is an I/O buffer. Its minimum length is N*Channels*BytesPerSample
 //   (e.g. N*4 for 16-bit stereo)
-// - fp is the file pointer
+// - fp is the file pointer (if fp is NULL, the read functions take the data
+//   from b, and the write functions only fill b)
+// - crc (if not NULL) is updated with the CRC of the PCM bytes in b, which is
+//   calculated chunk by chunk while the data is converted
 // Notes:
 // - 8-bit : [0;255] <-> [-128;127]
 // - 24-bit: Packet format (3 bytes per sample)
@@ -80,258 +83,583 @@ contents : Audio data I/O
 
 #include <stdio.h>
 #include <math.h>
+#include <vector>
 #include "floating.h"
 #include "stream.h"
-
-long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp)
+#include "crc.h"
+
+// SIMD kernels (SSE2, and SSSE3/AVX2 if the CPU supports them) are used on x86-64
+#if defined(__x86_64__) || defined(_M_X64)
+#define AUDIORW_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AUDIORW_TARGET(t)
+#else
+#include <cpuid.h>
+#define AUDIORW_TARGET(t) __attribute__ ((target (t)))
+#endif
+#endif
+
+// Number of samples (all channels) converted per pass. The PCM bytes of a
+// pass are still in the cache for the CRC, and the interleaved samples of
+// a pass are kept in a buffer of this size on the stack.
+#define PCM_CHUNK 2048
+
+#ifdef	AUDIORW_SIMD
+#define CPU_SSSE3	0x01
+#define CPU_AVX2	0x02
+
+// Check the CPU (and OS support for AVX state)
+static unsigned int DetectCpu()
 {
-	unsigned char *bt;
-	long n, m;
-
-	bt = b;
-
-	fread(b, 1, N * M, fp);
-
-	for (n = 0; n < N; n++)
+	unsigned int info[4] = { 0, 0, 0, 0 }, info7[4] = { 0, 0, 0, 0 };
+	unsigned int f = 0;
+	bool avx = false;
+
+#ifdef _MSC_VER
+	__cpuid((int *)info, 0);
+	if (info[0] >= 7)
+		__cpuidex((int *)info7, 7, 0);
+	__cpuid((int *)info, 1);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
+		avx = ((_xgetbv(0) & 6) == 6);
+#else
+	if (__get_cpuid_max(0, NULL) >= 7)
+		__cpuid_count(7, 0, info7[0], info7[1], info7[2], info7[3]);
+	__get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
 	{
-		for (m = 0; m < M; m++)
-			x[m][n] = int(bt[m]) - 128;
-		
-		bt += M;
+		unsigned int lo, hi;
+		__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+		avx = ((lo & 6) == 6);
 	}
+#endif
 
-	return(0);
+	if (info[2] & (1 << 9))
+		f |= CPU_SSSE3;
+	if (avx && (info7[1] & (1 << 5)))
+		f |= CPU_AVX2;
+	return(f);
 }
 
-long Write8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp)
+// CPU features (checked once)
+static unsigned int CpuFeatures()
 {
-	unsigned char *bt;
-	long n, m;
+	static const unsigned int Features = DetectCpu();
+	return(Features);
+}
 
-	bt = b;
+// Shuffle masks for 24-bit samples: 4 samples (12 bytes) <-> 4 ints
+// Unpacked samples are in the upper 3 bytes (sign extended by a shift)
+static const signed char Unpack24[2][16] = {
+	{ -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 },		// LSB first
+	{ -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9 } };		// MSB first
+static const signed char Pack24[2][16] = {
+	{ 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 },
+	{ 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 } };
+
+// Swap the bytes of 16-bit values
+static inline __m128i Swap16(__m128i v)
+{
+	return(_mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+}
 
-	for (n = 0; n < N; n++)
-	{
-		for (m = 0; m < M; m++)
-			bt[m] = (unsigned char)(x[m][n] + 128);
+// Swap the bytes of 32-bit values
+static inline __m128i Swap32(__m128i v)
+{
+	v = Swap16(v);
+	return(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1));
+}
+
+// Unpack samples of 1, 2 or 4 bytes, returns the number of samples done
+static long UnpackSse2(int *y, const unsigned char *b, long K, short Bytes, short msbfirst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi32(128);
+	__m128i v, lo, hi;
+	long k = 0;
 
-		bt += M;
+	if (Bytes == 1)
+	{
+		for (; k + 16 <= K; k += 16)
+		{
+			v = _mm_loadu_si128((const __m128i *)(b + k));
+			lo = _mm_unpacklo_epi8(v, zero);
+			hi = _mm_unpackhi_epi8(v, zero);
+			_mm_storeu_si128((__m128i *)(y + k), _mm_sub_epi32(_mm_unpacklo_epi16(lo, zero), offset));
+			_mm_storeu_si128((__m128i *)(y + k + 4), _mm_sub_epi32(_mm_unpackhi_epi16(lo, zero), offset));
+			_mm_storeu_si128((__m128i *)(y + k + 8), _mm_sub_epi32(_mm_unpacklo_epi16(hi, zero), offset));
+			_mm_storeu_si128((__m128i *)(y + k + 12), _mm_sub_epi32(_mm_unpackhi_epi16(hi, zero), offset));
+		}
 	}
+	else if (Bytes == 2)
+	{
+		for (; k + 8 <= K; k += 8)
+		{
+			v = _mm_loadu_si128((const __m128i *)(b + 2 * k));
+			if (msbfirst)
+				v = Swap16(v);
+			_mm_storeu_si128((__m128i *)(y + k), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+			_mm_storeu_si128((__m128i *)(y + k + 4), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+		}
+	}
+	else if (Bytes == 4)
+	{
+		for (; k + 4 <= K; k += 4)
+		{
+			v = _mm_loadu_si128((const __m128i *)(b + 4 * k));
+			_mm_storeu_si128((__m128i *)(y + k), msbfirst ? Swap32(v) : v);
+		}
+	}
+	return(k);
+}
 
-	if (fp != NULL)
-		return(fwrite(b, 1, N * M, fp));
-	else
-		return(0);
+// Unpack 24-bit samples, returns the number of samples done
+AUDIORW_TARGET("ssse3") static long UnpackSsse3(int *y, const unsigned char *b, long K, short msbfirst)
+{
+	const __m128i mask = _mm_loadu_si128((const __m128i *)Unpack24[msbfirst ? 1 : 0]);
+	long k = 0;
+
+	// 16 bytes are loaded for 12
+	for (; k + 6 <= K; k += 4)
+		_mm_storeu_si128((__m128i *)(y + k), _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(b + 3 * k)), mask), 8));
+	return(k);
 }
 
-long Read16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+// Unpack samples of 2, 3 or 4 bytes, returns the number of samples done
+AUDIORW_TARGET("avx2") static long UnpackAvx2(int *y, const unsigned char *b, long K, short Bytes, short msbfirst)
 {
-	short c0, c1;
-	long r, n, m;
+	__m128i v;
+	__m256i w, mask;
+	long k = 0;
 
-	if (msbfirst)
+	if (Bytes == 2)
+	{
+		for (; k + 8 <= K; k += 8)
+		{
+			v = _mm_loadu_si128((const __m128i *)(b + 2 * k));
+			if (msbfirst)
+				v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			_mm256_storeu_si256((__m256i *)(y + k), _mm256_cvtepi16_epi32(v));
+		}
+	}
+	else if (Bytes == 3)
 	{
-		c0 = 1;
-		c1 = 0;
+		// 12 bytes of each 128-bit lane are used, 28 bytes are loaded for 24
+		v = _mm_loadu_si128((const __m128i *)Unpack24[msbfirst ? 1 : 0]);
+		mask = _mm256_inserti128_si256(_mm256_castsi128_si256(v), v, 1);
+		for (; k + 10 <= K; k += 8)
+		{
+			w = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(b + 3 * k))), _mm_loadu_si128((const __m128i *)(b + 3 * k + 12)), 1);
+			_mm256_storeu_si256((__m256i *)(y + k), _mm256_srai_epi32(_mm256_shuffle_epi8(w, mask), 8));
+		}
 	}
-	else
+	else if (Bytes == 4)
 	{
-		c0 = 0;
-		c1 = 1;
+		mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		for (; k + 8 <= K; k += 8)
+		{
+			w = _mm256_loadu_si256((const __m256i *)(b + 4 * k));
+			_mm256_storeu_si256((__m256i *)(y + k), msbfirst ? _mm256_shuffle_epi8(w, mask) : w);
+		}
 	}
+	return(k);
+}
 
-	r = fread(b, 1, 2 * N * M, fp);
+// Pack samples to 1, 2 or 4 bytes, returns the number of samples done
+static long PackSse2(unsigned char *b, const int *y, long K, short Bytes, short msbfirst)
+{
+	const __m128i byte = _mm_set1_epi32(0xFF);
+	const __m128i offset = _mm_set1_epi32(128);
+	__m128i v0, v1, v2, v3;
+	long k = 0;
 
-	for (n = 0; n < N; n++)
+	if (Bytes == 1)
 	{
-		for (m = 0; m < M; m++)
-			x[m][n] = short(b[2*m+c0] | (static_cast<unsigned short>(b[2*m+c1]) << 8));
-
-		b += 2 * M;
+		for (; k + 16 <= K; k += 16)
+		{
+			v0 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(y + k)), offset), byte);
+			v1 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(y + k + 4)), offset), byte);
+			v2 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(y + k + 8)), offset), byte);
+			v3 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(y + k + 12)), offset), byte);
+			_mm_storeu_si128((__m128i *)(b + k), _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+		}
 	}
-
-	return(r);
+	else if (Bytes == 2)
+	{
+		for (; k + 8 <= K; k += 8)
+		{
+			// Sign extension of the lower 16 bits makes the saturation a no-op
+			v0 = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(y + k)), 16), 16);
+			v1 = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(y + k + 4)), 16), 16);
+			v0 = _mm_packs_epi32(v0, v1);
+			_mm_storeu_si128((__m128i *)(b + 2 * k), msbfirst ? Swap16(v0) : v0);
+		}
+	}
+	else if (Bytes == 4)
+	{
+		for (; k + 4 <= K; k += 4)
+		{
+			v0 = _mm_loadu_si128((const __m128i *)(y + k));
+			_mm_storeu_si128((__m128i *)(b + 4 * k), msbfirst ? Swap32(v0) : v0);
+		}
+	}
+	return(k);
 }
 
-long Write16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+// Pack samples to 3 bytes, returns the number of samples done
+AUDIORW_TARGET("ssse3") static long PackSsse3(unsigned char *b, const int *y, long K, short msbfirst)
 {
-	unsigned char *bt;
-	short c0, c1;
-	long n, m;
+	const __m128i mask = _mm_loadu_si128((const __m128i *)Pack24[msbfirst ? 1 : 0]);
+	long k = 0;
+
+	// 16 bytes are stored for 12 (the rest is overwritten by the next samples)
+	for (; k + 6 <= K; k += 4)
+		_mm_storeu_si128((__m128i *)(b + 3 * k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(y + k)), mask));
+	return(k);
+}
 
-	bt = b;
+// Pack samples to 2 or 3 bytes, returns the number of samples done
+AUDIORW_TARGET("avx2") static long PackAvx2(unsigned char *b, const int *y, long K, short Bytes, short msbfirst)
+{
+	__m128i v;
+	__m256i w, mask;
+	long k = 0;
 
-	if (msbfirst)
+	if (Bytes == 2)
 	{
-		c0 = 1;
-		c1 = 0;
+		for (; k + 16 <= K; k += 16)
+		{
+			w = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(y + k)), 16), 16),
+								   _mm256_srai_epi32(_mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(y + k + 8)), 16), 16));
+			w = _mm256_permute4x64_epi64(w, 0xD8);		// packs works per 128-bit lane
+			if (msbfirst)
+				w = _mm256_or_si256(_mm256_slli_epi16(w, 8), _mm256_srli_epi16(w, 8));
+			_mm256_storeu_si256((__m256i *)(b + 2 * k), w);
+		}
 	}
-	else
+	else if (Bytes == 3)
 	{
-		c0 = 0;
-		c1 = 1;
+		v = _mm_loadu_si128((const __m128i *)Pack24[msbfirst ? 1 : 0]);
+		mask = _mm256_inserti128_si256(_mm256_castsi128_si256(v), v, 1);
+		for (; k + 10 <= K; k += 8)
+		{
+			w = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(y + k)), mask);
+			_mm_storeu_si128((__m128i *)(b + 3 * k), _mm256_castsi256_si128(w));
+			_mm_storeu_si128((__m128i *)(b + 3 * k + 12), _mm256_extracti128_si256(w, 1));
+		}
 	}
+	return(k);
+}
+#endif	// AUDIORW_SIMD
 
-	for (n = 0; n < N; n++)
+// Unpack K interleaved samples of 1 (with offset), 2, 3 or 4 bytes from b into y
+static void Unpack(int *y, const unsigned char *b, long K, short Bytes, short msbfirst)
+{
+	short c0, c1, c2, c3;
+	long k = 0;
+
+#ifdef	AUDIORW_SIMD
+	unsigned int f = CpuFeatures();
+	if ((f & CPU_AVX2) && (Bytes > 1))
+		k = UnpackAvx2(y, b, K, Bytes, msbfirst);
+	else if (Bytes == 3)
+		k = (f & CPU_SSSE3) ? UnpackSsse3(y, b, K, msbfirst) : 0;
+	else
+		k = UnpackSse2(y, b, K, Bytes, msbfirst);
+#endif
+
+	// Remaining samples
+	c0 = msbfirst ? Bytes - 1 : 0;
+	c1 = msbfirst ? Bytes - 2 : 1;
+	c2 = msbfirst ? Bytes - 3 : 2;
+	c3 = msbfirst ? Bytes - 4 : 3;
+	b += k * Bytes;
+	if (Bytes == 1)
 	{
-		for (m = 0; m < M; m++)
+		for (; k < K; k++, b++)
+			y[k] = int(b[0]) - 128;
+	}
+	else if (Bytes == 2)
+	{
+		for (; k < K; k++, b += 2)
+			y[k] = short(b[c0] | (static_cast<unsigned short>(b[c1]) << 8));
+	}
+	else if (Bytes == 3)
+	{
+		for (; k < K; k++, b += 3)
 		{
-			bt[2*m+c0] = x[m][n] & 0xFF;
-			bt[2*m+c1] = (x[m][n] >> 8) & 0xFF;
+			y[k] = b[c0] | (static_cast<unsigned int>(b[c1]) << 8) | (static_cast<unsigned int>(b[c2]) << 16);
+			if (y[k] & 0x00800000)
+				y[k] = (y[k] | 0xFF000000);
 		}
-
-		bt += 2 * M;
 	}
-
-	if (fp != NULL)
-		return(fwrite(b, 1, 2 * N * M, fp));
 	else
-		return(0);
+	{
+		for (; k < K; k++, b += 4)
+			y[k] = b[c0] | (static_cast<unsigned int>(b[c1]) << 8) | (static_cast<unsigned int>(b[c2]) << 16) | (static_cast<unsigned int>(b[c3]) << 24);
+	}
+}
 
+// Pack K interleaved samples from y into b (1 byte with offset, 2, 3 or 4 bytes)
+static void Pack(unsigned char *b, const int *y, long K, short Bytes, short msbfirst)
+{
+	short c0, c1, c2, c3;
+	long k = 0;
+
+#ifdef	AUDIORW_SIMD
+	unsigned int f = CpuFeatures();
+	if ((f & CPU_AVX2) && ((Bytes == 2) || (Bytes == 3)))
+		k = PackAvx2(b, y, K, Bytes, msbfirst);
+	else if (Bytes == 3)
+		k = (f & CPU_SSSE3) ? PackSsse3(b, y, K, msbfirst) : 0;
+	else
+		k = PackSse2(b, y, K, Bytes, msbfirst);
+#endif
+
+	// Remaining samples
+	c0 = msbfirst ? Bytes - 1 : 0;
+	c1 = msbfirst ? Bytes - 2 : 1;
+	c2 = msbfirst ? Bytes - 3 : 2;
+	c3 = msbfirst ? Bytes - 4 : 3;
+	b += k * Bytes;
+	for (; k < K; k++, b += Bytes)
+	{
+		if (Bytes == 1)
+			b[0] = (unsigned char)(y[k] + 128);
+		else
+		{
+			b[c0] = y[k] & 0xFF;
+			b[c1] = (y[k] >> 8) & 0xFF;
+			if (Bytes > 2)
+				b[c2] = (y[k] >> 16) & 0xFF;
+			if (Bytes > 3)
+				b[c3] = (y[k] >> 24) & 0xFF;
+		}
+	}
 }
 
-long Read24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+// Distribute F frames of M interleaved samples in y to x[m][n...n+F-1]
+static void Deinterleave(int **x, long n, long M, long F, const int *y)
 {
-	short c0, c1, c2;
-	long r, n, m;
+	long f = 0, m;
 
-	if (msbfirst)
+#ifdef	AUDIORW_SIMD
+	// Pairs of channels (stereo, 5.1, 7.1, ...), 4 frames at once
+	if ((M & 1) == 0)
 	{
-		c0 = 2;
-		c1 = 1;
-		c2 = 0;
+		__m128i v0, v1;
+		for (m = 0; m < M; m += 2)
+		{
+			int *x0 = x[m] + n, *x1 = x[m+1] + n;
+			const int *p = y + m;
+			for (f = 0; f + 4 <= F; f += 4, p += 4 * M)
+			{
+				v0 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)p), _mm_loadl_epi64((const __m128i *)(p + M)));
+				v1 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(p + 2 * M)), _mm_loadl_epi64((const __m128i *)(p + 3 * M)));
+				v0 = _mm_shuffle_epi32(v0, 0xD8);		// 0 2 1 3
+				v1 = _mm_shuffle_epi32(v1, 0xD8);
+				_mm_storeu_si128((__m128i *)(x0 + f), _mm_unpacklo_epi64(v0, v1));
+				_mm_storeu_si128((__m128i *)(x1 + f), _mm_unpackhi_epi64(v0, v1));
+			}
+		}
 	}
-	else
+#endif
+
+	// Remaining frames
+	for (; f < F; f++)
 	{
-		c0 = 0;
-		c1 = 1;
-		c2 = 2;
+		for (m = 0; m < M; m++)
+			x[m][n+f] = y[f*M+m];
 	}
+}
 
-	r = fread(b, 1, 3 * N * M, fp);
+// Collect F frames of M samples from x[m][n...n+F-1] into y (interleaved)
+static void Interleave(int *y, int **x, long n, long M, long F)
+{
+	long f = 0, m;
 
-	for (n = 0; n < N; n++)
+#ifdef	AUDIORW_SIMD
+	// Pairs of channels (stereo, 5.1, 7.1, ...), 4 frames at once
+	if ((M & 1) == 0)
 	{
-		for (m = 0; m < M; m++)
+		__m128i v0, v1, lo, hi;
+		for (m = 0; m < M; m += 2)
 		{
-			x[m][n] = b[3*m+c0] | (static_cast<unsigned int>(b[3*m+c1]) << 8) | (static_cast<unsigned int>(b[3*m+c2]) << 16);
-			if (x[m][n] & 0x00800000)
-				x[m][n] = (x[m][n] | 0xFF000000);
+			const int *x0 = x[m] + n, *x1 = x[m+1] + n;
+			int *p = y + m;
+			for (f = 0; f + 4 <= F; f += 4, p += 4 * M)
+			{
+				v0 = _mm_loadu_si128((const __m128i *)(x0 + f));
+				v1 = _mm_loadu_si128((const __m128i *)(x1 + f));
+				lo = _mm_unpacklo_epi32(v0, v1);
+				hi = _mm_unpackhi_epi32(v0, v1);
+				_mm_storel_epi64((__m128i *)p, lo);
+				_mm_storel_epi64((__m128i *)(p + M), _mm_unpackhi_epi64(lo, lo));
+				_mm_storel_epi64((__m128i *)(p + 2 * M), hi);
+				_mm_storel_epi64((__m128i *)(p + 3 * M), _mm_unpackhi_epi64(hi, hi));
+			}
 		}
-
-		b += 3 * M;
 	}
+#endif
 
-	return(r);
+	// Remaining frames
+	for (; f < F; f++)
+	{
+		for (m = 0; m < M; m++)
+			y[f*M+m] = x[m][n+f];
+	}
 }
 
-long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+// Convert N frames of M channels (Bytes per sample) from b to x, and update the CRC
+static void ReadPcm(int **x, long M, long N, const unsigned char *b, short Bytes, short msbfirst, unsigned int *crc)
 {
-	unsigned char *bt;
-	short c0, c1, c2;
-	long n, m;
+	int Chunk[PCM_CHUNK];
+	std::vector<int> Frame;
+	int *y = Chunk;
+	long F = PCM_CHUNK / M, n, Fn;
 
-	bt = b;
+	if (F == 0)		// very many channels
+	{
+		Frame.resize(M);
+		y = &Frame[0];
+		F = 1;
+	}
 
-	if (msbfirst)
+	for (n = 0; n < N; n += Fn)
 	{
-		c0 = 2;
-		c1 = 1;
-		c2 = 0;
+		Fn = (N - n < F) ? N - n : F;
+		if (M == 1)
+			Unpack(x[0] + n, b, Fn, Bytes, msbfirst);
+		else
+		{
+			Unpack(y, b, Fn * M, Bytes, msbfirst);
+			Deinterleave(x, n, M, Fn, y);
+		}
+		if (crc != NULL)
+			*crc = CalculateBlockCRC32(Fn * M * Bytes, *crc, (void*)b);
+		b += Fn * M * Bytes;
 	}
-	else
+}
+
+// Convert N frames of M channels from x to b (Bytes per sample), and update the CRC
+static void WritePcm(int **x, long M, long N, unsigned char *b, short Bytes, short msbfirst, unsigned int *crc)
+{
+	int Chunk[PCM_CHUNK];
+	std::vector<int> Frame;
+	int *y = Chunk;
+	long F = PCM_CHUNK / M, n, Fn;
+
+	if (F == 0)		// very many channels
 	{
-		c0 = 0;
-		c1 = 1;
-		c2 = 2;
+		Frame.resize(M);
+		y = &Frame[0];
+		F = 1;
 	}
 
-	for (n = 0; n < N; n++)
+	for (n = 0; n < N; n += Fn)
 	{
-		for (m = 0; m < M; m++)
+		Fn = (N - n < F) ? N - n : F;
+		if (M == 1)
+			Pack(b, x[0] + n, Fn, Bytes, msbfirst);
+		else
 		{
-			bt[3*m+c0] = x[m][n] & 0xFF;
-			bt[3*m+c1] = (x[m][n] >> 8) & 0xFF;
-			bt[3*m+c2] = (x[m][n] >> 16) & 0xFF;
+			Interleave(y, x, n, M, Fn);
+			Pack(b, y, Fn * M, Bytes, msbfirst);
 		}
-
-		bt += 3 * M;
+		if (crc != NULL)
+			*crc = CalculateBlockCRC32(Fn * M * Bytes, *crc, (void*)b);
+		b += Fn * M * Bytes;
 	}
+}
 
+long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
 	if (fp != NULL)
-		return(fwrite(b, 1, 3 * N * M, fp));
+		fread(b, 1, N * M, fp);
+
+	ReadPcm(x, M, N, b, 1, 0, crc);
+
+	return(0);
+}
+
+long Write8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	WritePcm(x, M, N, b, 1, 0, crc);
+
+	if (fp != NULL)
+		return(fwrite(b, 1, N * M, fp));
 	else
 		return(0);
 }
 
-long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+long Read16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
 {
-	short c0, c1, c2, c3;
-	long r, n, m;
+	long r;
 
-	if (msbfirst)
-	{
-		c0 = 3;
-		c1 = 2;
-		c2 = 1;
-		c3 = 0;
-	}
+	if (fp != NULL)
+		r = fread(b, 1, 2 * N * M, fp);
 	else
-	{
-		c0 = 0;
-		c1 = 1;
-		c2 = 2;
-		c3 = 3;
-	}
+		r = 2 * N * M;
 
-	r = fread(b, 1, 4 * N * M, fp);
+	ReadPcm(x, M, N, b, 2, msbfirst, crc);
 
-	for (n = 0; n < N; n++)
-	{
-		for (m = 0; m < M; m++)
-			x[m][n] = b[4*m+c0] | (static_cast<unsigned int>(b[4*m+c1]) << 8) | (static_cast<unsigned int>(b[4*m+c2]) << 16) | (static_cast<unsigned int>(b[4*m+c3]) << 24);
+	return(r);
+}
 
-		b += 4 * M;
-	}
+long Write16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	WritePcm(x, M, N, b, 2, msbfirst, crc);
+
+	if (fp != NULL)
+		return(fwrite(b, 1, 2 * N * M, fp));
+	else
+		return(0);
+
+}
+
+long Read24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	long r;
+
+	if (fp != NULL)
+		r = fread(b, 1, 3 * N * M, fp);
+	else
+		r = 3 * N * M;
+
+	ReadPcm(x, M, N, b, 3, msbfirst, crc);
 
 	return(r);
 }
 
-long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp)
+long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
 {
-	unsigned char *bt;
-	short c0, c1, c2, c3;
-	long n, m;
+	WritePcm(x, M, N, b, 3, msbfirst, crc);
+
+	if (fp != NULL)
+		return(fwrite(b, 1, 3 * N * M, fp));
+	else
+		return(0);
+}
 
-	bt = b;
+long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	long r;
 
-	if (msbfirst)
-	{
-		c0 = 3;
-		c1 = 2;
-		c2 = 1;
-		c3 = 0;
-	}
+	if (fp != NULL)
+		r = fread(b, 1, 4 * N * M, fp);
 	else
-	{
-		c0 = 0;
-		c1 = 1;
-		c2 = 2;
-		c3 = 3;
-	}
+		r = 4 * N * M;
 
-	for (n = 0; n < N; n++)
-	{
-		for (m = 0; m < M; m++)
-		{
-			bt[4*m+c0] = x[m][n] & 0xFF;
-			bt[4*m+c1] = (x[m][n] >> 8) & 0xFF;
-			bt[4*m+c2] = (x[m][n] >> 16) & 0xFF;
-			bt[4*m+c3] = (x[m][n] >> 24) & 0xFF;
-		}
+	ReadPcm(x, M, N, b, 4, msbfirst, crc);
 
-		bt += 4 * M;
-	}
+	return(r);
+}
+
+long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	WritePcm(x, M, N, b, 4, msbfirst, crc);
 
 	if (fp != NULL)
 		return(fwrite(b, 1, 4 * N * M, fp));
@@ -339,38 +667,16 @@ long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HAL
 		return(0);
 }
 
-long	ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char* b, HALSSTREAM fp, float** ppFloatBuf )
+long	ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char* b, HALSSTREAM fp, float** ppFloatBuf, unsigned int *crc )
 {
-	long	iSample, iChannel;
-	unsigned long	ul;
-	short	c0, c1, c2, c3;
-
-	if ( msbfirst ) {
-		c0 = 3;
-		c1 = 2;
-		c2 = 1;
-		c3 = 0;
-	} else {
-		c0 = 0;
-		c1 = 1;
-		c2 = 2;
-		c3 = 3;
-	}
-
 	// Read samples from pStream
-	if ( fread( b, 1, M * N * sizeof(float), fp ) != M * N * sizeof(float) ) {
+	if ( ( fp != NULL ) && ( fread( b, 1, M * N * sizeof(float), fp ) != M * N * sizeof(float) ) ) {
 		// Read error
 		return 0;
 	}
 
-	// Convert raw data to long/float array
-	for( iSample=0; iSample<N; iSample++ ) {
-		for( iChannel=0; iChannel<M; iChannel++ ) {
-			ul = b[4*iChannel+c0] | ( static_cast<unsigned int>(b[4*iChannel+c1]) << 8 ) | ( static_cast<unsigned int>(b[4*iChannel+c2]) << 16 ) | ( static_cast<unsigned int>(b[4*iChannel+c3]) << 24 );
-			// ul shold be copied as unsigned int. (it may lost some bits when copied as float.)
-			*reinterpret_cast<unsigned int*>( &ppFloatBuf[iChannel][iSample] ) = ul;
-		}
-		b += sizeof(float) * M;
-	}
+	// Convert raw data to float array
+	// Samples are copied as unsigned int. (they may lose some bits when copied as float.)
+	ReadPcm( reinterpret_cast<int**>( ppFloatBuf ), M, N, b, sizeof(float), msbfirst, crc );
 	return 0;
 }
@@ -53,12 +53,12 @@ contents : Header file for audiorw.cpp
 
 #include	"stream.h"
 
-long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp);
-long Write8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp);
-long Read16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long Write16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long Read24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
-long ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char* b, HALSSTREAM fp, float** ppFloatBuf );
+long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Write8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Read16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Write16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Read24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+long ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char* b, HALSSTREAM fp, float** ppFloatBuf, unsigned int *crc = NULL );
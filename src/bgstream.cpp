@@ -0,0 +1,404 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : bgstream.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : Read-ahead and write-behind streams with an I/O thread
+
+*************************************************************************/
+
+#include <string.h>
+#include "bgstream.h"
+
+using namespace NAlsImf;
+
+//////////////////////////////////////////////////////////////////////
+//                        CBackgroundStream                         //
+//////////////////////////////////////////////////////////////////////
+
+// Allocate slots and start Main() (returns false on failure)
+bool CBackgroundStream::Start()
+{
+	long	i;
+
+	m_Head = m_Queued = 0;
+	m_Quit = m_Error = false;
+	try {
+		for( i=0; i<BG_SLOTS; i++ ) {
+			m_Slots[i].m_Data.resize( BG_BLOCK_SIZE );
+			m_Slots[i].m_Start = 0;
+			m_Slots[i].m_Len = 0;
+		}
+		m_Thread = std::thread( &CBackgroundStream::Main, this );
+	}
+	catch( ... ) {
+		for( i=0; i<BG_SLOTS; i++ ) std::vector<unsigned char>().swap( m_Slots[i].m_Data );
+		return false;
+	}
+	return true;
+}
+
+// Join the thread
+void CBackgroundStream::Stop()
+{
+	{
+		std::lock_guard<std::mutex> Lock( m_Mutex );
+		m_Quit = true;
+	}
+	m_Cond.notify_all();
+	if ( m_Thread.joinable() ) m_Thread.join();
+	for( long i=0; i<BG_SLOTS; i++ ) std::vector<unsigned char>().swap( m_Slots[i].m_Data );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                         CReadAheadStream                         //
+//////////////////////////////////////////////////////////////////////
+
+// Start reading pStream from its current position
+bool CReadAheadStream::Open( CBaseStream* pStream )
+{
+	if ( ( pStream == NULL ) || ( m_pStream != NULL ) ) return false;
+
+	// The size is used for seeks relative to the end
+	m_ReadPos = m_Pos = pStream->Tell();
+	if ( m_Pos < 0 ) return false;
+	m_Size = -1;
+	if ( pStream->Seek( 0, S_END ) ) {
+		m_Size = pStream->Tell();
+		if ( !pStream->Seek( m_Pos, S_BEGIN ) ) return false;
+	}
+
+	m_pStream = pStream;
+	m_Offset = 0;
+	m_Eof = m_Hold = m_Reading = false;
+	if ( !Start() ) {
+		m_pStream = NULL;
+		return false;
+	}
+	return true;
+}
+
+// Stop reading (the underlying stream is at an undefined position)
+bool CReadAheadStream::Close()
+{
+	if ( m_pStream == NULL ) return true;
+	Stop();
+	m_pStream = NULL;
+	return true;
+}
+
+// Read data
+IMF_UINT32 CReadAheadStream::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	unsigned char*	p = static_cast<unsigned char*>( pBuffer );
+	IMF_UINT32		Done = 0, n;
+	SLOT*			pSlot;
+
+	if ( m_pStream == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	while( Done < Size ) {
+		while( ( m_Queued == 0 ) && !m_Eof ) m_Cond.wait( Lock );
+		if ( m_Queued == 0 ) break;
+
+		// Queued slots are not touched by the thread
+		pSlot = &m_Slots[m_Head];
+		n = pSlot->m_Len - m_Offset;
+		if ( n > Size - Done ) n = Size - Done;
+		Lock.unlock();
+		memcpy( p + Done, &pSlot->m_Data[m_Offset], n );
+		Lock.lock();
+		Done += n;
+		m_Offset += n;
+		if ( m_Offset == pSlot->m_Len ) {
+			m_Head = ( m_Head + 1 ) % BG_SLOTS;
+			m_Queued--;
+			m_Offset = 0;
+			m_Cond.notify_all();
+		}
+	}
+	m_Pos += Done;
+	return Done;
+}
+
+// Set position (in memory if the target has already been read)
+bool CReadAheadStream::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	bool	Result;
+
+	if ( m_pStream == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	if ( Origin == S_CURRENT ) Offset += m_Pos;
+	else if ( Origin == S_END ) {
+		if ( m_Size < 0 ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+		Offset += m_Size;
+	}
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	if ( ( Offset <= m_ReadPos ) && ( ( m_Queued > 0 ) ? ( Offset >= m_Slots[m_Head].m_Start ) : ( Offset == m_ReadPos ) ) ) {
+		// Skip buffered data
+		while( ( m_Queued > 0 ) && ( Offset >= m_Slots[m_Head].m_Start + m_Slots[m_Head].m_Len ) ) {
+			m_Head = ( m_Head + 1 ) % BG_SLOTS;
+			m_Queued--;
+		}
+		m_Offset = ( m_Queued > 0 ) ? static_cast<IMF_UINT32>( Offset - m_Slots[m_Head].m_Start ) : 0;
+		m_Pos = Offset;
+		m_Cond.notify_all();
+		return true;
+	}
+
+	// Discard buffered data and move the underlying stream
+	m_Hold = true;
+	while( m_Reading ) m_Cond.wait( Lock );
+	m_Head = m_Queued = 0;
+	m_Offset = 0;
+	m_Eof = m_Error = false;
+	Lock.unlock();
+	Result = m_pStream->Seek( Offset, S_BEGIN );
+	if ( Result ) m_Pos = Offset;
+	else {
+		SetLastError( E_SEEK_STREAM );
+		m_pStream->Seek( m_Pos, S_BEGIN );
+	}
+	Lock.lock();
+	m_ReadPos = m_Pos;
+	m_Hold = false;
+	m_Cond.notify_all();
+	return Result;
+}
+
+// Thread main loop: fill free slots
+void CReadAheadStream::Main()
+{
+	SLOT*	pSlot;
+	IMF_UINT32	n;
+
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	for( ;; ) {
+		while( !m_Quit && ( m_Hold || m_Eof || ( m_Queued == BG_SLOTS ) ) ) m_Cond.wait( Lock );
+		if ( m_Quit ) return;
+
+		pSlot = &m_Slots[( m_Head + m_Queued ) % BG_SLOTS];
+		pSlot->m_Start = m_ReadPos;
+		m_Reading = true;
+		Lock.unlock();
+		n = m_pStream->Read( &pSlot->m_Data[0], BG_BLOCK_SIZE );
+		Lock.lock();
+		m_Reading = false;
+
+		// A short read is the end of the stream (or an error)
+		if ( n < BG_BLOCK_SIZE ) m_Eof = true;
+		if ( n > 0 ) {
+			pSlot->m_Len = n;
+			m_ReadPos += n;
+			m_Queued++;
+		}
+		m_Cond.notify_all();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//                        CWriteBehindStream                        //
+//////////////////////////////////////////////////////////////////////
+
+// Start writing to pStream at its current position
+bool CWriteBehindStream::Open( CBaseStream* pStream )
+{
+	IMF_INT64	Pos;
+
+	if ( ( pStream == NULL ) || ( m_pStream != NULL ) ) return false;
+	if ( ( Pos = pStream->Tell() ) < 0 ) return false;
+
+	m_pStream = pStream;
+	m_StreamPos = Pos;
+	if ( !Start() ) {
+		m_pStream = NULL;
+		return false;
+	}
+	m_Fill = 0;
+	m_Cursor = 0;
+	m_Slots[m_Fill].m_Start = Pos;
+	return true;
+}
+
+// Flush and stop (the underlying stream is left at the current position)
+bool CWriteBehindStream::Close()
+{
+	bool	Result;
+
+	if ( m_pStream == NULL ) return true;
+	Result = Flush();
+	Stop();
+	if ( Result && !m_pStream->Seek( Tell(), S_BEGIN ) ) Result = false;
+	m_pStream = NULL;
+	return Result;
+}
+
+// Wait until all data has been written (returns false after write errors)
+bool CWriteBehindStream::Flush()
+{
+	if ( m_pStream == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+	if ( !Submit( Tell() ) ) return false;
+
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	while( m_Queued > 0 ) m_Cond.wait( Lock );
+	if ( m_Error ) {
+		SetLastError( E_WRITE_STREAM );
+		return false;
+	}
+	return true;
+}
+
+// Queue the fill slot (if it has data) and continue writing at Next
+bool CWriteBehindStream::Submit( IMF_INT64 Next )
+{
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	if ( m_Slots[m_Fill].m_Len > 0 ) {
+		while( m_Queued == BG_SLOTS - 1 ) m_Cond.wait( Lock );
+		m_Queued++;
+		m_Fill = ( m_Head + m_Queued ) % BG_SLOTS;
+		m_Cond.notify_all();
+	}
+	m_Slots[m_Fill].m_Start = Next;
+	m_Slots[m_Fill].m_Len = 0;
+	m_Cursor = 0;
+	if ( m_Error ) {
+		SetLastError( E_WRITE_STREAM );
+		return false;
+	}
+	return true;
+}
+
+// Write data
+IMF_UINT32 CWriteBehindStream::Write( const void* pBuffer, IMF_UINT32 Size )
+{
+	const unsigned char*	p = static_cast<const unsigned char*>( pBuffer );
+	IMF_UINT32	Done = 0, n;
+	SLOT*		pSlot;
+
+	if ( m_pStream == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	while( Done < Size ) {
+		pSlot = &m_Slots[m_Fill];
+		if ( m_Cursor == BG_BLOCK_SIZE ) {
+			if ( !Submit( pSlot->m_Start + m_Cursor ) ) break;
+			continue;
+		}
+		n = BG_BLOCK_SIZE - m_Cursor;
+		if ( n > Size - Done ) n = Size - Done;
+		memcpy( &pSlot->m_Data[m_Cursor], p + Done, n );
+		Done += n;
+		m_Cursor += n;
+		if ( pSlot->m_Len < m_Cursor ) pSlot->m_Len = m_Cursor;
+	}
+	return Done;
+}
+
+// Set position (in memory if the target is inside the fill slot)
+bool CWriteBehindStream::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	SLOT*	pSlot;
+
+	if ( m_pStream == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	if ( Origin == S_END ) {
+		// The size is only known when everything has been written
+		if ( !Flush() ) return false;
+		bool Ok = m_pStream->Seek( Offset, S_END ) && ( ( Offset = m_pStream->Tell() ) >= 0 );
+		{
+			std::lock_guard<std::mutex> Lock( m_Mutex );
+			m_StreamPos = Ok ? Offset : -1;
+		}
+		if ( !Ok ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+	}
+	else if ( Origin == S_CURRENT ) Offset += Tell();
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+
+	pSlot = &m_Slots[m_Fill];
+	if ( ( Offset >= pSlot->m_Start ) && ( Offset <= pSlot->m_Start + pSlot->m_Len ) ) {
+		m_Cursor = static_cast<IMF_UINT32>( Offset - pSlot->m_Start );
+		return true;
+	}
+	return Submit( Offset );
+}
+
+// Thread main loop: write queued slots
+void CWriteBehindStream::Main()
+{
+	SLOT*	pSlot;
+	bool	Ok;
+
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	for( ;; ) {
+		while( !m_Quit && ( m_Queued == 0 ) ) m_Cond.wait( Lock );
+		if ( m_Queued == 0 ) return;
+
+		pSlot = &m_Slots[m_Head];
+		Ok = ( pSlot->m_Start == m_StreamPos );
+		Lock.unlock();
+		if ( !Ok ) Ok = m_pStream->Seek( pSlot->m_Start, S_BEGIN );
+		if ( Ok ) Ok = ( m_pStream->Write( &pSlot->m_Data[0], pSlot->m_Len ) == pSlot->m_Len );
+		Lock.lock();
+
+		m_StreamPos = Ok ? pSlot->m_Start + pSlot->m_Len : -1;
+		if ( !Ok ) m_Error = true;
+		m_Head = ( m_Head + 1 ) % BG_SLOTS;
+		m_Queued--;
+		m_Cond.notify_all();
+	}
+}
+
+// End of bgstream.cpp
@@ -0,0 +1,128 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : bgstream.h
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : Header file for bgstream.cpp
+
+*************************************************************************/
+
+#ifndef	BGSTREAM_INCLUDED
+#define	BGSTREAM_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ImfStream.h"
+
+// Ring of fixed size blocks shared by a stream and its I/O thread.
+// Slots [m_Head, m_Head+m_Queued) (modulo BG_SLOTS) are handed over
+// from the producer to the consumer side.
+class CBackgroundStream : public NAlsImf::CBaseStream
+{
+public:
+	enum { BG_SLOTS = 4, BG_BLOCK_SIZE = 1 << 20 };
+
+	CBackgroundStream() : m_pStream( NULL ), m_Head( 0 ), m_Queued( 0 ), m_Quit( false ), m_Error( false ) {}
+
+protected:
+	struct SLOT {
+		std::vector<unsigned char> m_Data;	// BG_BLOCK_SIZE bytes
+		NAlsImf::IMF_INT64 m_Start;			// Stream position of m_Data[0]
+		NAlsImf::IMF_UINT32 m_Len;			// Number of valid bytes
+	};
+
+	bool Start();					// Allocate slots and start Main()
+	void Stop();					// Join the thread
+	virtual void Main() = 0;		// Thread main loop
+
+	NAlsImf::CBaseStream* m_pStream;	// Underlying stream
+	SLOT m_Slots[BG_SLOTS];
+	long m_Head;					// First queued slot
+	long m_Queued;					// Number of queued slots
+	bool m_Quit;					// true:Thread has to finish
+	bool m_Error;					// true:I/O error in the thread
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Cond;	// Signalled on every state change
+};
+
+// Reads the underlying stream ahead on a background thread.
+// Seeks within the buffered data are served from memory.
+class CReadAheadStream : public CBackgroundStream
+{
+public:
+	CReadAheadStream() : m_Pos( 0 ), m_ReadPos( 0 ), m_Size( -1 ), m_Offset( 0 ), m_Eof( false ), m_Hold( false ), m_Reading( false ) {}
+	~CReadAheadStream() { Close(); }
+
+	bool Open( NAlsImf::CBaseStream* pStream );	// Start reading pStream
+	bool Close();								// Stop reading (pStream stays open)
+	NAlsImf::IMF_UINT32 Read( void* pBuffer, NAlsImf::IMF_UINT32 Size );
+	NAlsImf::IMF_UINT32 Write( const void* pBuffer, NAlsImf::IMF_UINT32 Size ) { SetLastError( NAlsImf::E_READONLY ); return 0; }
+	NAlsImf::IMF_INT64 Tell() { return m_Pos; }
+	bool Seek( NAlsImf::IMF_INT64 Offset, SEEK_ORIGIN Origin );
+
+protected:
+	void Main();
+
+	NAlsImf::IMF_INT64 m_Pos;		// Current position
+	NAlsImf::IMF_INT64 m_ReadPos;	// Position of the next block read by the thread
+	NAlsImf::IMF_INT64 m_Size;		// Stream size (-1:unknown, e.g. pipe)
+	NAlsImf::IMF_UINT32 m_Offset;	// Read position in m_Slots[m_Head]
+	bool m_Eof;						// true:Thread has reached the end of the stream
+	bool m_Hold;					// true:Thread must not access m_pStream
+	bool m_Reading;					// true:Thread is reading from m_pStream
+};
+
+// Writes to the underlying stream on a background thread.
+// Write errors are reported by later Write(), Seek() and Flush() calls.
+class CWriteBehindStream : public CBackgroundStream
+{
+public:
+	CWriteBehindStream() : m_Fill( 0 ), m_Cursor( 0 ), m_StreamPos( -1 ) {}
+	~CWriteBehindStream() { Close(); }
+
+	bool Open( NAlsImf::CBaseStream* pStream );	// Start writing to pStream
+	bool Close();								// Flush and stop (pStream stays open)
+	bool Flush();								// Wait until all data has been written
+	NAlsImf::IMF_UINT32 Read( void* pBuffer, NAlsImf::IMF_UINT32 Size ) { SetLastError( NAlsImf::E_WRITEONLY ); return 0; }
+	NAlsImf::IMF_UINT32 Write( const void* pBuffer, NAlsImf::IMF_UINT32 Size );
+	NAlsImf::IMF_INT64 Tell() { return m_Slots[m_Fill].m_Start + m_Cursor; }
+	bool Seek( NAlsImf::IMF_INT64 Offset, SEEK_ORIGIN Origin );
+
+protected:
+	void Main();
+	bool Submit( NAlsImf::IMF_INT64 Next );		// Queue the fill slot, continue at Next
+
+	long m_Fill;					// Slot which is filled by Write() (never queued)
+	NAlsImf::IMF_UINT32 m_Cursor;	// Write position in m_Slots[m_Fill]
+	NAlsImf::IMF_INT64 m_StreamPos;	// Position of m_pStream (-1:unknown)
+};
+
+#endif	// BGSTREAM_INCLUDED
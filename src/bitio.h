@@ -88,7 +88,7 @@ struct CBitIO
     long WriteRice(int *wert, char s, long N)		{return rice_encode_block (wert, s, N, &bio);}
 	long WriteBits(unsigned int value, short bits)	{put_bits (value, bits, &bio); return bits;}
 
-    void InitBitRead(unsigned char *buffer)			{bitio_init (buffer, 0, &bio);}
+    void InitBitRead(unsigned char *buffer, long size)	{bitio_init (buffer, 0, &bio); bitio_set_size (size, &bio);}
     long EndBitRead()								{return bitio_term (&bio);}
     long ReadRice(int *wert, char s, long N)		{return rice_decode_block (wert, s, N, &bio);}
 	long ReadBits(unsigned int *value, short bits)	{*value = get_bits(bits, &bio); return bits;}
@@ -34,40 +34,231 @@ contents : 32-bit CRC (based on Nelson/Gailly "The Data Compression Book")
 
 #include "crc.h"
 
-// Table used to calculate the CRC values
-unsigned int Ccitt32Table[256];
+// Carry-less multiplication (PCLMULQDQ) is used on x86-64 if the CPU supports it
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC_CLMUL
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC_TARGET
+#else
+#include <cpuid.h>
+#define CRC_TARGET __attribute__ ((target ("sse2,pclmul")))
+#endif
+#endif
 
-// Build the table
-void BuildCRCTable()
+// Tables used to calculate the CRC values
+struct CCrcTable
 {
-	short i, j;
-	unsigned int value;
+	unsigned int Ccitt32Table[16][256];	// [0]: byte-wise table, [k]: table for byte k of a 16-byte slice
+	unsigned int X2nTable[32];			// x^(2^n) mod CRC32_POLYNOMIAL
+	bool Clmul;							// true: PCLMULQDQ is available
+
+	CCrcTable()
+	{
+		short i, j;
+		unsigned int value;
+
+		for (i = 0; i <= 255; i++)
+		{
+			value = i;
+			for (j = 8; j > 0; j--)
+			{
+				if (value & 1)
+					value = (value >> 1) ^ CRC32_POLYNOMIAL;
+				else
+					value >>= 1;
+			}
+			Ccitt32Table[0][i] = value;
+		}
+		for (i = 0; i <= 255; i++)
+		{
+			for (j = 1; j < 16; j++)
+			{
+				value = Ccitt32Table[j-1][i];
+				Ccitt32Table[j][i] = (value >> 8) ^ Ccitt32Table[0][value & 0xff];
+			}
+		}
+
+		X2nTable[0] = 0x40000000;		// x^1 (bit-reversed)
+		for (i = 1; i < 32; i++)
+			X2nTable[i] = MultModP(X2nTable[i-1], X2nTable[i-1]);
 
-	for (i = 0; i <= 255; i++)
+		Clmul = false;
+#ifdef	CRC_CLMUL
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		Clmul = ((info[2] >> 1) & 1) != 0;
+#else
+		unsigned int eax, ebx, ecx, edx;
+		if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			Clmul = ((ecx >> 1) & 1) != 0;
+#endif
+#endif
+	}
+
+	// Product of two polynomials (bit-reversed) modulo CRC32_POLYNOMIAL
+	static unsigned int MultModP(unsigned int a, unsigned int b)
 	{
-		value = i;
-		for (j = 8; j > 0; j--)
+		unsigned int m = 0x80000000, p = 0;
+
+		for (; m != 0; m >>= 1)
 		{
-			if (value & 1)
-				value = (value >> 1) ^ CRC32_POLYNOMIAL;
-			else
-				value >>= 1;
+			if (a & m)
+				p ^= b;
+			b = (b & 1) ? (b >> 1) ^ CRC32_POLYNOMIAL : (b >> 1);
 		}
-		Ccitt32Table[i] = value;
-    }
+		return(p);
+	}
+};
+
+// Get the tables (built once, shared by all encoders and decoders)
+static const CCrcTable &GetCRCTable()
+{
+	static const CCrcTable Table;
+	return Table;
+}
+
+// Build the table
+void BuildCRCTable()
+{
+	GetCRCTable();
+}
+
+#ifdef	CRC_CLMUL
+// Fold 16-byte blocks with carry-less multiplications (count >= 64, multiple of 16)
+// Constants: x^(4*128+32), x^(4*128-32), x^(128+32), x^(128-32), x^64 mod P, and
+// floor(x^64 / P) for the Barrett reduction, all bit-reversed and shifted by one
+CRC_TARGET static unsigned int CalculateCRC32Clmul(unsigned int count, unsigned int crc, const unsigned char *p)
+{
+	const __m128i k1k2 = _mm_set_epi32(0x00000001, 0xc6e41596, 0x00000001, 0x54442bd4);
+	const __m128i k3k4 = _mm_set_epi32(0x00000000, 0xccaa009e, 0x00000001, 0x751997d0);
+	const __m128i k5k0 = _mm_set_epi32(0x00000000, 0x00000000, 0x00000001, 0x63cd6124);
+	const __m128i poly = _mm_set_epi32(0x00000001, 0xf7011641, 0x00000001, 0xdb710641);
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+	p += 64;
+	count -= 64;
+
+	// Fold 64 bytes per iteration
+	x0 = k1k2;
+	while (count >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+		p += 64;
+		count -= 64;
+	}
+
+	// Fold into 128 bits
+	x0 = k3k4;
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Remaining 16-byte blocks
+	while (count >= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+		p += 16;
+		count -= 16;
+	}
+
+	// Fold 128 bits to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return((unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
 }
+#endif
 
 // Calculate the CRC of a block of data
 unsigned int CalculateBlockCRC32(unsigned int count, unsigned int crc, void *buffer)
 {
-	unsigned char *p = (unsigned char *) buffer;
-	unsigned int temp1, temp2;
+	const CCrcTable &Table = GetCRCTable();
+	const unsigned int (*T)[256] = Table.Ccitt32Table;
+	const unsigned char *p = (const unsigned char *) buffer;
+	unsigned int a, b, c, d;
+
+#ifdef	CRC_CLMUL
+	if (Table.Clmul && (count >= 64))
+	{
+		crc = CalculateCRC32Clmul(count & ~15U, crc, p);
+		p += count & ~15U;
+		count &= 15;
+	}
+#endif
+
+	// 16 bytes per iteration (slice-by-16)
+	while (count >= 16)
+	{
+		a = crc ^ ((unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+		b = (unsigned int)p[4] | ((unsigned int)p[5] << 8) | ((unsigned int)p[6] << 16) | ((unsigned int)p[7] << 24);
+		c = (unsigned int)p[8] | ((unsigned int)p[9] << 8) | ((unsigned int)p[10] << 16) | ((unsigned int)p[11] << 24);
+		d = (unsigned int)p[12] | ((unsigned int)p[13] << 8) | ((unsigned int)p[14] << 16) | ((unsigned int)p[15] << 24);
+		crc = T[15][a & 0xff] ^ T[14][(a >> 8) & 0xff] ^ T[13][(a >> 16) & 0xff] ^ T[12][a >> 24] ^
+			  T[11][b & 0xff] ^ T[10][(b >> 8) & 0xff] ^ T[9][(b >> 16) & 0xff] ^ T[8][b >> 24] ^
+			  T[7][c & 0xff] ^ T[6][(c >> 8) & 0xff] ^ T[5][(c >> 16) & 0xff] ^ T[4][c >> 24] ^
+			  T[3][d & 0xff] ^ T[2][(d >> 8) & 0xff] ^ T[1][(d >> 16) & 0xff] ^ T[0][d >> 24];
+		p += 16;
+		count -= 16;
+	}
 
 	while (count-- != 0)
+		crc = (crc >> 8) ^ T[0][(crc ^ *p++) & 0xff];
+
+	return(crc);
+}
+
+// Combine the CRC crc1 of a first block with the CRC crc2 of a second block of
+// len2 bytes, which has been calculated starting with 0 instead of crc1
+unsigned int CombineCRC32(unsigned int crc1, unsigned int crc2, ALS_UINT64 len2)
+{
+	const CCrcTable &Table = GetCRCTable();
+	unsigned int x = 0x80000000;		// x^0 (bit-reversed)
+	short k = 3;						// x^(8*len2) = product of x^(2^k) for the bits of len2
+
+	for (; len2 != 0; len2 >>= 1, k++)
 	{
-		temp1 = (crc >> 8) & 0x00FFFFFFL;
-		temp2 = Ccitt32Table[((int)crc ^ *p++) & 0xff];
-		crc = temp1 ^ temp2;
-    }
-    return(crc);
+		if (len2 & 1)
+			x = CCrcTable::MultModP(Table.X2nTable[k & 31], x);
+	}
+	return(CCrcTable::MultModP(x, crc1) ^ crc2);
 }
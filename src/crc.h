@@ -32,8 +32,11 @@ contents : Header file for crc.cpp
 
 *************************************************************************/
 
+#include "stream.h"
+
 #define CRC_MASK           0xFFFFFFFFL
 #define CRC32_POLYNOMIAL   0xEDB88320L
 
 void BuildCRCTable();
 unsigned int CalculateBlockCRC32(unsigned int count, unsigned int crc, void *buffer);
+unsigned int CombineCRC32(unsigned int crc1, unsigned int crc2, ALS_UINT64 len2);
@@ -169,6 +169,7 @@ contents : Implementation of the CLpacDecoder class
  ************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <memory.h>
 #include <math.h>
 #include <assert.h>
@@ -188,6 +189,7 @@ contents : Implementation of the CLpacDecoder class
 #include "floating.h"
 #include "mcc.h"
 #include "lms.h"
+#include "workers.h"
 
 #define min(a, b)  (((a) < (b)) ? (a) : (b))
 #define max(a, b)  (((a) > (b)) ? (a) : (b))
@@ -202,6 +204,15 @@ int ilog2_ceil(unsigned int x) {
 	return l;
 }
 
+// Size of a stream (the position is not changed)
+ALS_INT64 GetStreamSize(HALSSTREAM fp) {
+	ALS_INT64 Pos = ftell(fp), Size;
+	fseek(fp, 0, SEEK_END);
+	Size = ftell(fp);
+	fseek(fp, Pos, SEEK_SET);
+	return Size;
+}
+
 } /* namespace */
 
 // Constructor
@@ -217,6 +228,15 @@ CLpacDecoder::CLpacDecoder()
 	CloseInput = CloseOutput = false;
 	ChanSort = 0;
 	mp4file = false;
+	fpMp4 = NULL;
+	CloseMp4 = false;
+	Mp4FrameId = 0;
+	InSlack = 0;
+	ResetInput();
+	MccBuf.m_Chan = 0;	// MCC buffer is allocated by AllocateBuffers()
+	Threads = 1;	// Single-threaded decoding
+	RlsPool = NULL;	// Serial RLSLMS prediction
+	LegacyRLSLMS = 0;	// Standard RLSLMS history update
 	ALSProfFillSet(ConformantProfiles);
 }
 
@@ -224,7 +244,9 @@ CLpacDecoder::~CLpacDecoder()
 {
 	long i;
 
-	if (frames > 0)
+	StopRlsThreads();
+
+	if (MccBuf.m_Chan)	// AllocateBuffers() has been called (also for empty streams)
 	{
 		// Deallocate memory
 		for (i = 0; i < Chan; i++)
@@ -238,13 +260,14 @@ CLpacDecoder::~CLpacDecoder()
 			{
 				delete [] rlslms_ptr.pbuf[i];
 				delete [] rlslms_ptr.weight[i];
+				delete [] rlslms_ptr.Pmatrix[i];
 			}
 			delete [] rlslms_ptr.pbuf;
 			delete [] rlslms_ptr.weight;
+			delete [] rlslms_ptr.Pmatrix;
+			delete [] rlslms_ptr.bufpos;
 		}
 
-		delete [] tmpbuf;
-
 		delete [] bbuf;
 		delete [] d;
 		delete [] cofQ;
@@ -259,7 +282,7 @@ CLpacDecoder::~CLpacDecoder()
 	// Deallocate float buffer
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.FreeBuffer();
 	// Deallocate MCC buffer
-	FreeMccDecBuffer( &MccBuf );
+	if ( MccBuf.m_Chan ) FreeMccDecBuffer( &MccBuf );
 
 	// Close files
 	CloseFiles();
@@ -278,6 +301,110 @@ short CLpacDecoder::CloseFiles()
 		fpOutput = NULL;
 		CloseOutput = false;
 	}
+
+	if ( fpMp4 ) {
+		Mp4Reader.Close();
+		if ( CloseMp4 ) fclose( fpMp4 );
+		fpMp4 = NULL;
+		CloseMp4 = false;
+	}
+	return(0);
+}
+
+short CLpacDecoder::OpenInputFile( const char *name, bool mp4 )
+{
+	HALSSTREAM hStream = NULL;
+
+	if ( OpenFileReader( name, &hStream ) != 0 ) return 1;
+	SetInputStream( hStream, mp4 );
+	if ( mp4file ) CloseMp4 = true;
+	else CloseInput = true;
+
+	// Seek index, see BuildIndex()
+	if ( !mp4file && strcmp( name, " " ) ) {
+		IndexName = name;
+		IndexName += ".idx";
+	}
+	return 0;
+}
+
+// In MP4 mode, hStream is the MP4 file and fpInput is set up by AnalyseInputFile().
+short CLpacDecoder::SetInputStream( HALSSTREAM hStream, bool mp4 )
+{
+	mp4file = mp4;
+	if ( mp4file ) {
+		fpMp4 = hStream;
+		CloseMp4 = false;
+	} else {
+		fpInput = hStream;
+		CloseInput = false;
+	}
+	ALSProfFillSet(ConformantProfiles);
+	return 0;
+}
+
+// Open MP4 file and read ALS header from ALSSpecificConfig
+// Frames are read directly from the MP4 file by ReadMp4Frame() later.
+short CLpacDecoder::OpenMp4(MP4INFO &Mp4Info)
+{
+	NAlsImf::IMF_UINT8 *pConfig, Aot;
+	NAlsImf::IMF_UINT32 ConfigSize, i;
+	NAlsImf::CMp4aReader::CFrameInfo FrameInfo;
+
+	if (fpMp4 == NULL)
+		return(1);
+
+	Mp4Stream.Attach(fpMp4);
+	if (!Mp4Reader.Open(Mp4Stream))
+		return(1);
+
+	// AudioSpecificConfig (6 bytes) is followed by ALSSpecificConfig
+	pConfig = Mp4Reader.GetDecSpecInfo(ConfigSize);
+	if ((pConfig == NULL) || (ConfigSize < 6))
+		return(1);
+	Aot = pConfig[0] >> 3;											// XXXX Xxxx
+	if (Aot == 0x1F)
+		Aot = 32 + (((pConfig[0] & 0x07) << 3) | (pConfig[1] >> 5));	// xxx- ----
+	if (Aot != 36)
+		return(1);
+
+	// Fill in MP4INFO structure
+	Mp4Info.m_audioProfileLevelIndication = Mp4Reader.GetAudioProfileLevelIndication();
+	Mp4Info.m_Samples = 0;
+	for (i = 0; i < Mp4Reader.GetFrameCount(); i++)
+		if (Mp4Reader.GetFrameInfo(i, FrameInfo))
+			Mp4Info.m_Samples += FrameInfo.m_NumSamples;
+	Mp4Reader.GetHeader(Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize);
+	Mp4Reader.GetTrailer(Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize);
+	Mp4Reader.GetAuxData(Mp4Info.m_AuxDataOffset, Mp4Info.m_AuxDataSize);
+	Mp4Reader.GetFileType(Mp4Info.m_FileType, Mp4Info.m_FileTypeName);
+
+	Mp4FrameId = 0;
+	Mp4Frame.clear();
+
+	// ALS header is read from ALSSpecificConfig
+	if (OpenMemoryReader(pConfig + 6, ConfigSize - 6, &fpInput))
+		return(1);
+	CloseInput = true;
+
+	return(0);
+}
+
+// Read next MP4 frame (one RAU, or all frames if RA == 0)
+// Frames receives the number of ALS frames in it.
+short CLpacDecoder::ReadMp4Frame(std::vector<unsigned char> &Data, long &Frames)
+{
+	NAlsImf::CMp4aReader::CFrameInfo FrameInfo;
+
+	if (!Mp4Reader.GetFrameInfo(Mp4FrameId, FrameInfo) || (FrameInfo.m_EncSize == 0))
+		return(1);
+
+	Data.resize(FrameInfo.m_EncSize);
+	if (Mp4Reader.ReadFrame(Mp4FrameId, &Data[0], FrameInfo.m_EncSize) != FrameInfo.m_EncSize)
+		return(1);
+	Mp4FrameId++;
+
+	Frames = static_cast<long>( (FrameInfo.m_NumSamples + N - 1) / N );
 	return(0);
 }
 
@@ -287,12 +414,96 @@ short CLpacDecoder::CloseFiles()
 	*SizeOut = ftell(fpOutput);
 }*/
 
-short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const MP4INFO& Mp4Info)
+// Discard buffered input, e.g. after fpInput has been moved
+void CLpacDecoder::ResetInput()
+{
+	pIn = InBuf.empty() ? NULL : &InBuf[0];
+	InPos = InLen = 0;
+	InEof = false;
+	InMapped = false;
+}
+
+// Parse the following frames from Data (e.g. one RAU) instead of fpInput
+// The contents of Data are taken over, Data is left empty.
+void CLpacDecoder::TakeInput(std::vector<unsigned char> &Data)
+{
+	InBuf.swap(Data);
+	Data.clear();
+	InLen = static_cast<long>( InBuf.size() );
+	InBuf.resize(InLen + InSlack);		// zero bytes behind the data
+	pIn = &InBuf[0];
+	InPos = 0;
+	InEof = true;
+	InMapped = false;
+}
+
+// Make sure that the next frame is at pIn, so it can be parsed without
+// further reads. Mapped input files are parsed in place, as long as more
+// than InSlack bytes are left. Otherwise, InBuf is filled with up to
+// 2 * InSlack bytes from fpInput at once, and InSlack zero bytes follow
+// the data at the end of the input.
+// fpInput is always at pIn[InLen].
+// Returns 1 if more bytes than available have been parsed (broken input)
+short CLpacDecoder::FillInput()
+{
+	const unsigned char *pData;
+	ALS_UINT32 Mapped;
+	long Size, Left = InLen - InPos;
+
+	if (InPos > InLen)
+		return(1);
+	if (InEof || (Left >= InSlack))
+		return(0);
+
+	// In place: the unparsed bytes directly precede the mapped data
+	pData = static_cast<const unsigned char*>( fpeek(fpInput, &Mapped) );
+	if (Mapped > 0x40000000)
+		Mapped = 0x40000000;
+	if ((pData != NULL) && (InMapped || !Left) && (Left + static_cast<long>( Mapped ) >= InSlack))
+	{
+		if (fseek(fpInput, Mapped, SEEK_CUR))
+			return(1);
+		pIn = const_cast<unsigned char*>( pData ) - Left;	// read only
+		InLen = Left + Mapped;
+		InPos = 0;
+		InMapped = true;
+		return(0);
+	}
+
+	if (static_cast<long>( InBuf.size() ) < 3 * InSlack)
+		InBuf.resize(3 * InSlack);
+	memmove(&InBuf[0], InMapped ? pIn + InPos : &InBuf[InPos], Left);
+	pIn = &InBuf[0];
+	InLen = Left;
+	InPos = 0;
+	InMapped = false;
+
+	Size = static_cast<long>( fread(&InBuf[InLen], 1, 2 * InSlack - InLen, fpInput) );
+	if (Size < 2 * InSlack - InLen)
+	{
+		InEof = true;
+		memset(&InBuf[InLen + Size], 0, InBuf.size() - InLen - Size);
+	}
+	InLen += Size;
+
+	return(0);
+}
+
+// Position of the next unparsed byte in fpInput
+ALS_INT64 CLpacDecoder::TellInput()
+{
+	return(ftell(fpInput) - (InLen - InPos));
+}
+
+short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, MP4INFO& Mp4Info)
 {
 	BYTE tmp;
 	long i;
 	UINT als_id;
 
+	if (mp4file && OpenMp4(Mp4Info))
+		return(1);
+
 	// Read ALS header information ////////////////////////////////////////////////////////////////
 	als_id = ReadUIntMSBfirst(fpInput);		// ALS identifier: 'ALS' + 0x00 (= 0x414C5300)
 	if (als_id != 0x414C5300UL)
@@ -363,7 +574,7 @@ short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const M
 		long size = (NeedPuchBit*Chan+7)/8;
 		unsigned char* buff = new unsigned char[size];
 		fread(buff, 1, size, fpInput);
-		in.InitBitRead(buff);
+		in.InitBitRead(buff, size);
 
 		for (i = 0; i < Chan; i++)
 		{
@@ -380,6 +591,13 @@ short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const M
 	
 	// End of header information //////////////////////////////////////////////////////////////////
 
+	// When CMp4aReader cannot detect the file type, take it from ALS header.
+	if (mp4file && (Mp4Info.m_FileType == 0xff))
+	{
+		Mp4Info.m_FileType = static_cast<NAlsImf::IMF_UINT8>( FileType );
+		Mp4Info.m_FileTypeName.erase();
+	}
+
 	// Set parameter structure
 	ainfo->FileType = (unsigned char)FileType;
 	ainfo->MSBfirst = (unsigned char)MSBfirst;
@@ -412,17 +630,26 @@ short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const M
 
 ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 {
-	long i, j, rest;
-
 	// Copy header
 	if ( HeaderSize == 0xffffffff ) {
 		if ( !mp4file ) return ( frames = -2 );
-		if ( !CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize, fpOutput ) ) return ( frames = -2 );
+		if ( fseek( fpMp4, Mp4Info.m_HeaderOffset, SEEK_SET ) != 0 ) return ( frames = -2 );
+		if ( !CopyData( fpMp4, Mp4Info.m_HeaderSize, fpOutput ) ) return ( frames = -2 );
 	} else {
 		if ( HeaderSize >> 32 ) return ( frames = -2 );
 		if ( !CopyData( fpInput, HeaderSize, fpOutput ) ) return ( frames = -2 );
 	}
-	
+
+	return ReadFrameInfo();
+}
+
+// Read the information between header data and the first frame (trailer,
+// CRC, RAU sizes, aux data), and allocate buffers
+// Returns the number of frames (< 1 on errors)
+ALS_INT64 CLpacDecoder::ReadFrameInfo()
+{
+	long rest;
+
 	// Read trailer
 	if ( TrailerSize != 0xffffffff ) {
 		TrailerOffset = ftell( fpInput );
@@ -468,9 +695,28 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 		fseek(fpInput, size, SEEK_CUR);				// skip aux data
 	}
 
+	if (RA && (RAflag != 2) && !mp4file)
+		LoadIndex(ftell(fpInput));
+
 	if (Chan == 1)
 		Joint = 0;
 
+	AllocateBuffers();
+
+	// Length of last frame
+	if (rest)
+		N0 = rest;
+	else
+		N0 = N;
+
+	return(frames);
+}
+
+// Allocate buffers for decoding (will be deallocated by the destructor)
+void CLpacDecoder::AllocateBuffers()
+{
+	long i, j;
+
 	// Allocate memory
 	xp = new int*[Chan];
 	x = new int*[Chan];
@@ -481,29 +727,34 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 		memset(xp[i], 0, sizeof(int)*P);
 	}
 	
-	// following buffer size is enough if only forward predictor is used.
-	//	tmpbuf = new unsigned char[((long)((IntRes+7)/8)+1)*N + (4*P + 128)*(1+(1<<Sub))];
-	// for RLS-LMS
-	tmpbuf = new unsigned char[long(IntRes/8+10)*N + MAXODR * 4];
-
 	if (RLSLMS)
 	{
 		rlslms_ptr.pbuf = new BUF_TYPE*[Chan];
 		rlslms_ptr.weight  = new W_TYPE*[Chan];
 		rlslms_ptr.Pmatrix  = new P_TYPE*[Chan];
+		rlslms_ptr.bufpos = new short[Chan][MAX_STAGES];
 		for (i = 0; i < Chan; i++)
 		{
-			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_LMS_LEN];
+			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_BUF_LEN];
 			rlslms_ptr.weight[i]=new W_TYPE[TOTAL_LMS_LEN];
 			rlslms_ptr.Pmatrix[i] = new P_TYPE[JS_LEN*JS_LEN];
-			for(j=0;j<TOTAL_LMS_LEN;j++) rlslms_ptr.pbuf[i][j]=0;
+			for(j=0;j<TOTAL_BUF_LEN;j++) rlslms_ptr.pbuf[i][j]=0;
+			for(j=0;j<MAX_STAGES;j++) rlslms_ptr.bufpos[i][j]=0;
 		}
+		memset(&rlslms_ptr.mode_table, 0, sizeof(mtable));
+		rlslms_ptr.old_flag = 0;
+		rlslms_ptr.legacy = LegacyRLSLMS;
 	}
 
 	// following buffer size is enough if only forward predictor is used.
 	//	bbuf = new unsigned char[(((long)((IntRes+7)/8)+1)*N + (4*P + 128)*(1+(1<<Sub))) * Chan];	// Input buffer
 	// for RLS-LMS
-	bbuf = new unsigned char[long(IntRes/8+10)*Chan*N];	// Input buffer
+	bbuf = new unsigned char[long(IntRes/8+10)*Chan*N];	// Output buffer
+
+	// Frames are parsed from InBuf or the mapped input file, see FillInput()
+	InSlack = Chan * (long(IntRes/8+10) * N + P + 16 + 255*4 + 8) + 8;
+	if ( SampleType == SAMPLE_TYPE_FLOAT ) InSlack += Chan * N * IEEE754_BYTES_PER_SAMPLE * 2 + 4;
+	ResetInput();
 
 	// Allocate float buffer
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.AllocateBuffer( Chan, N, IntRes );
@@ -527,33 +778,399 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 
 	d = new int[N];								// Prediction residual
 	cofQ = new int[P];								// Quantized coefficients
+}
 
-	// Length of last frame
-	if (rest)
-		N0 = rest;
-	else
-		N0 = N;
-
-	return(frames);
+// Copy the stream parameters of another decoder (for worker threads)
+void CLpacDecoder::CopyParameters(const CLpacDecoder &Dec)
+{
+	N = Dec.N;
+	P = Dec.P;
+	Adapt = Dec.Adapt;
+	Joint = Dec.Joint;
+	RA = Dec.RA;
+	Sub = Dec.Sub;
+	BGMC = Dec.BGMC;
+	MCC = Dec.MCC;
+	PITCH = Dec.PITCH;
+	RLSLMS = Dec.RLSLMS;
+	FileType = Dec.FileType;
+	MSBfirst = Dec.MSBfirst;
+	Chan = Dec.Chan;
+	Res = Dec.Res;
+	IntRes = Dec.IntRes;
+	SampleType = Dec.SampleType;
+	Samples = Dec.Samples;
+	Freq = Dec.Freq;
+	frames = Dec.frames;
+	N0 = Dec.N0;
+	Q = Dec.Q;
+	ChanSort = Dec.ChanSort;
+	if (ChanSort)
+	{
+		ChPos = new unsigned short[Chan];
+		memcpy(ChPos, Dec.ChPos, Chan * sizeof(unsigned short));
+	}
+	CoefTable = Dec.CoefTable;
+	SBpart = Dec.SBpart;
+	RAflag = Dec.RAflag;
+	ChanConfig = Dec.ChanConfig;
+	CRCenabled = Dec.CRCenabled;
+	LegacyRLSLMS = Dec.LegacyRLSLMS;
+	RAUnits = Dec.RAUnits;
+	RAUsize = NULL;
+	AUXenabled = Dec.AUXenabled;
+	mp4file = Dec.mp4file;
+	ConformantProfiles = Dec.ConformantProfiles;
 }
 
 ALS_INT64 CLpacDecoder::WriteTrailer( const MP4INFO& Mp4Info )
 {
 	if ( TrailerSize == 0xffffffff ) {
 		if ( !mp4file ) return -1;
-		if ( !CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize, fpOutput ) ) return -1;
+		if ( fseek( fpMp4, Mp4Info.m_TrailerOffset, SEEK_SET ) != 0 ) return -1;
+		if ( !CopyData( fpMp4, Mp4Info.m_TrailerSize, fpOutput ) ) return -1;
 	} else {
 		if ( TrailerSize >> 32 ) return -1;
+		if ( mp4file ) {
+			// Trailer is in ALSSpecificConfig, but fpInput has moved on to the frames.
+			NAlsImf::IMF_UINT32	ConfigSize;
+			NAlsImf::IMF_UINT8*	pConfig = Mp4Reader.GetDecSpecInfo( ConfigSize );
+			if ( CloseInput ) fclose( fpInput );
+			CloseInput = ( OpenMemoryReader( pConfig + 6, ConfigSize - 6, &fpInput ) == 0 );
+			if ( !CloseInput ) return -1;
+		}
 		fseek( fpInput, TrailerOffset, SEEK_SET );
 		if ( !CopyData( fpInput, TrailerSize, fpOutput ) ) return -1;
 	}
 
+	// Report pending write errors
+	if ( ( fpOutput != NULL ) && fflush( fpOutput ) ) return -1;
+
 	CRC ^= CRC_MASK;
 	CRC -= CRCorg;		// CRC = 0 if decoding was successful
 
 	return ( TrailerSize == 0xffffffff ) ? Mp4Info.m_TrailerSize : TrailerSize;
 }
 
+// Decode Length samples, beginning with sample Start (raw PCM, without header and trailer)
+// Only the frames from the start of the RAU containing Start are decoded,
+// if the positions of the RAUs are known (RAflag = 1 or 2, or MP4 file).
+// Returns 0 on success, -1 for an invalid range, -2 on errors
+short CLpacDecoder::DecodeRange( ALS_INT64 Start, ALS_INT64 Length )
+{
+	long SampleBytes = Chan * ((SampleType == SAMPLE_TYPE_INT) ? (Res / 8) : IEEE754_BYTES_PER_SAMPLE);
+	HALSSTREAM fpRange = fpOutput;
+	ALS_INT64 End, Pos;
+	long M, From, To;
+	short result = 0;
+
+	if ((Start < 0) || (Length < 1) || (Start >= Samples))
+		return(-1);
+	End = (Length > Samples - Start) ? Samples : Start + Length;
+
+	// Skip header (not written)
+	if (HeaderSize != 0xffffffff)
+	{
+		if ((HeaderSize >> 32) || fseek(fpInput, HeaderSize, SEEK_CUR))
+			return(-2);
+	}
+	else if (!mp4file)
+		return(-2);
+
+	if (((frames = ReadFrameInfo()) < 1) || SeekRAU(Start / N))
+		return(-2);
+
+	// Decode frames, but write the requested samples only
+	fpOutput = NULL;
+	for (Pos = fid * N; Pos < End; Pos += M)
+	{
+		if (DecodeFrame())
+		{
+			result = -2;
+			break;
+		}
+		M = N;		// changed to N0 for the last frame
+		if (Pos + M > Start)
+		{
+			From = (Start > Pos) ? static_cast<long>( Start - Pos ) : 0;
+			To = (End < Pos + M) ? static_cast<long>( End - Pos ) : M;
+			if ((fpRange != NULL) && (fwrite(bbuf + From * SampleBytes, 1, (To - From) * SampleBytes, fpRange) != static_cast<ALS_UINT32>( (To - From) * SampleBytes )))
+			{
+				result = -2;
+				break;
+			}
+		}
+	}
+	fpOutput = fpRange;
+	if ((fpRange != NULL) && fflush(fpRange))
+		result = -2;
+
+	return(result);
+}
+
+// Go to the RAU containing Frame (0..frames-1), right after ReadFrameInfo()
+// Without RAU sizes, the seek index is used to get as close as possible.
+// Stays at the first frame if the positions of the RAUs are not known.
+// fid is set to the number of frames skipped.
+short CLpacDecoder::SeekRAU(ALS_INT64 Frame)
+{
+	NAlsImf::CMp4aReader::CFrameInfo FrameInfo;
+	ALS_INT64 Pos = 0;
+	unsigned int Size;
+	long r;
+
+	fid = 0;
+	if (!RA)
+		return(0);
+
+	if (mp4file && (fpMp4 != NULL))
+	{
+		// One RAU per MP4 frame: search its start in the frame table
+		while (Mp4Reader.GetFrameInfo(Mp4FrameId, FrameInfo) && (Pos + FrameInfo.m_NumSamples <= Frame * N))
+		{
+			Pos += FrameInfo.m_NumSamples;
+			Mp4FrameId++;
+		}
+		fid = Pos / N;
+	}
+	else if (RAflag == 2)		// RAU sizes in header
+	{
+		for (r = 0; r < Frame / RA; r++)
+			Pos += RAUsize[r];
+		if (fseek(fpInput, Pos, SEEK_CUR))
+			return(1);
+		fid = r * RA;
+	}
+	else
+	{
+		// Last indexed RAU not behind Frame
+		r = 0;
+		if (!RAUpos.empty())
+		{
+			r = static_cast<long>( min(Frame / RA, static_cast<ALS_INT64>( RAUpos.size() ) - 1) );
+			if (fseek(fpInput, RAUpos[r], SEEK_SET))
+				return(1);
+		}
+		if (RAflag == 1)		// RAU sizes in front of the RAUs
+		{
+			for (; r < Frame / RA; r++)
+			{
+				Size = ReadUIntMSBfirst(fpInput);
+				if (fseek(fpInput, Size, SEEK_CUR))
+					return(1);
+			}
+		}
+		fid = static_cast<ALS_INT64>( r ) * RA;
+	}
+	RAUid = static_cast<long>( fid / RA );
+	ResetInput();		// next frame is read by DecodeFrame()
+
+	return(0);
+}
+
+// Build or update the seek index (IndexName) of an ALS file without RAU
+// sizes in the header (RAflag = 0 or 1), right after AnalyseInputFile().
+// Index file: "ALSI", version (2), N, RA, Chan (32 bit each), then the
+// fingerprint of the ALS file: samples (64 bit), CRC, CRC of the bytes in
+// front of the first frame (32 bit each), file size (64 bit). Then one entry
+// for each RAU and one for the end of the last frame: sample, file offset
+// (64 bit each), CRC of the 16 bytes in front of the offset (32 bit, 0 for
+// the first RAU).
+// The entries of an existing index are kept, so only the RAUs appended to
+// the file since the last update are scanned.
+// Returns the number of indexed RAUs, -1 if no index is needed, -2 on errors
+long CLpacDecoder::BuildIndex()
+{
+	HALSSTREAM fpSave = fpOutput;
+	ALS_INT64 Size, Pos;
+	long NN = N, r, f, Frames;
+	unsigned int RAUbytes;
+	short result = 0;
+
+	if (mp4file || !RA || (RAflag == 2))
+		return(-1);
+	if (IndexName.empty() || (HeaderSize == 0xffffffff) || (HeaderSize >> 32) || fseek(fpInput, HeaderSize, SEEK_CUR))
+		return(-2);
+	if ((frames = ReadFrameInfo()) < 1)		// also loads the existing index
+		return(-2);
+	if (static_cast<long>( RAUpos.size() ) > RAUnits)
+		return(RAUnits);		// up to date
+
+	// Continue with the last indexed RAU
+	Size = GetStreamSize(fpInput);
+	if (RAUpos.empty())
+		RAUpos.push_back(ftell(fpInput));
+	r = static_cast<long>( RAUpos.size() ) - 1;
+	if (fseek(fpInput, RAUpos[r], SEEK_SET))
+		return(-2);
+	fid = static_cast<ALS_INT64>( r ) * RA;
+
+	fpOutput = NULL;
+	while (r < RAUnits)
+	{
+		Frames = static_cast<long>( min(RA, frames - fid) );
+		if (RAflag == 1)		// hop to the next RAU
+		{
+			RAUbytes = ReadUIntMSBfirst(fpInput);
+			result = fseek(fpInput, RAUbytes, SEEK_CUR);
+			fid += Frames;
+		}
+		else					// decode the RAU to find its end
+		{
+			for (f = 0; !result && (f < Frames); f++)
+				result = DecodeFrame();
+		}
+		Pos = TellInput();
+		if (result || (Pos > Size) || (Pos - RAUpos[r] > 0xffffffff))
+			break;				// incomplete RAU
+		RAUpos.push_back(Pos);
+		r++;
+	}
+	fpOutput = fpSave;
+	N = NN;		// restore frame length (changed for the last frame)
+
+	if (SaveIndex())
+		return(-2);
+
+	return(r);
+}
+
+// Read the seek index (IndexName) of the input file, see BuildIndex()
+// An index of another file is ignored. If the fingerprint differs, but the
+// file has grown, it may have been appended to: the entries are checked as
+// usual and the valid ones are kept.
+// Only the entries which still fit the file are used. Each entry must
+// follow the same bytes as when it was indexed, and with RAU sizes in
+// front of the RAUs, the previous RAU must end there.
+void CLpacDecoder::LoadIndex(ALS_INT64 FrameStart)
+{
+	HALSSTREAM fpIndex;
+	unsigned char Magic[4], Entry[20];
+	ALS_INT64 Size, Sample, Pos, Last = FrameStart;
+	unsigned int HeadCRC, Crc;
+	long r;
+	short i;
+	bool Same;
+
+	RAUpos.clear();
+	if (IndexName.empty() || OpenFileReader(IndexName.c_str(), &fpIndex))
+		return;
+
+	Size = GetStreamSize(fpInput);
+	if ((fread(Magic, 1, 4, fpIndex) == 4) && !memcmp(Magic, "ALSI", 4) &&
+		(ReadUIntMSBfirst(fpIndex) == 2) &&
+		(static_cast<long>( ReadUIntMSBfirst(fpIndex) ) == N) &&
+		(static_cast<short>( ReadUIntMSBfirst(fpIndex) ) == RA) &&
+		(static_cast<long>( ReadUIntMSBfirst(fpIndex) ) == Chan) &&
+		(fread(Entry, 1, 20, fpIndex) == 20) && !InputCRC(0, FrameStart, HeadCRC))
+	{
+		// Fingerprint
+		Sample = Pos = 0;
+		for (i = 0; i < 8; i++)
+		{
+			Sample = (Sample << 8) | Entry[i];
+			Pos = (Pos << 8) | Entry[12 + i];
+		}
+		Crc = (static_cast<unsigned int>( Entry[8] ) << 24) | (Entry[9] << 16) | (Entry[10] << 8) | Entry[11];
+		Same = (Sample == Samples) && (Crc == (CRCenabled ? CRCorg : 0)) && (Pos == Size);
+		Same = (ReadUIntMSBfirst(fpIndex) == HeadCRC) && Same;
+		r = (Same || (Pos < Size)) ? 0 : RAUnits + 1;
+
+		for (; (r <= RAUnits) && (fread(Entry, 1, 20, fpIndex) == 20); r++)
+		{
+			Sample = Pos = 0;
+			for (i = 0; i < 8; i++)
+			{
+				Sample = (Sample << 8) | Entry[i];
+				Pos = (Pos << 8) | Entry[8 + i];
+			}
+			if (Sample != ((r < RAUnits) ? static_cast<ALS_INT64>( r ) * RA * N : Samples))
+				break;
+			if (r ? ((Pos <= Last) || (Pos - Last > 0xffffffff)) : (Pos != FrameStart))
+				break;
+			if (Pos > Size)
+				break;
+			if (r)
+			{
+				// Same bytes in front of the entry
+				Crc = (static_cast<unsigned int>( Entry[16] ) << 24) | (Entry[17] << 16) | (Entry[18] << 8) | Entry[19];
+				if (InputCRC(Pos - 16, 16, HeadCRC) || (HeadCRC != Crc))
+					break;
+				// RAU size of the previous RAU
+				if ((RAflag == 1) && (fseek(fpInput, Last, SEEK_SET) || (ReadUIntMSBfirst(fpInput) != Pos - Last - 4)))
+					break;
+			}
+			RAUpos.push_back(Last = Pos);
+		}
+	}
+	fclose(fpIndex);
+	fseek(fpInput, FrameStart, SEEK_SET);
+}
+
+// Write the seek index (IndexName), see BuildIndex()
+short CLpacDecoder::SaveIndex()
+{
+	HALSSTREAM fpIndex;
+	ALS_INT64 Sample, Size;
+	std::vector<unsigned int> Crc(RAUpos.size() + 1, 0);
+	long r;
+
+	// CRCs of the bytes in front of the first frame and of the entries
+	Size = GetStreamSize(fpInput);
+	if (RAUpos.empty() || InputCRC(0, RAUpos[0], Crc[0]))
+		return(1);
+	for (r = 1; r < static_cast<long>( RAUpos.size() ); r++)
+		if (InputCRC(RAUpos[r] - 16, 16, Crc[r + 1]))
+			return(1);
+
+	if (OpenFileWriter(IndexName.c_str(), &fpIndex))
+		return(1);
+
+	fwrite("ALSI", 1, 4, fpIndex);
+	WriteUIntMSBfirst(2, fpIndex);
+	WriteUIntMSBfirst(N, fpIndex);
+	WriteUIntMSBfirst(RA, fpIndex);
+	WriteUIntMSBfirst(Chan, fpIndex);
+	WriteUIntMSBfirst(static_cast<unsigned int>( Samples >> 32 ), fpIndex);
+	WriteUIntMSBfirst(static_cast<unsigned int>( Samples ), fpIndex);
+	WriteUIntMSBfirst(CRCenabled ? CRCorg : 0, fpIndex);
+	WriteUIntMSBfirst(static_cast<unsigned int>( Size >> 32 ), fpIndex);
+	WriteUIntMSBfirst(static_cast<unsigned int>( Size ), fpIndex);
+	WriteUIntMSBfirst(Crc[0], fpIndex);
+	for (r = 0; r < static_cast<long>( RAUpos.size() ); r++)
+	{
+		Sample = (r < RAUnits) ? static_cast<ALS_INT64>( r ) * RA * N : Samples;
+		WriteUIntMSBfirst(static_cast<unsigned int>( Sample >> 32 ), fpIndex);
+		WriteUIntMSBfirst(static_cast<unsigned int>( Sample ), fpIndex);
+		WriteUIntMSBfirst(static_cast<unsigned int>( RAUpos[r] >> 32 ), fpIndex);
+		WriteUIntMSBfirst(static_cast<unsigned int>( RAUpos[r] ), fpIndex);
+		WriteUIntMSBfirst(Crc[r + 1], fpIndex);
+	}
+
+	return(fclose(fpIndex) != 0);
+}
+
+// CRC of Bytes bytes of the input file from Pos on, for the seek index
+// Returns 1 if the bytes cannot be read
+short CLpacDecoder::InputCRC(ALS_INT64 Pos, ALS_INT64 Bytes, unsigned int &Crc)
+{
+	unsigned char Buf[4096];
+	ALS_UINT32 Len;
+
+	Crc = CRC_MASK;
+	if ((Pos < 0) || fseek(fpInput, Pos, SEEK_SET))
+		return(1);
+	for (; Bytes > 0; Bytes -= Len)
+	{
+		Len = static_cast<ALS_UINT32>( min(Bytes, static_cast<ALS_INT64>( sizeof(Buf) )) );
+		if (fread(Buf, 1, Len, fpInput) != Len)
+			return(1);
+		Crc = CalculateBlockCRC32(Len, Crc, Buf);
+	}
+	Crc ^= CRC_MASK;
+	return(0);
+}
+
 short CLpacDecoder::DecodeAll( const MP4INFO& Mp4Info )
 {
 	long f;
@@ -561,13 +1178,23 @@ short CLpacDecoder::DecodeAll( const MP4INFO& Mp4Info )
 	if ((frames = WriteHeader( Mp4Info )) < 1)
 		return static_cast<short>( frames );
 
-	// Main loop for all frames
-	for (f = 0; f < frames; f++)
+	// RAUs can be decoded independently if their sizes are known (MP4: one RAU
+	// per MP4 frame, RAflag = 0: complete seek index), except for RLSLMS (not re-entrant)
+	if ((Threads > 1) && RA && ((RAflag == 1) || (RAflag == 2) || mp4file || (static_cast<long>( RAUpos.size() ) > RAUnits)) && !RLSLMS)
 	{
-		// Decode one frame
-		if (DecodeFrame())
+		if (DecodeAllThreads())
 			return(-2);
 	}
+	else
+	{
+		// Main loop for all frames
+		for (f = 0; f < frames; f++)
+		{
+			// Decode one frame
+			if (DecodeFrame())
+				return(-2);
+		}
+	}
 
 	if (WriteTrailer( Mp4Info ) < 0)
 		return(-2);
@@ -575,11 +1202,245 @@ short CLpacDecoder::DecodeAll( const MP4INFO& Mp4Info )
 	return(CRC != 0);	// Return CRC status
 }
 
+// Job for the worker threads: one random access unit
+class CDecoderJob : public CWorkerJob
+{
+public:
+	CDecoderJob() : m_ppDecoder( NULL ), m_Error( 0 ) {}
+	void Run( short Worker ) { m_Error = m_ppDecoder[Worker]->DecodeJob( this ); }
+
+	CLpacDecoder**	m_ppDecoder;		// Decoder of each worker thread
+	ALS_INT64		m_Frame;			// Number of frames before this job
+	long			m_Frames;			// Number of frames
+	std::vector<unsigned char>	m_Data;	// Encoded RAU (including its size if RAflag == 1)
+	std::vector<unsigned char>	m_Pcm;	// Decoded audio data
+	unsigned int	m_Crc;				// CRC of m_Pcm (starting with 0)
+	short			m_Error;
+};
+
+// Decode all frames using worker threads
+// The input is read and the output is written by the calling thread;
+// the RAU sizes are used to hand each RAU to a worker as a whole.
+short CLpacDecoder::DecodeAllThreads()
+{
+	long Jobs = 2 * Threads;									// Jobs in flight
+	long Head = 0, Tail = 0, Queued = 0;
+	ALS_INT64 Read = 0;
+	long w, Offset;
+	unsigned int Size;
+	short result = 0;
+
+	CWorkerPool Pool;
+	CLpacDecoder **ppDecoder = new CLpacDecoder*[Threads];
+	CDecoderJob *pJob = new CDecoderJob[Jobs];
+
+	for (w = 0; w < Threads; w++)
+	{
+		ppDecoder[w] = new CLpacDecoder;
+		ppDecoder[w]->CopyParameters(*this);
+		ppDecoder[w]->AllocateBuffers();
+	}
+	for (w = 0; w < Jobs; w++)
+		pJob[w].m_ppDecoder = ppDecoder;
+
+	Pool.Start(Threads);
+
+	for (;;)
+	{
+		// Read RAUs and queue jobs
+		while (!result && (Queued < Jobs) && (Read < frames))
+		{
+			CDecoderJob &Job = pJob[Head];
+
+			Job.m_Frame = Read;
+			Job.m_Frames = static_cast<long>( min(RA, frames - Read) );
+			Offset = 0;
+			if (mp4file)			// MP4 frame
+			{
+				if (ReadMp4Frame(Job.m_Data, Job.m_Frames))
+				{
+					result = 1;
+					break;
+				}
+				Job.m_Frames = static_cast<long>( min(Job.m_Frames, frames - Read) );
+			}
+			else if (RAflag == 1)	// size in front of the RAU
+			{
+				Size = ReadUIntMSBfirst(fpInput);
+				Job.m_Data.resize(4 + static_cast<size_t>( Size ));
+				Job.m_Data[0] = (Size >> 24) & 0xFF;
+				Job.m_Data[1] = (Size >> 16) & 0xFF;
+				Job.m_Data[2] = (Size >> 8) & 0xFF;
+				Job.m_Data[3] = Size & 0xFF;
+				Offset = 4;
+			}
+			else if (RAflag == 2)	// size in header
+			{
+				Size = RAUsize[RAUid++];
+				Job.m_Data.resize(Size);
+			}
+			else					// position in the seek index
+			{
+				Size = static_cast<unsigned int>( RAUpos[RAUid + 1] - RAUpos[RAUid] );
+				RAUid++;
+				Job.m_Data.resize(Size);
+			}
+			if (!mp4file && (!Size || (fread(&Job.m_Data[Offset], 1, Size, fpInput) != Size)))
+			{
+				result = 1;
+				break;
+			}
+
+			Pool.Push(&Job);
+			Read += Job.m_Frames;
+			Head = (Head + 1) % Jobs;
+			Queued++;
+		}
+
+		if (!Queued)
+			break;
+
+		// Write decoded RAUs in order
+		CDecoderJob &Job = pJob[Tail];
+		Pool.Wait(&Job);
+		if (Job.m_Error)
+			result = 1;
+		if (!result)
+		{
+			Size = static_cast<unsigned int>( Job.m_Pcm.size() );
+			if ((fpOutput != NULL) && (fwrite(&Job.m_Pcm[0], 1, Size, fpOutput) != Size))
+				result = 1;
+			CRC = CombineCRC32(CRC, Job.m_Crc, Size);
+			fid += Job.m_Frames;
+		}
+		Tail = (Tail + 1) % Jobs;
+		Queued--;
+	}
+
+	Pool.Stop();
+
+	for (w = 0; w < Threads; w++)
+	{
+		// Keep only the profiles all workers conform to
+		ALS_PROFILES Lost = ConformantProfiles;
+		ALSProfDelSet(Lost, ppDecoder[w]->ConformantProfiles);
+		ALSProfDelSet(ConformantProfiles, Lost);
+		delete ppDecoder[w];
+	}
+	delete [] ppDecoder;
+	delete [] pJob;
+
+	return(result);
+}
+
+// Decode the frames of a RAU (called by worker threads)
+short CLpacDecoder::DecodeJob(CDecoderJob *pJob)
+{
+	long SampleBytes = Chan * ((SampleType == SAMPLE_TYPE_INT) ? (Res / 8) : IEEE754_BYTES_PER_SAMPLE);
+	long NN = N;
+	long f, M, Offset = 0;
+	short result = 0;
+
+	TakeInput(pJob->m_Data);
+	fid = pJob->m_Frame;
+	CRC = 0;		// partial CRC, combined by DecodeAllThreads()
+	pJob->m_Pcm.resize(pJob->m_Frames * N * SampleBytes);
+
+	for (f = 0; f < pJob->m_Frames; f++)
+	{
+		if (DecodeFrame())
+		{
+			result = 1;
+			break;
+		}
+		M = N;		// changed to N0 for the last frame
+		memcpy(&pJob->m_Pcm[Offset], bbuf, M * SampleBytes);
+		Offset += M * SampleBytes;
+	}
+	pJob->m_Pcm.resize(Offset);
+	pJob->m_Crc = CRC;
+
+	N = NN;		// restore frame length (changed for the last frame)
+
+	return(result);
+}
+
+// Job for the RLSLMS threads: prediction of one independently coded channel
+class CSynthesizeJob : public CWorkerJob
+{
+public:
+	void Run( short ) { synthesize( m_x, m_N, &m_State, m_RA, m_pMccBuf ); }
+
+	rlslms_buf_ptr	m_State;			// Predictor state (channel and mode table of the job)
+	int*			m_x;				// Residual in, samples out
+	long			m_N;				// Frame length
+	short			m_RA;				// Reset the predictors
+	MCC_DEC_BUFFER*	m_pMccBuf;
+};
+
+// Start the threads for the RLSLMS prediction. Joint stereo pairs share their
+// predictors and the mono flag, so only independently coded channels are run in parallel.
+void CLpacDecoder::StartRlsThreads()
+{
+	RlsJob = new CSynthesizeJob[Chan];
+	RlsPool = new CWorkerPool;
+	RlsPool->Start(min(static_cast<long>(Threads), Chan));
+}
+
+void CLpacDecoder::StopRlsThreads()
+{
+	if (RlsPool == NULL)
+		return;
+
+	RlsPool->Stop();
+	delete RlsPool;
+	RlsPool = NULL;
+	delete [] RlsJob;
+}
+
+// RLSLMS prediction of an independently coded channel. With threads, the prediction runs
+// while the next channel is parsed; DecodeFrame() waits for all channels at the end.
+void CLpacDecoder::SynthesizeChannel(long c, short RA)
+{
+	if (RlsPool == NULL)
+	{
+		rlslms_ptr.channel = static_cast<short>(c);
+		synthesize(x[c], N, &rlslms_ptr, RA, &MccBuf);
+		return;
+	}
+
+	CSynthesizeJob &Job = RlsJob[c];
+	Job.m_State = rlslms_ptr;
+	Job.m_State.channel = static_cast<short>(c);
+	Job.m_x = x[c];
+	Job.m_N = N;
+	Job.m_RA = RA;
+	Job.m_pMccBuf = &MccBuf;
+	RlsPool->Push(&Job);
+}
+
 unsigned int CLpacDecoder::GetCRC()
 {
 	return(CRC);
 }
 
+short CLpacDecoder::SetThreads(short Threads_x)
+{
+	if (Threads_x == 0)
+		return(Threads = CWorkerPool::GetDefaultThreads());
+	else if (Threads_x < 0)
+		return(Threads = 1);
+	else
+		return(Threads = min(Threads_x, 64));
+}
+
+// Decode RLSLMS streams of older builds (see buffer_update_legacy() in lms.cpp)
+short CLpacDecoder::SetLegacyRLSLMS(short Legacy)
+{
+	rlslms_ptr.legacy = LegacyRLSLMS = (Legacy != 0);
+	return(LegacyRLSLMS);
+}
+
 /*short CLpacDecoder::GetFrameSize()
 {
 	return(N * Chan * (IntRes / 8));
@@ -660,6 +1521,18 @@ short CLpacDecoder::DecodeFrame()
 	BYTE h, typ, flag;
 
 	int **xsave, **xtmp;
+
+	// MP4: read next MP4 frame when the current one is used up
+	if (fpMp4 && (InPos >= InLen))
+	{
+		long Frames;
+		if (ReadMp4Frame(Mp4Frame, Frames))
+			return(1);
+		TakeInput(Mp4Frame);
+	}
+	else if (FillInput())
+		return(1);
+
 	xsave = new int*[Chan];
 	xtmp = new int*[Chan];
 	
@@ -674,7 +1547,7 @@ short CLpacDecoder::DecodeFrame()
 		if (((fid - 1) % RA))	// Not first frame of RA unit
 			RAframe = 0;		// Turn off RA for current frame
 		else if (RAflag == 1)
-			ReadUIntMSBfirst(fpInput);		// read size of RAU
+			InPos += 4;		// skip size of RAU
 	}
 
 	MCCflag=0;
@@ -683,8 +1556,7 @@ short CLpacDecoder::DecodeFrame()
 		MCCflag=1;
 		if(Joint)
 		{
-			unsigned char uu;
-			fread(&uu, 1, 1, fpInput);
+			unsigned char uu = pIn[InPos++];
 			if(uu) MCCflag=0;
 			else MCCflag=1;
 		}
@@ -707,21 +1579,16 @@ short CLpacDecoder::DecodeFrame()
 			if (Sub)	// block switching enabled
 			{
 				// read block switching info
-				fread(&h1, 1, 1, fpInput);
+				h1 = pIn[InPos++];
 				if (h1 & 0x80)	// if independent block switching is indicated...
 					CBS = 0;	// ...turn off channel coupling
 				BSflags = h1 << 24;
 				if (Sub > 3)
-				{
-					fread(&h1, 1, 1, fpInput);
-					BSflags |= h1 << 16;
-				}
+					BSflags |= pIn[InPos++] << 16;
 				if (Sub > 4)
 				{
-					fread(&h1, 1, 1, fpInput);
-					BSflags |= h1 << 8;
-					fread(&h1, 1, 1, fpInput);
-					BSflags |= h1;
+					BSflags |= pIn[InPos++] << 8;
+					BSflags |= pIn[InPos++];
 				}
 
 				// get #blocks B and block lengths Nb[]
@@ -754,10 +1621,9 @@ short CLpacDecoder::DecodeFrame()
 				for (b = 0; b < B; b++)
 				{
 					// Difference method
-					fread(&h, 1, 1, fpInput);
+					h = pIn[InPos];
 					typ = h >> 6;
 					flag = h & 0x20;
-					fseek(fpInput, -1, SEEK_CUR);
 
 					if ((typ == 0x03) || ((typ < 0x02) && flag))	// Channel 1 = difference signal
 					{
@@ -784,10 +1650,9 @@ short CLpacDecoder::DecodeFrame()
 					{
 						DecodeBlock(x[c], Nb[b], RAframe && (b == 0));
 
-						fread(&h, 1, 1, fpInput);
+						h = pIn[InPos];
 						typ = h >> 6;
 						flag = h & 0x20;
-						fseek(fpInput, -1, SEEK_CUR);
 
 						if ((typ == 0x03) || ((typ < 0x02) && flag))	// Channel 2 = difference signal
 						{
@@ -854,6 +1719,9 @@ short CLpacDecoder::DecodeFrame()
 			{
 				N = N0;
 			}
+			// Independent channels with worker threads
+			if ((Threads > 1) && (RlsPool == NULL) && !Joint && (Chan > 1))
+				StartRlsThreads();
 			// Channel Pair Elements
 
 			for (cpe = 0; cpe < Chan/2; cpe++)
@@ -869,13 +1737,12 @@ short CLpacDecoder::DecodeFrame()
 						rlslms_ptr.channel=c0;
 						DecodeBlockParameter( &MccBuf, c0, N, RAframe);
 						DecodeBlockReconstructRLSLMS( &MccBuf, c0, x[c0]);
-						synthesize(x[c0], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
+						SynthesizeChannel(c0, RAframe || RLSLMS_ext==7);
 
 						rlslms_ptr.channel=c1;
 						DecodeBlockParameter( &MccBuf, c1, N, RAframe);
 						DecodeBlockReconstructRLSLMS( &MccBuf,  c1, x[c1]);
-
-						synthesize(x[c1], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
+						SynthesizeChannel(c1, RAframe || RLSLMS_ext==7);
 					}
 				}
 				else	// Joint Stereo
@@ -902,8 +1769,12 @@ short CLpacDecoder::DecodeFrame()
 				c0 = sce+2*(Chan/2);
 				DecodeBlockParameter( &MccBuf, c0, N, RAframe);
 				DecodeBlockReconstructRLSLMS( &MccBuf, c0, x[c0]);
-				rlslms_ptr.channel=c0;
-				synthesize(x[c0], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
+				SynthesizeChannel(c0, RAframe || RLSLMS_ext==7);
+			}
+			if (RlsPool)
+			{
+				for (c = 0; c < Chan; c++)
+					RlsPool->Wait(&RlsJob[c]);
 			}
 			RLSLMS_ext=0; // reset for next frame
 	}
@@ -920,19 +1791,13 @@ short CLpacDecoder::DecodeFrame()
 		if (Sub)	// block switching enabled
 		{
 			// read block switching info
-			fread(&h1, 1, 1, fpInput);
-			BSflags = h1 << 24;
+			BSflags = pIn[InPos++] << 24;
 			if (Sub > 3)
-			{
-				fread(&h1, 1, 1, fpInput);
-				BSflags |= h1 << 16;
-			}
+				BSflags |= pIn[InPos++] << 16;
 			if (Sub > 4)
 			{
-				fread(&h1, 1, 1, fpInput);
-				BSflags |= h1 << 8;
-				fread(&h1, 1, 1, fpInput);
-				BSflags |= h1;
+				BSflags |= pIn[InPos++] << 8;
+				BSflags |= pIn[InPos++];
 			}
 
 			// get #blocks B and block lengths Nb[]
@@ -1010,23 +1875,19 @@ short CLpacDecoder::DecodeFrame()
 
 		if (Res == 16)
 		{
-			if ((Write16BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 2L*Chan*N) && (fpOutput != NULL)) return(-1);
-			CRC = CalculateBlockCRC32(2L*Chan*N, CRC, (void*)bbuf);
+			if ((Write16BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput, &CRC) != 2L*Chan*N) && (fpOutput != NULL)) return(-1);
 		}
 		else if (Res == 8)
 		{
-			if ((Write8BitOffsetNM(x, Chan, N, bbuf, fpOutput) != (long)Chan*N) && (fpOutput != NULL)) return(-1);
-			CRC = CalculateBlockCRC32((long)Chan*N, CRC, (void*)bbuf);
+			if ((Write8BitOffsetNM(x, Chan, N, bbuf, fpOutput, &CRC) != (long)Chan*N) && (fpOutput != NULL)) return(-1);
 		}
 		else if (Res == 24)
 		{
-			if ((Write24BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 3L*Chan*N) && (fpOutput != NULL)) return(-1);
-			CRC = CalculateBlockCRC32(3L*Chan*N, CRC, (void*)bbuf);
+			if ((Write24BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput, &CRC) != 3L*Chan*N) && (fpOutput != NULL)) return(-1);
 		}
 		else	// Res == 32
 		{
-			if ((Write32BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 4L*Chan*N) && (fpOutput != NULL)) return(-1);
-			CRC = CalculateBlockCRC32(4L*Chan*N, CRC, (void*)bbuf);
+			if ((Write32BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput, &CRC) != 4L*Chan*N) && (fpOutput != NULL)) return(-1);
 		}
 
 		if (ChanSort)
@@ -1043,14 +1904,16 @@ short CLpacDecoder::DecodeFrame()
 		Float.ReformatData( x, N );
 
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
-		if ( !Float.DecodeDiff( fpInput, N, RAframe != 0 ) ) return -1;
+		unsigned long FloatBytes = ( InPos < InLen ) ? InLen - InPos : 0;
+		if ( !Float.DecodeDiff( pIn + InPos, FloatBytes, N, RAframe != 0 ) ) return -1;
+		InPos += FloatBytes;
 		if ( !Float.AddIEEEDiff( N ) ) return -1;
 		if ( ChanSort ) Float.ChannelSort( ChPos, false );
 		Float.ConvertFloatToRBuff( bbuf, N );
 		if ( ChanSort ) Float.ChannelSort( ChPos, true );
 
 		// Write floating point data into output file
-		if ( fwrite( bbuf, 1, N * Chan * IEEE754_BYTES_PER_SAMPLE, fpOutput ) != N * Chan * IEEE754_BYTES_PER_SAMPLE ) {
+		if ( ( fpOutput != NULL ) && ( fwrite( bbuf, 1, N * Chan * IEEE754_BYTES_PER_SAMPLE, fpOutput ) != N * Chan * IEEE754_BYTES_PER_SAMPLE ) ) {
 			// Write error
 			return -1;
 		}
@@ -1089,7 +1952,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	BYTE h, hl[4];
 	short BlockType, optP, shift = 0;
 	int c;
-	long count, bytes, i, Ns;
+	long bytes, i, Ns;
     int asi[1023];
     int parq[1023];
 	UINT u;
@@ -1140,7 +2003,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
     optP = 10;
 
 	// Read block header
-	fread(&h, 1, 1, fpInput);
+	h = pIn[InPos++];
 	BlockType = h >> 6;			// Type of block
 
 	// ZERO BLOCK
@@ -1151,7 +2014,8 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	// CONSTANT BLOCK
 	else if (BlockType == 1)
 	{
-		fread( hl, 1, ( IntRes + 7 ) / 8, fpInput );
+		memcpy( hl, pIn + InPos, ( IntRes + 7 ) / 8 );
+		InPos += ( IntRes + 7 ) / 8;
 		if ( IntRes <= 8 ) {
 			c = static_cast<int>( hl[0] ) - 128;
 		}
@@ -1176,13 +2040,8 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	// NORMAL BLOCK
 	else if (BlockType > 1)
 	{
-		fseek(fpInput, -1, SEEK_CUR);	// Go back one byte which was already read
-		// following buffer size is enough if only forward predictor is used.
-		//		count = fread(tmpbuf, 1, (((long)((IntRes+7)/8)+1)*Nb + 4*P + 128), fpInput);   // Fill input buffer
-        // for RLS-LMS
-		count = fread(tmpbuf, 1, long(IntRes/8+10) * Nb + P + 16 + 255*4, fpInput);   // Fill input buffer
-
-        in.InitBitRead(tmpbuf);
+		InPos--;	// Go back one byte which was already read
+        in.InitBitRead(pIn + InPos, InLen - InPos);
 		
 		in.ReadBits(&u, 2);		// 1J
 
@@ -1342,7 +2201,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 		if (!RLSLMS && !MCCflag)
 		{
 			bytes = in.EndBitRead();					// Number of bytes read
-			fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+			InPos += bytes;								// Set working pointer to current position
 		}
 	}
 
@@ -1350,8 +2209,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	{
 		if (BlockType<=1)
 		{
-			count = fread(tmpbuf, 1, 400, fpInput);   // Fill input buffer
-			in.InitBitRead(tmpbuf);
+			in.InitBitRead(pIn + InPos, InLen - InPos);
 		}
 		in.ReadBits(&u,1);
 		mono_frame = u;
@@ -1363,41 +2221,41 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 			//printf("%d %d ",RLSLMS_ext,optP);
 			if (RLSLMS_ext&0x01) 
 			{
-				c_mode_table.filter_len[0]=1;
+				rlslms_ptr.mode_table.filter_len[0]=1;
 				in.ReadBits(&u,4);
-				c_mode_table.filter_len[1]=(u)<<1;
+				rlslms_ptr.mode_table.filter_len[1]=(u)<<1;
 				in.ReadBits(&u,3);
-				c_mode_table.nstage=u+2;
-				for(i=2;i<c_mode_table.nstage;i++)
+				rlslms_ptr.mode_table.nstage=u+2;
+				for(i=2;i<rlslms_ptr.mode_table.nstage;i++)
 				{
 					in.ReadBits(&u,5);
-					c_mode_table.filter_len[i]=lms_order_table[u];						
+					rlslms_ptr.mode_table.filter_len[i]=lms_order_table[u];						
 				}
 			}
 			if (RLSLMS_ext&0x02)
 			{
-				if (c_mode_table.filter_len[1]){
+				if (rlslms_ptr.mode_table.filter_len[1]){
 					in.ReadBits(&u,10);
-					c_mode_table.lambda[0]=u;
+					rlslms_ptr.mode_table.lambda[0]=u;
 					in.ReadBits(&u,10);
-					c_mode_table.lambda[1]=u;
+					rlslms_ptr.mode_table.lambda[1]=u;
 				}
 			}
 			if (RLSLMS_ext&0x04)
 			{
-				for(i=2;i<c_mode_table.nstage;i++)
+				for(i=2;i<rlslms_ptr.mode_table.nstage;i++)
 				{
 					in.ReadBits(&u,5);
-					c_mode_table.opt_mu[i]=mu_table[u];
+					rlslms_ptr.mode_table.opt_mu[i]=mu_table[u];
 				}
 				in.ReadBits(&u,3);
-				c_mode_table.step_size=u*LMS_MU_INT;
+				rlslms_ptr.mode_table.step_size=u*LMS_MU_INT;
 			}
 		}
 		if(!MCCflag)
 		{
 			bytes = in.EndBitRead();					// Number of bytes read
-			fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+			InPos += bytes;								// Set working pointer to current position
 		}
 	}
 
@@ -1406,8 +2264,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	{
 		if ( (BlockType<=1) && !RLSLMS)
 		{
-			count = fread(tmpbuf, 1, 256, fpInput);   // Fill input buffer
-			in.InitBitRead(tmpbuf);
+			in.InitBitRead(pIn + InPos, InLen - InPos);
 		}
 
 		for (oaa = 0; oaa < OAA+1; oaa++)
@@ -1463,7 +2320,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 		}
 		CheckAlsProfiles_MCCStages(ConformantProfiles, oaa);
 		bytes = in.EndBitRead();					// Number of bytes read
-		fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+		InPos += bytes;								// Set working pointer to current position
 	}
 }
 
@@ -1582,18 +2439,6 @@ short CLpacDecoder::DecodeBlockReconstructRLSLMS(MCC_DEC_BUFFER *pBuffer, long C
 	return(0);
 }
 
-bool	CLpacDecoder::CopyData( const char* pFilename, ALS_UINT64 Offset, ALS_UINT64 Size, HALSSTREAM hOutFile )
-{
-	HALSSTREAM	hInFile = NULL;
-	bool		Result = false;
-	if ( OpenFileReader( pFilename, &hInFile ) == 0 ) {
-		fseek( hInFile, Offset, SEEK_SET );
-		Result = CopyData( hInFile, Size, hOutFile );
-		fclose( hInFile );
-	}
-	return Result;
-}
-
 bool	CLpacDecoder::CopyData( HALSSTREAM hInFile, ALS_UINT64 Size, HALSSTREAM hOutFile )
 {
 	const ALS_UINT32	COPYDATA_BUFSIZE = 1048576;
@@ -1608,7 +2453,7 @@ bool	CLpacDecoder::CopyData( HALSSTREAM hInFile, ALS_UINT64 Size, HALSSTREAM hOu
 	while( Size > 0 ) {
 		CopySize = ( Size < COPYDATA_BUFSIZE ) ? static_cast<ALS_UINT32>( Size ) : COPYDATA_BUFSIZE;
 		if ( fread( pBuffer, 1, CopySize, hInFile ) != CopySize ) break;
-		if ( fwrite( pBuffer, 1, CopySize, hOutFile ) != CopySize ) break;
+		if ( ( hOutFile != NULL ) && ( fwrite( pBuffer, 1, CopySize, hOutFile ) != CopySize ) ) break;
 		Size -= CopySize;
 	}
 	delete[] pBuffer;
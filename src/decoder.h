@@ -90,6 +90,8 @@ contents : Header file for decoder.cpp
  ************************************************************************/
 
 #include <stdio.h>
+#include <string>
+#include <vector>
 
 #include "wave.h"
 #include "floating.h"
@@ -98,9 +100,16 @@ contents : Header file for decoder.cpp
 #include "stream.h"
 #include "als2mp4.h"
 #include "profiles.h"
+#include "Mp4aFile.h"
+
+class CDecoderJob;
+class CSynthesizeJob;
+class CWorkerPool;
 
 class CLpacDecoder
 {
+	friend class CDecoderJob;
+
 protected:
 	long N;					// Frame length
 	short P;				// (Max.) Predictor order
@@ -154,8 +163,23 @@ protected:
 	bool		CloseInput;		// true: Need to close fpInput.
 	bool		CloseOutput;	// true: Need to close fpOutput.
 	bool		mp4file;		// true:MP4 file format / false:ALS file format
-
-	unsigned char *bbuf, *tmpbuf;
+	HALSSTREAM	fpMp4;			// MP4 input file (fpInput reads ALSSpecificConfig)
+	bool		CloseMp4;		// true: Need to close fpMp4.
+	CAlsStream	Mp4Stream;		// fpMp4 as stream for Mp4Reader
+	NAlsImf::CMp4aReader Mp4Reader;	// MP4 file reader
+	std::vector<unsigned char> Mp4Frame;	// Buffer for reading MP4 frames (RAUs)
+	ALS_UINT32	Mp4FrameId;		// Next MP4 frame to read
+	std::string	IndexName;		// Seek index file (ALS file name + ".idx")
+	std::vector<ALS_INT64> RAUpos;	// RAU positions from the seek index (+ end of last frame)
+
+	unsigned char *bbuf;
+	std::vector<unsigned char> InBuf;	// Input buffer (frames are parsed from memory)
+	unsigned char *pIn;		// Input data: InBuf, or mapped input file
+	long InPos;				// Read position in pIn
+	long InLen;				// Number of valid bytes in pIn
+	long InSlack;			// Max. size of a frame (zero bytes behind InLen at the end)
+	bool InEof;				// true: no more data for InBuf from fpInput
+	bool InMapped;			// true: pIn points into the mapped input file
 	int **x, **xp, *d, *cofQ;
 
 	CFloat			Float;		// Floating point class
@@ -168,30 +192,56 @@ protected:
 
 	ALS_PROFILES ConformantProfiles;
 
+	short Threads;				// Number of decoder threads
+	CWorkerPool *RlsPool;		// Threads for the RLSLMS prediction of independent channels (NULL: serial)
+	CSynthesizeJob *RlsJob;		// RLSLMS prediction [channel]
+	short LegacyRLSLMS;			// RLSLMS history update of older builds
+
 public:
 	short MCCflag;				// Multi-channel correlation
 	CLpacDecoder();				// Constructor
 	~CLpacDecoder();			// Destructor
 	short CloseFiles();
-	short OpenInputFile( const char *name, bool mp4 ) { mp4file = mp4; CloseInput = ( OpenFileReader( name, &fpInput ) == 0 ); ALSProfFillSet(ConformantProfiles); return CloseInput ? 0 : 1; }
-	short SetInputStream( HALSSTREAM hStream, bool mp4 ) { mp4file = mp4; fpInput = hStream; CloseInput = false; ALSProfFillSet(ConformantProfiles); return 0; }
-	short AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const MP4INFO& Mp4Info);
+	short OpenInputFile( const char *name, bool mp4 );
+	short SetInputStream( HALSSTREAM hStream, bool mp4 );
+	short AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, MP4INFO& Mp4Info);
 	short OpenOutputFile( const char *name ) { CloseOutput = ( OpenFileWriter( name, &fpOutput ) == 0 ); return CloseOutput ? 0 : 1; }
 	short SetOutputStream( HALSSTREAM hStream ) { fpOutput = hStream; CloseOutput = false; return 0; }
 	ALS_INT64 WriteHeader( const MP4INFO& Mp4Info );
 	ALS_INT64 WriteTrailer( const MP4INFO& Mp4Info );
 	short DecodeAll( const MP4INFO& Mp4Info );
+	short DecodeRange( ALS_INT64 Start, ALS_INT64 Length );	// Decode some samples only
+	long BuildIndex();			// Build or update the seek index
 	short DecodeFrame();		// Decode one frame
 	unsigned int GetCRC();
+	short SetThreads(short Threads);
+	short SetLegacyRLSLMS(short Legacy);
 	ALS_PROFILES GetConformantProfiles() const { return ConformantProfiles; }
 
 protected:
+	void AllocateBuffers();
+	ALS_INT64 ReadFrameInfo();								// Read info between header and frames
+	short SeekRAU(ALS_INT64 Frame);							// Go to the RAU containing Frame
+	void LoadIndex(ALS_INT64 FrameStart);					// Read the seek index
+	short SaveIndex();										// Write the seek index
+	short InputCRC(ALS_INT64 Pos, ALS_INT64 Bytes, unsigned int &Crc);	// CRC of input file bytes (seek index checks)
+	void CopyParameters(const CLpacDecoder &Dec);
+	short DecodeAllThreads();								// Decode RAUs in parallel
+	short OpenMp4(MP4INFO &Mp4Info);						// Read MP4 headers and ALSSpecificConfig
+	short ReadMp4Frame(std::vector<unsigned char> &Data, long &Frames);	// Read next MP4 frame
+	void ResetInput();										// Discard buffered input
+	void TakeInput(std::vector<unsigned char> &Data);		// Parse frames from Data
+	short FillInput();										// Buffer (at least) a whole frame
+	ALS_INT64 TellInput();									// Position of InPos in fpInput
+	short DecodeJob(CDecoderJob *pJob);
+	void StartRlsThreads();								// Start threads for the RLSLMS prediction of independent channels
+	void StopRlsThreads();
+	void SynthesizeChannel(long c, short RA);
 	short DecodeBlock(int *x, long Nb, short ra);			// Decode one block
 	void  DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, long Nb, short ra);
 	short DecodeBlockReconstruct(MCC_DEC_BUFFER *pBuffer, long Channel, int *x, long Nb, short ra);
 	void  DecodeBlockParameterRLSLMS(MCC_DEC_BUFFER *pBuffer, long Channel);
 	short DecodeBlockReconstructRLSLMS(MCC_DEC_BUFFER *pBuffer, long Channel, int *x);
-	bool CopyData( const char* pFilename, ALS_UINT64 Offset, ALS_UINT64 Size, HALSSTREAM hOutFile );
 	bool CopyData( HALSSTREAM hInFile, ALS_UINT64 Size, HALSSTREAM hOutFile );
 };
 
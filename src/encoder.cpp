@@ -261,6 +261,8 @@ contents : Implementation of the CLpacEncoder class
 #include "lpc_adapt.h"
 #include "mcc.h"
 #include "stream.h"
+#include "workers.h"
+#include "als2mp4.h"
 
 #define PI 3.14159265359
 
@@ -285,6 +287,7 @@ CLpacEncoder::CLpacEncoder()
 {
 	fpInput = NULL;
 	fpOutput = NULL;
+	fpMp4 = NULL;
 
 	N = 0;			// Automatic choice of frame length
 	P = 10;			// 10th order filter
@@ -318,10 +321,15 @@ CLpacEncoder::CLpacEncoder()
 	ChanConfig = 0;	// Channel configuration = off
 	CRCenabled = 1;	// CRC = on
 	ChPos = NULL;	// No channel sorting table defined
-	CloseInput = CloseOutput = false;
+	CloseInput = CloseOutput = CloseMp4 = false;
 	frames = 0;
 	mp4file = false;
 	oafi_flag = false;
+	Mp4Pli = true;	// Indicate audio profile level
+	ra_bytes = 0;	// No RAU written yet
+	Threads = 1;	// Single-threaded encoding
+	LevelPool = NULL;	// Serial block switching search
+	RlsPool = NULL;		// Serial RLSLMS prediction
 
 	ALSProfFillSet( ConformantProfiles );
 	ALSProfEmptySet( EnforcedProfiles );
@@ -333,6 +341,9 @@ CLpacEncoder::~CLpacEncoder()
 {
 	long i;
 
+	StopLevelThreads();
+	StopRlsThreads();
+
 	if (frames > 0)
 	{
 		// Deallocate memory
@@ -347,9 +358,12 @@ CLpacEncoder::~CLpacEncoder()
 			{
 				delete [] rlslms_ptr.pbuf[i];
 				delete [] rlslms_ptr.weight[i];
+				delete [] rlslms_ptr.Pmatrix[i];
 			}
 			delete [] rlslms_ptr.pbuf;
 			delete [] rlslms_ptr.weight;
+			delete [] rlslms_ptr.Pmatrix;
+			delete [] rlslms_ptr.bufpos;
 		}
 
 		delete [] tmpbuf1;
@@ -392,6 +406,7 @@ CLpacEncoder::~CLpacEncoder()
 			delete [] tmpbuf_MCC[i];
 		delete [] tmpbuf_MCC;
 		delete [] buffer_m;
+		delete [] fbuf;
 	}
 
 	// Close files
@@ -413,6 +428,48 @@ short CLpacEncoder::CloseFiles()
 		fpOutput = NULL;
 		CloseOutput = false;
 	}
+
+	if ( fpMp4 ) {
+		if ( CloseMp4 ) fclose( fpMp4 );
+		fpMp4 = NULL;
+		CloseMp4 = false;
+	}
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Open output file
+short CLpacEncoder::OpenOutputFile( const char *name, bool mp4, bool oafi )
+{
+	HALSSTREAM hStream;
+
+	if ( OpenFileWriter( name, &hStream ) ) return 1;
+	if ( SetOutputFile( hStream, mp4, oafi ) ) {
+		fclose( hStream );
+		return 1;
+	}
+	if ( mp4file ) CloseMp4 = true;
+	else CloseOutput = true;
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Set output stream
+// For MP4, the frames are written to hStream by Mp4Writer, while the ALS header is
+// assembled in memory and stored as ALSSpecificConfig at the end (see CloseMp4File()).
+short CLpacEncoder::SetOutputFile( HALSSTREAM hStream, bool mp4, bool oafi )
+{
+	mp4file = mp4;
+	oafi_flag = oafi;
+	if ( mp4file ) {
+		if ( OpenMemoryWriter( &fpOutput ) ) return 1;
+		CloseOutput = true;
+		fpMp4 = hStream;
+		CloseMp4 = false;
+	} else {
+		fpOutput = hStream;
+		CloseOutput = false;
+	}
 	return 0;
 }
 
@@ -421,7 +478,7 @@ short CLpacEncoder::CloseFiles()
 void CLpacEncoder::GetFilePositions(ALS_INT64 *SizeIn, ALS_INT64 *SizeOut)
 {
 	*SizeIn = ftell(fpInput);
-	*SizeOut = ftell(fpOutput);
+	*SizeOut = ftell(mp4file ? fpMp4 : fpOutput);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -587,6 +644,154 @@ short CLpacEncoder::SpecifyAudioInfo(AUDIOINFO *ainfo)
 	return(0);
 };
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocate buffers for encoding (will be deallocated by the destructor)
+void CLpacEncoder::AllocateBuffers()
+{
+	long i;
+
+	xp = new int*[Chan];
+	x = new int*[Chan];
+	for (i = 0; i < Chan; i++ )
+	{
+		xp[i] = new int[N+P];
+		x[i] = xp[i] + P;
+		memset(xp[i], 0, sizeof(int)*P);
+	}
+
+	if (RLSLMS)
+	{
+		rlslms_ptr.pbuf = new BUF_TYPE*[Chan];
+		rlslms_ptr.weight = new W_TYPE*[Chan];
+		rlslms_ptr.Pmatrix = new P_TYPE*[Chan];
+		rlslms_ptr.bufpos = new short[Chan][MAX_STAGES];
+		for (i = 0; i < Chan; i++ )
+		{
+			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_BUF_LEN];
+			rlslms_ptr.weight[i] = new W_TYPE[TOTAL_LMS_LEN];
+			rlslms_ptr.Pmatrix[i] = new P_TYPE[JS_LEN*JS_LEN];
+		}
+		memset(&rlslms_ptr.mode_table, 0, sizeof(mtable));
+		rlslms_ptr.old_flag = 0;
+		rlslms_ptr.legacy = 0;
+	}
+
+	// following buffer size is enough if only forward predictor is used.
+	// //(long)((IntRes+7)/8) = ceil(IntRes/8)
+	//	long BufSize = ((long)((IntRes+7)/8)+1)*N + (4*P + 128)*(1+(1<<Sub));
+	// for RLS-LMS
+	long BufSize = long(IntRes/8+10)*N*2;
+
+	tmpbuf1 = new unsigned char[BufSize];				// Buffer for one channel
+
+	if (CPE)
+	{
+		tmpbuf2 = new unsigned char[BufSize];			// Buffer for another channel
+
+		if (Joint)
+		{
+			xps = new int*[CPE];
+			xs = new int*[CPE];
+
+			for (i = 0; i < CPE; i++)
+			{
+				xps[i] = new int[N+P];
+				xs[i] = xps[i] + P;
+				memset(xps[i], 0, sizeof(int)*P);
+			}
+
+			tmpbuf3 = new unsigned char[BufSize];		// Buffer for a difference channel
+		}
+	}
+
+	bbuf = new unsigned char[BufSize * Chan];	// Input buffer
+
+	// Allocate float buffer
+	if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.AllocateBuffer( Chan, N, IntRes );
+	
+	// Allocate MCC buffer
+	if (Freq >= 192000L)
+		NeedTdBit = 7;
+	else if (Freq >= 96000L)
+		NeedTdBit = 6;
+	else
+		NeedTdBit = 5;
+
+	AllocateMccEncBuffer( &MccBuf, Chan, N, IntRes,(1<<NeedTdBit));
+
+	// #bits/channel: NeedPuchBit = max(1,ceil(log2(Chan)))
+	i = (Chan > 1) ? (Chan-1) : 1;
+	NeedPuchBit = 0;
+	while(i){
+		i /= 2;
+		NeedPuchBit++;
+	}
+	
+	tmpbuf_MCC = new unsigned char*[Chan];
+	for(i = 0; i < Chan; i++)
+		tmpbuf_MCC[i] = new unsigned char[BufSize];
+	buffer_m = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100];
+
+	d = new int[N];											// Difference signal (residual)
+	par = new double[P];										// Coefficients (parcor)
+	cof = new int[P];											// Coefficients (direct form, quantized)
+	// Frame buffer for all channels
+	buffer[0] = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100];					
+	
+	for (short s = 1; s <= Sub; s++)
+		buffer[s] = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100]; // Frame buffer for all channel (subblock)
+
+	// Output buffer for one frame (JS/MCC switch, frame data and float difference data)
+	fbuf = new unsigned char[2 * (4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100) + 5];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Copy finalized encoder parameters (used to set up the encoders of worker threads)
+void CLpacEncoder::CopyParameters(const CLpacEncoder &Enc)
+{
+	N = Enc.N;
+	P = Enc.P;
+	Adapt = Enc.Adapt;
+	Win = Enc.Win;
+	Joint = Enc.Joint;
+	RA = Enc.RA;
+	LSBcheck = Enc.LSBcheck;
+	BGMC = Enc.BGMC;
+	MCC = Enc.MCC;
+	MCCnoJS = Enc.MCCnoJS;
+	RLSLMS = Enc.RLSLMS;
+	PITCH = Enc.PITCH;
+	Sub = Enc.Sub;
+	AcfMode = Enc.AcfMode;
+	AcfGain = Enc.AcfGain;
+	MlzMode = Enc.MlzMode;
+	FileType = Enc.FileType;
+	MSBfirst = Enc.MSBfirst;
+	Chan = Enc.Chan;
+	Res = Enc.Res;
+	IntRes = Enc.IntRes;
+	SampleType = Enc.SampleType;
+	Samples = Enc.Samples;
+	Freq = Enc.Freq;
+	frames = Enc.frames;
+	N0 = Enc.N0;
+	Q = Enc.Q;
+	CPE = Enc.CPE;
+	SCE = Enc.SCE;
+	ChanSort = Enc.ChanSort;
+	if (ChanSort)
+	{
+		ChPos = new unsigned short[Chan];
+		memcpy(ChPos, Enc.ChPos, Chan * sizeof(unsigned short));
+	}
+	CoefTable = Enc.CoefTable;
+	SBpart = Enc.SBpart;
+	RAflag = Enc.RAflag;
+	CRCenabled = 0;
+	RAUsize = NULL;
+	buff = NULL;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Generate and write header
 ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
@@ -600,10 +805,6 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	short AUXenabled = 0;	// set AUXenabled = 0 not to generate aux data (see below)
 #endif
 
-#ifndef	LPC_ADAPT
-	Adapt = 0;
-#endif
-
 	// Enfore profiles for all parameters that are finalized
 	if (!EnforceProfiles())
 		return -1;
@@ -696,87 +897,8 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	}
 
 	// Allocate memory (will be deallocated by the destructor)
-	xp = new int*[Chan];
-	x = new int*[Chan];
-	for (i = 0; i < Chan; i++ )
-	{
-		xp[i] = new int[N+P];
-		x[i] = xp[i] + P;
-		memset(xp[i], 0, sizeof(int)*P);
-	}
-
-	if (RLSLMS)
-	{
-		rlslms_ptr.pbuf = new BUF_TYPE*[Chan];
-		rlslms_ptr.weight = new W_TYPE*[Chan];
-		rlslms_ptr.Pmatrix = new P_TYPE*[Chan];
-		for (i = 0; i < Chan; i++ )
-		{
-			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_LMS_LEN];
-			rlslms_ptr.weight[i] = new W_TYPE[TOTAL_LMS_LEN];
-			rlslms_ptr.Pmatrix[i] = new P_TYPE[JS_LEN*JS_LEN];
-		}
-	}
-
-	// following buffer size is enough if only forward predictor is used.
-	// //(long)((IntRes+7)/8) = ceil(IntRes/8)
-	//	long BufSize = ((long)((IntRes+7)/8)+1)*N + (4*P + 128)*(1+(1<<Sub));
-	// for RLS-LMS
-	long BufSize = long(IntRes/8+10)*N*2;
-
-	tmpbuf1 = new unsigned char[BufSize];				// Buffer for one channel
-
-	if (CPE)
-	{
-		tmpbuf2 = new unsigned char[BufSize];			// Buffer for another channel
-
-		if (Joint)
-		{
-			xps = new int*[CPE];
-			xs = new int*[CPE];
-
-			for (i = 0; i < CPE; i++)
-			{
-				xps[i] = new int[N+P];
-				xs[i] = xps[i] + P;
-				memset(xps[i], 0, sizeof(int)*P);
-			}
-
-			tmpbuf3 = new unsigned char[BufSize];		// Buffer for a difference channel
-		}
-	}
-
-	bbuf = new unsigned char[BufSize * Chan];	// Input buffer
-
-	// Allocate float buffer
-	if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.AllocateBuffer( Chan, N, IntRes );
-	
-	// Allocate MCC buffer
-	if (Freq >= 192000L)
-		NeedTdBit = 7;
-	else if (Freq >= 96000L)
-		NeedTdBit = 6;
-	else
-		NeedTdBit = 5;
-
-	AllocateMccEncBuffer( &MccBuf, Chan, N, IntRes,(1<<NeedTdBit));
-
-	// #bits/channel: NeedPuchBit = max(1,ceil(log2(Chan)))
-	i = (Chan > 1) ? (Chan-1) : 1;
-	NeedPuchBit = 0;
-	while(i){
-		i /= 2;
-		NeedPuchBit++;
-	}
-	
-	tmpbuf_MCC = new unsigned char*[Chan];
-	for(i = 0; i < Chan; i++)
-		tmpbuf_MCC[i] = new unsigned char[BufSize];
-	buffer_m = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100];
+	AllocateBuffers();
 
-	d = new int[N];											// Difference signal (residual)
-	par = new double[P];										// Coefficients (parcor)
-	cof = new int[P];											// Coefficients (direct form, quantized)
 	size_t buff_size = ( NeedPuchBit * Chan ) / 8 + 1;
 	if ( buff_size < 4 ) buff_size = 4;
 	if ( !mp4file ) {
@@ -791,12 +913,6 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	buff = new unsigned char[ buff_size ];		// Buffer for audio header/trailer and ChanPos[]
 	if ( buff == NULL ) return ( frames = -7 );	// Memory error
 
-	// Frame buffer for all channels
-	buffer[0] = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100];					
-	
-	for (short s = 1; s <= Sub; s++)
-		buffer[s] = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100]; // Frame buffer for all channel (subblock)
-
 	short SubX = Sub;	// Index for block switching level
 	if (Sub)
 		SubX = (Sub < 3) ? 1 : Sub - 2;
@@ -821,16 +937,26 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 
 	if (RLSLMS)
 	{
-		initCoefTable(RLSLMS, CoefTable);
+		initCoefTable(&rlslms_ptr, RLSLMS, CoefTable);
 		RLSLMS_ext = 7;
 		for(i=0;i<Chan;i++)
 		{
-			for(j=0;j<TOTAL_LMS_LEN;j++) rlslms_ptr.pbuf[i][j]=0;
+			for(j=0;j<TOTAL_BUF_LEN;j++) rlslms_ptr.pbuf[i][j]=0;
 			rlslms_ptr.channel=i;
 			predict_init(&rlslms_ptr); 
 		}
 	}
 
+	if ( mp4file ) {
+		// The frames are written directly to the MP4 file, so the size of the mdat
+		// box is not known yet. Estimate it from the PCM size with some margin.
+		ALS_INT64 MaxSize = Samples * Chan * ( Res / 8 ) / 8 * 9 + HeaderSize + TrailerSize + 0x100000;
+		Mp4Stream.Attach( fpMp4 );
+		Mp4Samples = 0;
+		if ( !Mp4Writer.Open( Mp4Stream, Freq, static_cast<NAlsImf::IMF_UINT16>( Chan ), Res, static_cast<NAlsImf::IMF_UINT8>( FileType ), NULL, 0, MaxSize > 0xffffffff, oafi_flag ) )
+			return ( frames = -2 );
+	}
+
 	// Write ALS header information ///////////////////////////////////////////////////////////////
 	UINT als_id;
 	als_id = 0x414C5300UL;
@@ -889,8 +1015,8 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	}
 
 	if ( oafi_flag ) {
-		// Skip file header
-		fseek( fpInput, HeaderSize, SEEK_CUR );
+		// Copy file header to the MP4 file
+		if ( CopyMp4Data( HeaderSize, false ) ) return ( frames = -2 );
 	} else {
 		// copy audio file header (if present)
 		fread( buff, 1, static_cast<ALS_UINT32>( HeaderSize ), fpInput );
@@ -971,7 +1097,7 @@ ALS_INT64 CLpacEncoder::WriteTrailer()
 	fseek(fpOutput, FilePos, SEEK_SET);
 	
 	if ( oafi_flag ) {
-		fseek( fpInput, TrailerSize, SEEK_CUR );
+		if ( CopyMp4Data( TrailerSize, true ) ) return ( frames = -1 );
 	} else {
 		fread( buff, 1, static_cast<ALS_UINT32>( TrailerSize ), fpInput );
 		if ( fwrite( buff, 1, static_cast<ALS_UINT32>( TrailerSize ), fpOutput ) != static_cast<ALS_UINT32>( TrailerSize ) ) return ( frames = -1 );
@@ -991,9 +1117,69 @@ ALS_INT64 CLpacEncoder::WriteTrailer()
 
 	fseek(fpOutput, 0, SEEK_END);
 
+	if ( mp4file && CloseMp4File() )
+		return ( frames = -1 );
+
+	// Report pending write errors
+	if ( fflush( mp4file ? fpMp4 : fpOutput ) != 0 )
+		return ( frames = -1 );
+
 	return TrailerSize;
 };
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Copy non-audio data of the input file to the MP4 file (oafi)
+short CLpacEncoder::CopyMp4Data(ALS_INT64 Size, bool Trailer)
+{
+	const ALS_UINT32 BufSize = 65536;
+	unsigned char *pBuf = new unsigned char[BufSize];
+	ALS_UINT32 Len;
+
+	while (Size > 0)
+	{
+		Len = static_cast<ALS_UINT32>( min(Size, static_cast<ALS_INT64>( BufSize )) );
+		if (fread(pBuf, 1, Len, fpInput) != Len)
+			break;
+		if (!(Trailer ? Mp4Writer.WriteTrailer(pBuf, Len) : Mp4Writer.WriteHeader(pBuf, Len)))
+			break;
+		Size -= Len;
+	}
+	delete [] pBuf;
+
+	return (Size > 0) ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Complete the MP4 file
+// The ALS header in fpOutput is converted to ALSSpecificConfig the same way as als2mp4 does.
+short CLpacEncoder::CloseMp4File()
+{
+	ALS_HEADER AlsHeader;
+	MP4INFO Mp4Info;
+	CAlsStream Header( fpOutput );
+	short result = 0;
+
+	memset( &AlsHeader, 0, sizeof(AlsHeader) );
+	Mp4Info.m_RMflag = true;
+	Mp4Info.m_Samples = Samples;
+	Mp4Info.m_FileType = static_cast<NAlsImf::IMF_UINT8>( FileType );
+
+	try {
+		ReadAlsHeaderFromStream( Header, &AlsHeader, Mp4Info );
+		if ( !Mp4Writer.SetDecSpecInfo( AlsHeader.m_pALSSpecificConfig, AlsHeader.m_ALSSpecificConfigSize ) ) throw A2MERR_NO_MEMORY;
+		if ( ( AlsHeader.m_AuxSize > 0 ) && !Mp4Writer.WriteAuxData( AlsHeader.m_pAuxData, AlsHeader.m_AuxSize ) ) throw A2MERR_WRITE_AUXDATA;
+		if ( Mp4Pli && ALSProfIsMember( ConformantProfiles, ALS_SIMPLE_PROFILE_L1 ) )
+			Mp4Writer.SetAudioProfileLevelIndication( MP4_AUDIO_PROFILE_ALS_SP_L1 );
+		if ( !Mp4Writer.Close() ) throw A2MERR_WRITE_MOOV;
+	}
+	catch( A2MERR ) {
+		result = 1;
+	}
+	ClearAlsHeader( &AlsHeader );
+
+	return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Generate and write header, encoded audio, and trailing non-audio data
 short CLpacEncoder::EncodeAll()
@@ -1001,19 +1187,540 @@ short CLpacEncoder::EncodeAll()
 	long f;
 	ENCINFO encinfo;
 
-	if ((frames = WriteHeader(&encinfo)) < 0)
-		return static_cast<short>( frames );
+	if ((frames = WriteHeader(&encinfo)) < 0)
+		return static_cast<short>( frames );
+
+	// Frames are independent apart from the prediction history, except for
+	// RLSLMS (not re-entrant), MCC (gains of the previous block are reused)
+	// and floating-point data (only RAUs are independent)
+	// If there are fewer frames than threads, the frames are encoded one by one
+	// and the block switching search of each frame uses the threads instead.
+	ALS_INT64 Units = ((SampleType == SAMPLE_TYPE_INT) || !RA) ? frames : (frames + RA - 1) / RA;
+	if ((Threads > 1) && !RLSLMS && !MCC && ((SampleType == SAMPLE_TYPE_INT) || RA) && (Units >= Threads))
+	{
+		if (EncodeAllThreads())
+			return(-2);
+	}
+	else
+	{
+		for (f = 0; f < frames; f++)
+		{
+			if (EncodeFrame())
+				return(-2);
+		}
+	}
+
+	if (WriteTrailer() < 0)
+		return(-2);
+
+	return(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Job for the worker threads: a run of frames, starting with the history of the first frame
+class CEncoderJob : public CWorkerJob
+{
+public:
+	CEncoderJob() : m_ppEncoder( NULL ), m_pPcm( NULL ), m_Error( 0 ) {}
+	~CEncoderJob() { delete [] m_pPcm; }
+	void Run( short Worker ) { m_Error = m_ppEncoder[Worker]->EncodeJob( this ); }
+
+	CLpacEncoder**	m_ppEncoder;		// Encoder of each worker thread
+	ALS_INT64		m_Frame;			// Number of frames before this job
+	long			m_Frames;			// Number of frames
+	long			m_History;			// Number of history samples in front of audio data
+	unsigned char*	m_pPcm;				// Audio data (history and frames)
+	std::vector<unsigned char>	m_Data;	// Encoded frames
+	std::vector<long>			m_Bytes;// Bytes per encoded frame
+	long			m_CrcBytes;			// Bytes of audio data covered by m_Crc (0: no CRC)
+	unsigned int	m_Crc;				// CRC of the audio data after the history (starting with 0)
+	short			m_Error;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encode all frames using worker threads
+// The input is read and the output is written by the calling thread, and the
+// partial CRCs of the jobs are combined in order, so that the CRC, random access
+// info and the output are identical to EncodeFrame().
+short CLpacEncoder::EncodeAllThreads()
+{
+	long SampleBytes = Chan * ((SampleType == SAMPLE_TYPE_INT) ? (Res / 8) : sizeof(float));
+	long Span = (SampleType == SAMPLE_TYPE_INT) ? 1 : RA;		// Frames per job (float: RAU)
+	long History = (SampleType == SAMPLE_TYPE_INT) ? P : 0;		// Prediction history (samples)
+	long Jobs = 2 * Threads;									// Jobs in flight
+	long Carry = 0;												// History available for next job
+	long Head = 0, Tail = 0, Queued = 0;
+	ALS_INT64 Read = 0;
+	long w, f, Len, Keep, Offset;
+	short result = 0;
+
+	CWorkerPool Pool;
+	CLpacEncoder **ppEncoder = new CLpacEncoder*[Threads];
+	CEncoderJob *pJob = new CEncoderJob[Jobs];
+	unsigned char *pCarry = new unsigned char[History * SampleBytes + 1];
+
+	for (w = 0; w < Threads; w++)
+	{
+		ppEncoder[w] = new CLpacEncoder;
+		ppEncoder[w]->CopyParameters(*this);
+		ppEncoder[w]->AllocateBuffers();
+	}
+	for (w = 0; w < Jobs; w++)
+	{
+		pJob[w].m_ppEncoder = ppEncoder;
+		pJob[w].m_pPcm = new unsigned char[(History + Span * N) * SampleBytes];
+	}
+
+	Pool.Start(Threads);
+
+	for (;;)
+	{
+		// Read audio data and queue jobs
+		while (!result && (Queued < Jobs) && (Read < frames))
+		{
+			CEncoderJob &Job = pJob[Head];
+
+			Job.m_Frame = Read;
+			Job.m_Frames = static_cast<long>( min(Span, frames - Read) );
+			Job.m_History = Carry;
+			Len = Job.m_Frames * N;
+			if (Read + Job.m_Frames == frames)		// Last frame
+				Len += N0 - N;
+
+			memcpy(Job.m_pPcm, pCarry, Carry * SampleBytes);
+			fread(Job.m_pPcm + Carry * SampleBytes, 1, Len * SampleBytes, fpInput);
+			Job.m_CrcBytes = CRCenabled ? Len * SampleBytes : 0;
+
+			// Last samples are the history of the next job
+			Keep = min(History, Carry + Len);
+			memcpy(pCarry, Job.m_pPcm + (Carry + Len - Keep) * SampleBytes, Keep * SampleBytes);
+			Carry = Keep;
+
+			Pool.Push(&Job);
+			Read += Job.m_Frames;
+			Head = (Head + 1) % Jobs;
+			Queued++;
+		}
+
+		if (!Queued)
+			break;
+
+		// Write encoded frames in order
+		CEncoderJob &Job = pJob[Tail];
+		Pool.Wait(&Job);
+		if (Job.m_Error)
+			result = 1;
+		if (CRCenabled)
+			CRC = CombineCRC32(CRC, Job.m_Crc, Job.m_CrcBytes);
+		for (f = 0, Offset = 0; !result && (f < Job.m_Frames); f++)
+		{
+			fid++;
+			if (WriteFrame(&Job.m_Data[Offset], Job.m_Bytes[f]))
+				result = 1;
+			Offset += Job.m_Bytes[f];
+		}
+		Tail = (Tail + 1) % Jobs;
+		Queued--;
+	}
+
+	Pool.Stop();
+
+	for (w = 0; w < Threads; w++)
+		delete ppEncoder[w];
+	delete [] ppEncoder;
+	delete [] pJob;
+	delete [] pCarry;
+
+	return(result);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encode the frames of a job (called by worker threads)
+short CLpacEncoder::EncodeJob(CEncoderJob *pJob)
+{
+	long SampleBytes = Chan * ((SampleType == SAMPLE_TYPE_INT) ? (Res / 8) : sizeof(float));
+	unsigned char *pcm = pJob->m_pPcm;
+	long H = pJob->m_History;
+	long NN = N;
+	long f, c, c0, c1, cpe, i, M, bytes;
+	short result = 0;
+	int **xh = new int*[Chan];
+
+	fid = pJob->m_Frame;
+	pJob->m_Data.clear();
+	pJob->m_Bytes.clear();
+
+	// Restore the last P samples in front of the first frame (zero before the first frame)
+	for (c = 0; c < Chan; c++)
+	{
+		memset(xp[c], 0, (P - H) * sizeof(int));
+		xh[c] = x[c] - H;
+	}
+	ReadSamples(xh, H, pcm, NULL);
+	pcm += H * SampleBytes;
+	pJob->m_Crc = 0;		// partial CRC of the frames, combined by EncodeAllThreads()
+	if (Joint)
+	{
+		for (cpe = 0; cpe < CPE; cpe++)
+		{
+			c0 = ChanSort ? ChPos[2*cpe] : 2*cpe;
+			c1 = ChanSort ? ChPos[2*cpe+1] : 2*cpe+1;
+			for (i = -P; i < 0; i++)
+				xs[cpe][i] = x[c1][i] - x[c0][i];
+		}
+	}
+
+	for (f = 0; f < pJob->m_Frames; f++)
+	{
+		M = (fid + 1 == frames) ? N0 : N;
+		ReadSamples(x, M, pcm, NULL, pJob->m_CrcBytes ? &pJob->m_Crc : NULL);
+		pcm += M * SampleBytes;
+
+		if ((bytes = EncodeFrameData()) < 0)
+		{
+			result = 1;
+			break;
+		}
+		pJob->m_Data.insert(pJob->m_Data.end(), fbuf, fbuf + bytes);
+		pJob->m_Bytes.push_back(bytes);
+	}
+
+	N = NN;		// restore frame length (changed for the last frame)
+	delete [] xh;
+
+	return(result);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Job for the block switching threads: all blocks of one channel (or coupled channel pair)
+// at one block switching level
+class CLevelJob : public CWorkerJob
+{
+public:
+	CLevelJob() : m_ppEncoder( NULL ), m_pFrame( NULL ), m_pBuf( NULL ) { m_pBufi[0] = m_pBufi[1] = NULL; }
+	~CLevelJob() { delete [] m_pBuf; delete [] m_pBufi[0]; delete [] m_pBufi[1]; }
+	void Run( short Worker ) { m_ppEncoder[Worker]->EncodeLevelJob( this ); }
+
+	CLpacEncoder**	m_ppEncoder;		// Encoder of each worker thread
+	CLpacEncoder*	m_pFrame;			// Encoder holding the current frame
+	long			m_Channel;			// (First) channel
+	short			m_CBS;				// Coupled channel pair
+	short			m_Level;			// Block switching level
+	long			m_NN;				// Frame length
+	short			m_RAframe;			// Random access frame
+	long			m_Bytes;			// Bytes in m_pBuf
+	long			m_bpb[32];			// Bytes per block
+	unsigned char*	m_pBuf;				// Encoded blocks
+	long			m_Bytesi[2];		// Bytes in m_pBufi[channel]
+	long			m_bpbi[2][32];		// Bytes per block [channel], independent channel coding
+	unsigned char*	m_pBufi[2];			// Encoded blocks [channel], independent channel coding
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Start the threads for the block switching search of EncodeFrameData()
+void CLpacEncoder::StartLevelThreads()
+{
+	long BufSize = 4L*N*2 + 4L*P + N*2*IEEE754_BYTES_PER_SAMPLE+100;	// Channel pair
+	long BufSizei = ((long)((IntRes+7)/8)+1)*N + 4*P + 128;				// Single channel
+	long w, Jobs;
+
+	// Enough channels in flight to keep all threads busy
+	LevelSlots = max(2L, (2L*Threads + Sub) / (Sub + 1));
+	Jobs = LevelSlots * (Sub + 1);
+
+	LevelEnc = new CLpacEncoder*[Threads];
+	for (w = 0; w < Threads; w++)
+	{
+		LevelEnc[w] = new CLpacEncoder;
+		LevelEnc[w]->CopyParameters(*this);
+		LevelEnc[w]->AllocateBuffers();
+	}
+
+	LevelJob = new CLevelJob[Jobs];
+	for (w = 0; w < Jobs; w++)
+	{
+		LevelJob[w].m_ppEncoder = LevelEnc;
+		LevelJob[w].m_pFrame = this;
+		LevelJob[w].m_pBuf = new unsigned char[BufSize];
+		if (Joint)
+		{
+			LevelJob[w].m_pBufi[0] = new unsigned char[BufSizei];
+			LevelJob[w].m_pBufi[1] = new unsigned char[BufSizei];
+		}
+	}
+
+	LevelPool = new CWorkerPool;
+	LevelPool->Start(Threads);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Stop the threads for the block switching search
+void CLpacEncoder::StopLevelThreads()
+{
+	if (LevelPool == NULL)
+		return;
+
+	LevelPool->Stop();
+	delete LevelPool;
+	LevelPool = NULL;
+
+	for (short w = 0; w < Threads; w++)
+		delete LevelEnc[w];
+	delete [] LevelEnc;
+	delete [] LevelJob;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue the trial encodings of channel c (and c+1 if CBS) for all block switching levels
+void CLpacEncoder::QueueLevels(CLevelJob *pJob, long c, short CBS, short Bsub, long NN, short RAframe)
+{
+	long i, M = (fid == frames) ? N0 : NN;
+
+	// Difference signal (the trial encodings work on private copies)
+	if (CBS)
+	{
+		for (i = 0; i < M; i++)
+			xs[c>>1][i] = x[c+1][i] - x[c][i];
+	}
+
+	for (short a = 0; a <= Bsub; a++)
+	{
+		pJob[a].m_Channel = c;
+		pJob[a].m_CBS = CBS;
+		pJob[a].m_Level = a;
+		pJob[a].m_NN = NN;
+		pJob[a].m_RAframe = RAframe;
+		LevelPool->Push(&pJob[a]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Trial encoding of a block switching level (called by worker threads)
+short CLpacEncoder::EncodeLevelJob(CLevelJob *pJob)
+{
+	const CLpacEncoder &Enc = *pJob->m_pFrame;
+	long c = pJob->m_Channel;
+	long M = (Enc.fid == Enc.frames) ? Enc.N0 : pJob->m_NN;
+	long *bpbi[2] = { pJob->m_bpbi[0], pJob->m_bpbi[1] };
+	short CBS = pJob->m_CBS;
+
+	fid = Enc.fid;
+	RA = Enc.RA;
+	MCCflag = 0;
+
+	// EncodeBlock() modifies the signal temporarily, so each level gets its own copy
+	memcpy(x[0] - P, Enc.x[c] - P, (P + M) * sizeof(int));
+	if (CBS)
+	{
+		memcpy(x[1] - P, Enc.x[c+1] - P, (P + M) * sizeof(int));
+		memcpy(xs[0] - P, Enc.xs[c>>1] - P, P * sizeof(int));
+	}
+
+	memset(pJob->m_bpbi, 0, sizeof(pJob->m_bpbi));
+	pJob->m_Bytes = EncodeLevel(x[0], CBS ? x[1] : NULL, CBS ? xs[0] : NULL, pJob->m_Level, pJob->m_NN, pJob->m_RAframe,
+								pJob->m_pBuf, pJob->m_bpb, (CBS && Joint) ? pJob->m_pBufi : NULL, bpbi);
+	if (CBS && Joint)
+	{
+		pJob->m_Bytesi[0] = 0;
+		pJob->m_Bytesi[1] = 0;
+		for (short b = 0; b < 32; b++)
+		{
+			pJob->m_Bytesi[0] += bpbi[0][b];
+			pJob->m_Bytesi[1] += bpbi[1][b];
+		}
+	}
+
+	return(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Job for the RLSLMS threads
+class CAnalyzeJob : public CWorkerJob
+{
+public:
+	enum { CHANNEL, PAIR_RLS, PAIR_LMS };
+
+	CAnalyzeJob() : m_pEncoder( NULL ), m_Queued( false ), m_Stage( CHANNEL ), m_pRls( NULL ) {}
+	~CAnalyzeJob() { delete [] m_pRls; }
+	void Run( short ) { m_pEncoder->AnalyzeJob( this ); }
+
+	CLpacEncoder*	m_pEncoder;
+	rlslms_buf_ptr	m_State;			// Predictor state (channel and mode table of the job)
+	short			m_RA;				// Reset the predictors
+	bool			m_Queued;			// Job has been pushed and not yet been waited for
+	short			m_Stage;			// CHANNEL: prediction of the independently coded channel m_State.channel,
+										// PAIR_RLS: RLS stage of the left channel of the joint stereo pair m_State.channel,
+										// PAIR_LMS: remaining stages of the pair (see analyze_joint_init())
+	short			m_Init;				// PAIR_LMS: result of analyze_joint_init() (0: pair is done)
+	short			m_Mono;				// PAIR_LMS: pair is coded as mono
+	int*			m_pRls;				// PAIR_LMS: buffer of the pair [JS_RLSBUF_LEN(N)]
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Start the threads for the RLSLMS prediction. Independently coded channels are run in parallel.
+// The RLS stages of joint stereo pairs continue the P matrices of the previous pair, so they are
+// run in the order of the pairs by QueueAnalyze(), with the two channels of a pair in parallel.
+// The following stages of the pairs are run in parallel.
+void CLpacEncoder::StartRlsThreads()
+{
+	RlsJob = new CAnalyzeJob[Chan];
+	for (long c = 0; c < Chan; c++)
+		RlsJob[c].m_pEncoder = this;
+	if (Joint)
+	{
+		for (long c = 0; c < 2*CPE; c += 2)
+		{
+			RlsJob[c].m_Stage = CAnalyzeJob::PAIR_LMS;
+			RlsJob[c].m_pRls = new int[JS_RLSBUF_LEN(N)];
+			RlsJob[c+1].m_Stage = CAnalyzeJob::PAIR_RLS;
+		}
+	}
+
+	RlsPool = new CWorkerPool;
+	RlsPool->Start(min(static_cast<long>(Threads), Chan));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Stop the threads for the RLSLMS prediction
+void CLpacEncoder::StopRlsThreads()
+{
+	if (RlsPool == NULL)
+		return;
+
+	RlsPool->Stop();
+	delete RlsPool;
+	RlsPool = NULL;
+	delete [] RlsJob;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Start the prediction of all channels of the frame with the current mode table.
+// AnalyzeChannel() and AnalyzePair() take the result if the table has not been changed meanwhile.
+void CLpacEncoder::QueueAnalyze(short RA)
+{
+	long c;
+	short Mono = mono_frame;
+
+	for (c = Joint ? 2*CPE : 0; c < Chan; c++)
+	{
+		CAnalyzeJob &Job = RlsJob[c];
+		Job.m_State = rlslms_ptr;
+		Job.m_State.channel = static_cast<short>(c);
+		Job.m_RA = RA;
+		Job.m_Queued = true;
+		RlsPool->Push(&Job);
+	}
+
+	// Joint stereo pairs: RLS stages here, in the order of the pairs
+	for (c = 0; c < (Joint ? 2*CPE : 0); c += 2)
+	{
+		CAnalyzeJob &Job = RlsJob[c];
+		memcpy(MccBuf.m_dmat[c], x[c], N * sizeof(int));
+		memcpy(MccBuf.m_dmat[c+1], x[c+1], N * sizeof(int));
+		Job.m_State = rlslms_ptr;
+		Job.m_State.channel = static_cast<short>(c);
+		Job.m_RA = RA;
+		Job.m_Init = analyze_joint_init(MccBuf.m_dmat[c], MccBuf.m_dmat[c+1], N, &Job.m_State, RA, IntRes, &Mono, &MccBuf, Job.m_pRls);
+		Job.m_Mono = Mono;
+		rlslms_ptr.old_flag = Job.m_State.old_flag;
+		if (Job.m_Init && !Mono)
+		{
+			// Left channel in a worker thread, right channel here
+			CAnalyzeJob &Left = RlsJob[c+1];
+			Left.m_State = Job.m_State;
+			RlsPool->Push(&Left);
+			analyze_joint_rls(MccBuf.m_dmat[c], MccBuf.m_dmat[c+1], N, &Job.m_State, RA, 1, Job.m_pRls);
+			RlsPool->Wait(&Left);
+		}
+		Job.m_Queued = true;
+		RlsPool->Push(&Job);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Run a job of the RLSLMS threads
+void CLpacEncoder::AnalyzeJob(CAnalyzeJob *pJob)
+{
+	long c = pJob->m_State.channel;
+
+	switch (pJob->m_Stage)
+	{
+	case CAnalyzeJob::CHANNEL:
+		AnalyzeSignal(&pJob->m_State, pJob->m_RA);
+		break;
+	case CAnalyzeJob::PAIR_RLS:
+		analyze_joint_rls(MccBuf.m_dmat[c], MccBuf.m_dmat[c+1], N, &pJob->m_State, RlsJob[c].m_RA, 0, RlsJob[c].m_pRls);
+		break;
+	case CAnalyzeJob::PAIR_LMS:
+		if (pJob->m_Init)
+			analyze_joint_lms(MccBuf.m_dmat[c], MccBuf.m_dmat[c+1], N, &pJob->m_State, pJob->m_RA, IntRes, pJob->m_Mono, &MccBuf, pJob->m_pRls);
+		break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RLSLMS prediction of channel pState->channel (also called by worker threads):
+// x[c] keeps the input, MccBuf.m_dmat[c] gets the residual
+void CLpacEncoder::AnalyzeSignal(rlslms_buf_ptr *pState, short RA)
+{
+	long c = pState->channel;
+	long i;
+	int tmp;
+
+	for(i=0;i<N;i++) MccBuf.m_dmat[c][i]=x[c][i];		// Save input
+	analyze(x[c], N, pState, RA, IntRes, &MccBuf);
+	for(i=0;i<N;i++)									// Restore input
+	{
+		tmp = MccBuf.m_dmat[c][i];
+		MccBuf.m_dmat[c][i]=x[c][i];
+		x[c][i] = tmp;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RLSLMS prediction of an independently coded channel
+void CLpacEncoder::AnalyzeChannel(long c, short RA)
+{
+	if (RlsPool && RlsJob[c].m_Queued)
+	{
+		CAnalyzeJob &Job = RlsJob[c];
+
+		RlsPool->Wait(&Job);
+		Job.m_Queued = false;
+		if ((Job.m_RA == RA) && !memcmp(&Job.m_State.mode_table, &rlslms_ptr.mode_table, sizeof(mtable)))
+			return;
+		// The safe mode table has been switched on after queueing (RA is set then,
+		// so the predictors are reset and the job has no effect on the result).
+	}
+
+	rlslms_ptr.channel = static_cast<short>(c);
+	AnalyzeSignal(&rlslms_ptr, RA);
+}
 
-	for (f = 0; f < frames; f++)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RLSLMS prediction of the joint stereo pair c, c+1:
+// x[c..c+1] keep the input, MccBuf.m_dmat[c..c+1] get the residual
+void CLpacEncoder::AnalyzePair(long c, short RA)
+{
+	if (RlsPool && RlsJob[c].m_Queued)
 	{
-		if (EncodeFrame())
-			return(-2);
-	}
+		CAnalyzeJob &Job = RlsJob[c];
 
-	if (WriteTrailer() < 0)
-		return(-2);
+		RlsPool->Wait(&Job);
+		Job.m_Queued = false;
+		if ((Job.m_RA == RA) && !memcmp(&Job.m_State.mode_table, &rlslms_ptr.mode_table, sizeof(mtable)))
+		{
+			mono_frame = Job.m_Mono;
+			return;
+		}
+		// The safe mode table has been switched on after queueing (see AnalyzeChannel()).
+		// The RLS stage of the job has changed the shared P matrices, but they are reset now.
+	}
 
-	return(0);
+	memcpy(MccBuf.m_dmat[c], x[c], N * sizeof(int));
+	memcpy(MccBuf.m_dmat[c+1], x[c+1], N * sizeof(int));
+	rlslms_ptr.channel = static_cast<short>(c);
+	analyze_joint(MccBuf.m_dmat[c], MccBuf.m_dmat[c+1], N, &rlslms_ptr, RA, IntRes, &mono_frame, &MccBuf);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1239,6 +1946,16 @@ short CLpacEncoder::SetMlz( short MlzMode_x )
 	else return ( MlzMode = 1 );
 }
 
+short CLpacEncoder::SetThreads(short Threads_x)
+{
+	if (Threads_x == 0)
+		return(Threads = CWorkerPool::GetDefaultThreads());	// Number of hardware threads
+	else if (Threads_x < 0)
+		return(Threads = 1);
+	else
+		return(Threads = min(Threads_x, 64));
+}
+
 short CLpacEncoder::SetCRC(short CRCenabled_x)
 {
 	if (CRCenabled_x)
@@ -1251,12 +1968,59 @@ short CLpacEncoder::SetCRC(short CRCenabled_x)
 // Encode one frame
 short CLpacEncoder::EncodeFrame()
 {
-	long bytes_1, bytes_2 = 0, bytes_3, oaa=0;		// Bytes for blocks 1, 2, difference
+	long M = (fid + 1 == frames) ? N0 : N;	// Length of current frame
+	long bytes;
+	long pcmbytes = M * Chan * ((SampleType == SAMPLE_TYPE_INT) ? Res / 8 : sizeof(float));
+	ALS_UINT32 avail = 0;
+	unsigned char *pcm = const_cast<unsigned char*>(static_cast<const unsigned char*>(fpeek(fpInput, &avail)));
+
+	// Read audio data (in place if the input file is mapped) and update the CRC
+	if ((pcm != NULL) && (avail >= static_cast<ALS_UINT32>(pcmbytes)))
+	{
+		ReadSamples(x, M, pcm, NULL, &CRC);
+		fseek(fpInput, pcmbytes, SEEK_CUR);
+	}
+	else
+		ReadSamples(x, M, bbuf, fpInput, &CRC);
+
+	// Encode and write frame
+	if ((bytes = EncodeFrameData()) < 0)
+		return(1);
+
+	return(WriteFrame(fbuf, bytes));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Read M samples per channel into ppx (from fp, or from b if fp is NULL)
+// and update the CRC of the PCM data (if crc is not NULL)
+long CLpacEncoder::ReadSamples(int **ppx, long M, unsigned char *b, HALSSTREAM fp, unsigned int *crc)
+{
+	if ( SampleType == SAMPLE_TYPE_INT ) {
+		if (Res == 16)
+			return(Read16BitNM(ppx, Chan, M, MSBfirst, b, fp, crc));
+		else if (Res == 8)
+			return(Read8BitOffsetNM(ppx, Chan, M, b, fp, crc));
+		else if (Res == 24)
+			return(Read24BitNM(ppx, Chan, M, MSBfirst, b, fp, crc));
+		else	// Res == 32
+			return(Read32BitNM(ppx, Chan, M, MSBfirst, b, fp, crc));
+	}
+
+	// floating-point
+	return(ReadFloatNM( ppx, Chan, M, MSBfirst, b, fp, Float.GetFloatBuffer(), crc ));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encode the frame which has been read into x into fbuf
+// Returns the number of bytes in fbuf, or -1 on error
+long CLpacEncoder::EncodeFrameData()
+{
+	long bytes_1, bytes_2 = 0, oaa=0;		// Bytes for blocks 1, 2
 	long bpf_total = 0;						// Bytes for frame
 	long bpf_total_m = 0;						// Bytes for frame
-	static unsigned long ra_bytes = 0;		// Bytes for all frames of a RA unit
+	long fbytes = 0;						// Bytes in output buffer
 	short RAsave, RAframe = 0;
-	long cpe, sce, c0, c1, c, c2;
+	long cpe, sce, c0, c1, c;
 	unsigned long bytes_diff;
 
 	long bpf[6];							// Bytes per frame [level]
@@ -1272,12 +2036,10 @@ short CLpacEncoder::EncodeFrame()
 	bytes_MCC = new long[Chan];
 
 	long bpbi_total;						// Bytes per frame (total)
-	long bpfi[2][6];						// Bytes per frame [channel][level], independent channel coding
 	long bpbi[2][6][32];					// Bytes per block [channel][level][block], independent channel coding
 	BYTE *bufferi[2][6];					// Buffer for independent channels (locally allocated and deleted)
 	short CheckIC = 1;						// Check independent coding (including block switching) of channel pairs
     short RESET;
-	long tmp;
 	if (!Joint)
 		CheckIC = 0;						// if Joint is off, independent coding is used anyhow
 
@@ -1298,34 +2060,6 @@ short CLpacEncoder::EncodeFrame()
 	if (fid == frames)			// Last frame
 		N = N0;
 
-	// Read audio data
-	if ( SampleType == SAMPLE_TYPE_INT ) {
-		if (Res == 16)
-		{
-			Read16BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
-			CRC = CalculateBlockCRC32(2L*Chan*N, CRC, (void*)bbuf);
-		}
-		else if (Res == 8)
-		{
-			Read8BitOffsetNM(x, Chan, N, bbuf, fpInput);
-			CRC = CalculateBlockCRC32((long)Chan*N, CRC, (void*)bbuf);
-		}
-		else if (Res == 24)
-		{
-			Read24BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
-			CRC = CalculateBlockCRC32(3L*Chan*N, CRC, (void*)bbuf);
-		}
-		else	// Res == 32
-		{
-			Read32BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
-			CRC = CalculateBlockCRC32(4L*Chan*N, CRC, (void*)bbuf);
-		}
-	} else {
-		// floating-point
-		ReadFloatNM( x, Chan, N, MSBfirst, bbuf, fpInput, Float.GetFloatBuffer() );
-		CRC = CalculateBlockCRC32( sizeof(float) * Chan * N, CRC, (void*)bbuf );
-	}
-
 	if (ChanSort)
 	{
 		// Rearrange channel pointers
@@ -1341,43 +2075,32 @@ short CLpacEncoder::EncodeFrame()
 	if (RA)
 	{
 		if (((fid - 1) % RA) == 0)	// first frame of RA unit
-		{
-			if (RAflag == 1) 			// save random access info in frame
-			{
-				if (fid > 1)
-				{
-					// save size of RAU before its first frame
-					fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);	// back to the last RAU
-					WriteUIntMSBfirst(ra_bytes, fpOutput);			// write size
-					fseek(fpOutput, ra_bytes, SEEK_CUR);			// forward to current frame
-				}
-				WriteUIntMSBfirst(ra_bytes, fpOutput);			// write 4 dummy bytes for current RAU
-			}
-			else if (RAflag == 2)		// save random access info in header
-			{
-				if (fid > 1)
-				{
-					RAUsize[RAUid] = ra_bytes;		
-					RAUid++;
-				}
-			}
-
-			ra_bytes = 0;									// start counting bytes of current RAU
-			RAframe = 1;									// flag for RA usage in current frame
-		}
+			RAframe = 1;			// flag for RA usage in current frame
 		else
 			RA = 0;		// turn off RA in current frame
 	}
 
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
 		Float.ConvertFloatToInteger( x, N, RA != 0, AcfMode, AcfGain, MlzMode );
-		if ( !Float.FindDiffFloatPCM( x, N ) ) return 1;
+		if ( !Float.FindDiffFloatPCM( x, N ) ) return -1;
 	}
 
+	// Block switching search with worker threads
+	if ((Threads > 1) && (LevelPool == NULL) && !MCCnoJS && !RLSLMS)
+		StartLevelThreads();
+
+	// RLSLMS prediction with worker threads
+	if ((Threads > 1) && (RlsPool == NULL) && RLSLMS && (Chan > 1))
+		StartRlsThreads();
+
 	if (RLSLMS)
 	{
-		if (RAframe) RLSLMS_ext=7;
-		initCoefTable(RLSLMS, CoefTable);
+		mtable LastTable;
+		memcpy(&LastTable, &rlslms_ptr.mode_table, sizeof(mtable));
+		initCoefTable(&rlslms_ptr, RLSLMS, CoefTable);
+		// Switching back from the safe mode table also restarts the predictors,
+		// otherwise the decoder would go on with the safe mode table.
+		if (RAframe || memcmp(&LastTable, &rlslms_ptr.mode_table, sizeof(mtable))) RLSLMS_ext=7;
 		RESET = (RLSLMS_ext==7);
 	}
 
@@ -1397,170 +2120,59 @@ short CLpacEncoder::EncodeFrame()
 			}
 		}
 
-		// Save original pointers
-		for (c = 0; c < Chan; c++)
-			xsave[c] = x[c];
-		if (Joint)
-		{
-			for (c = 0; c < Chan/2; c++)
-				xssave[c] = xs[c];
-		}
-
 		// Channels ///////////////////////////////////////////////////////////////////////////////////
+		long cq = 0, eq = 0, e = 0;			// Next channel/element to queue, elements queued/finished
 		for (c = 0; c < Chan; c++)
 		{
 			// Coupled block switching if joint coding, and not the last channel
 			CBS = (Joint && (c < Chan - 1) && ((c % 2) == 0));
 
 			// Block switching levels /////////////////////////////////////////////////////////////////
-			for (a = 0; a <= Bsub; a++)
+			if (LevelPool)
 			{
-				bpf[a] = 0;
-
-				if (CheckIC)
-				{
-					bpfi[0][a] = 0;
-					bpfi[1][a] = 0;
-				}
-
-				B = 1 << a;			// number of blocks = 2^a
-				Nb = NN / B;		// basic block length for this level
-
-				// Last frame
-				if (fid == frames)
+				// Queue the trial encodings of the following channels
+				while ((cq < Chan) && (eq < e + LevelSlots))
 				{
-					B = N0 / Nb;		// #blocks of (full) length Nb
-					Nrem = N0 % Nb;		// one block of (remaining) length Nrem
-					if (Nrem)
-						B++;			// increase total #blocks
+					short cbs = (Joint && (cq < Chan - 1) && ((cq % 2) == 0));
+					QueueLevels(LevelJob + (eq % LevelSlots) * (Sub + 1), cq, cbs, Bsub, NN, RAframe);
+					cq += cbs ? 2 : 1;
+					eq++;
 				}
 
-				if (CBS)	// two coupled channels
+				// Collect the trial encodings of this channel (pair)
+				CLevelJob *pJob = LevelJob + (e % LevelSlots) * (Sub + 1);
+				for (a = 0; a <= Bsub; a++)
 				{
-					c1 = c + 1;
-					c2 = c >> 1;
-
-					// Blocks /////////////////////////////////////////////////////////////////////////
-					for (b = 0; b < B; b++)
+					LevelPool->Wait(&pJob[a]);
+					bpf[a] = pJob[a].m_Bytes;
+					memcpy(buffer[a], pJob[a].m_pBuf, bpf[a]);
+					memcpy(bpb[a], pJob[a].m_bpb, sizeof(bpb[a]));
+					if (CheckIC && CBS)
 					{
-						bpb[a][b] = 0;
-
-						// Last block of last frame may be shorter 
-						if ((fid == frames) && (b == B - 1) && Nrem)
-							Nb = Nrem;
-
-						N = Nb;
-
-						if (RAframe && (b > 0))		// turn off RA temporarily, except for the first block 
-							RA = 0;
-
-						bytes_1 = EncodeBlock(x[c], tmpbuf1);
-						bytes_2 = EncodeBlock(x[c1], tmpbuf2);
-
-						if (CheckIC)
-						{
-							// byte per block
-							bpbi[0][a][b] = bytes_1;
-							bpbi[1][a][b] = bytes_2;
-							// copy block data into frame buffer
-							memcpy(bufferi[0][a] + bpfi[0][a], tmpbuf1, bytes_1);
-							memcpy(bufferi[1][a] + bpfi[1][a], tmpbuf2, bytes_2);
-							// increase bytes per frame value
-							bpfi[0][a] += bytes_1;
-							bpfi[1][a] += bytes_2;
-						}
-
-						// Generate difference signal
-						for (i = 0; i < Nb; i++)
-							xs[c2][i] = x[c1][i] - x[c][i];
-
-						if ((bytes_1 > 3) && (bytes_2 > 3))			// No channel is zero or constant
-						{
-							bytes_3 = EncodeBlock(xs[c2], tmpbuf3);		// Encode difference signal
-
-							if ((bytes_3 < bytes_1) || (bytes_3 <= bytes_2))
-							{
-								BYTE h = tmpbuf3[0];
-								if (h & 0x80)						// Difference signal is not zero/constant
-									tmpbuf3[0] |= 0x40;					// h = 11xx xxxx
-								else								// Difference signal is zero or constant
-									tmpbuf3[0] |= 0x20;					// h = 0x1x xxxx
-
-								if (bytes_1 <= bytes_2)
-								{
-									memcpy(tmpbuf2, tmpbuf3, bytes_3);		// Difference substitutes channel 2
-									bytes_2 = bytes_3;
-								}
-								else
-								{
-									memcpy(tmpbuf1, tmpbuf3, bytes_3);		// Difference substitutes channel 1
-									bytes_1 = bytes_3;
-								}
-							}
-						}
-
-						// Write data to buffer
-						memcpy(buffer[a] + bpf[a], tmpbuf1, bytes_1);
-						memcpy(buffer[a] + bpf[a] + bytes_1, tmpbuf2, bytes_2);
-						bpf[a] += long(bytes_1) + bytes_2;
-						bpb[a][b] += long(bytes_1) + bytes_2;
-
-						// Increment pointers (except for last subblock)
-						if (b < B - 1)
+						for (short ch = 0; ch < 2; ch++)
 						{
-							x[c] = x[c] + Nb;
-							x[c1] = x[c1] + Nb;
-							if (Joint)
-								xs[c2] = xs[c2] + Nb;
+							memcpy(bufferi[ch][a], pJob[a].m_pBufi[ch], pJob[a].m_Bytesi[ch]);
+							memcpy(bpbi[ch][a], pJob[a].m_bpbi[ch], sizeof(bpbi[ch][a]));
 						}
-
-						N = NN;		// restore value
 					}
-					// End of blocks //////////////////////////////////////////////////////////////////
-
-					// Restore original pointers
-					x[c] = xsave[c];
-					x[c1] = xsave[c1];
-					if (Joint)
-						xs[c2] = xssave[c2];
 				}
-				else	// one independent channel
+				e++;
+				N = NN;
+			}
+			else
+			{
+				for (a = 0; a <= Bsub; a++)
 				{
-					// Blocks /////////////////////////////////////////////////////////////////////////
-					for (b = 0; b < B; b++)
+					unsigned char *bufi[2];
+					long *bpbia[2] = { bpbi[0][a], bpbi[1][a] };
+					if (CheckIC && CBS)
 					{
-						bpb[a][b] = 0;
-
-						// Last block of last frame may be shorter 
-						if ((fid == frames) && (b == B - 1) && Nrem)
-							Nb = Nrem;
-
-						N = Nb;
-
-						if (RAframe && (b > 0))		// turn off RA temporarily, except for the first block 
-							RA = 0;
-
-						bytes_1 = EncodeBlock(x[c], tmpbuf1);
-
-						// Write data to buffer
-						memcpy(buffer[a] + bpf[a], tmpbuf1, bytes_1);
-						bpf[a] += long(bytes_1);
-						bpb[a][b] += long(bytes_1);
-
-						// Increment pointers (except for last subblock)
-						if (b < B - 1)
-							x[c] = x[c] + Nb;
-
-						N = NN;				// restore value
+						bufi[0] = bufferi[0][a];
+						bufi[1] = bufferi[1][a];
 					}
-					// End of blocks //////////////////////////////////////////////////////////////////
-
-					// Restore original pointers
-					x[c] = xsave[c];
+					bpf[a] = EncodeLevel(x[c], CBS ? x[c+1] : NULL, CBS ? xs[c>>1] : NULL, a, NN, RAframe,
+										 buffer[a], bpb[a], (CheckIC && CBS) ? bufi : NULL, bpbia);
 				}
-
-				if (RAframe)		// turn on RA again in RA frames
-					RA = RAsave;
 			}
 			// End of block switching levels //////////////////////////////////////////////////////////
 
@@ -1766,17 +2378,6 @@ short CLpacEncoder::EncodeFrame()
 
 		// Restore original pointers
 		buffer[0] = buffer0;
-
-		for (c = 0; c < Chan; c++){
-			
-			x[c] = xsave[c];
-		}
-		if (Joint)
-		{
-			for (c = 0; c < Chan/2; c++)
-				xs[c] = xssave[c];
-		}
-
 	}
     else if (RLSLMS)//------------RLSLMS mode --------------------------
 	{
@@ -1790,6 +2391,8 @@ short CLpacEncoder::EncodeFrame()
 				bufferi[1][s] = new unsigned char[4L*N];	// Buffer for short frames
 			}
 		}
+		if (RlsPool)
+			QueueAnalyze(RAframe || RESET);
 		// Channel Pair Elements
 		for (cpe = 0; cpe < CPE; cpe++)
 		{
@@ -1808,15 +2411,7 @@ short CLpacEncoder::EncodeFrame()
 
 				if (RLSLMS)   // independent channel
 				{
-					for(i=0;i<N;i++) MccBuf.m_dmat[c0][i]=x[c0][i];		// Save input
-					rlslms_ptr.channel = c0;
-					analyze(x[c0], N, &rlslms_ptr ,RAframe || RESET, IntRes, &MccBuf);
-					for(i=0;i<N;i++)									// Restore input
-					{
-						tmp = MccBuf.m_dmat[c0][i];
-						MccBuf.m_dmat[c0][i]=x[c0][i];
-						x[c0][i] = tmp;
-					}
+					AnalyzeChannel(c0, RAframe || RESET);
 					if(PITCH) 
 					{
 						memset( MccBuf.m_Ltp.m_pBuffer[c0].m_ltpmat, 0, sizeof(int) * 2048 );
@@ -1824,15 +2419,7 @@ short CLpacEncoder::EncodeFrame()
 					}					
 					bytes_1 = EncodeBlockCoding( &MccBuf, c0, MccBuf.m_dmat[c0], tmpbuf1, 0);
 					RLSLMS_ext=0;
-					for(i=0;i<N;i++) MccBuf.m_dmat[c1][i]=x[c1][i];		// Save input
-					rlslms_ptr.channel = c1; 
-					analyze(x[c1], N, &rlslms_ptr, RAframe || RESET, IntRes, &MccBuf);
-					for(i=0;i<N;i++)									// Restore input
-					{
-						tmp = MccBuf.m_dmat[c1][i];
-						MccBuf.m_dmat[c1][i]=x[c1][i];
-						x[c1][i] = tmp;
-					}
+					AnalyzeChannel(c1, RAframe || RESET);
 					if(PITCH) 
 					{
 						memset( MccBuf.m_Ltp.m_pBuffer[c1].m_ltpmat, 0, sizeof(int) * 2048 );
@@ -1840,10 +2427,10 @@ short CLpacEncoder::EncodeFrame()
 					}
 					bytes_2 = EncodeBlockCoding( &MccBuf, c1, MccBuf.m_dmat[c1], tmpbuf2, 0);
 
-					if (bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
+					if (bytes_1<0 || bytes_2<0 || bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
 					{
 						// Copy safe_mode_table
-						memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+						memcpy(&rlslms_ptr.mode_table, &safe_mode_table, sizeof(mtable));
 						RLSLMS_ext = 7;
 						RESET = 1;
 
@@ -1867,6 +2454,12 @@ short CLpacEncoder::EncodeFrame()
 						}
 						bytes_2 = EncodeBlockCoding( &MccBuf, c1, MccBuf.m_dmat[c1], tmpbuf2, 0);
 					}
+
+					if (bytes_1<0 || bytes_2<0) 
+					{
+						printf("ALS file size error ind %ld %ld \t",bytes_1,bytes_2);
+						exit(3);
+					}
 				}
 			}
 			if (Joint)						// Joint Stereo
@@ -1876,23 +2469,7 @@ short CLpacEncoder::EncodeFrame()
 					char *xpr0=&MccBuf.m_xpara[c0];
 					char *xpr1=&MccBuf.m_xpara[c1];
 
-					for(i=0;i<N;i++)						// Save input
-					{
-						MccBuf.m_dmat[c0][i]=x[c0][i];
-						MccBuf.m_dmat[c1][i]=x[c1][i];
-					}
-					rlslms_ptr.channel = c0;
-					analyze_joint(x[c0],x[c1],N, &rlslms_ptr, RAframe || RESET, IntRes, &mono_frame, &MccBuf);
-					for(i=0;i<N;i++)						// Restore input
-					{
-						tmp = MccBuf.m_dmat[c0][i];
-						MccBuf.m_dmat[c0][i]=x[c0][i];
-						x[c0][i] = tmp;
-
-						tmp = MccBuf.m_dmat[c1][i];
-						MccBuf.m_dmat[c1][i]=x[c1][i];
-						x[c1][i] = tmp;
-					}
+					AnalyzePair(c0, RAframe || RESET);
 					if(PITCH) 
 					{
 						memset( MccBuf.m_Ltp.m_pBuffer[c0].m_ltpmat, 0, sizeof(int) * 2048 );
@@ -1907,10 +2484,10 @@ short CLpacEncoder::EncodeFrame()
 					}
 					bytes_2 = EncodeBlockCoding( &MccBuf, c1, MccBuf.m_dmat[c1], tmpbuf2, 0);
 
-					if (bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
+					if (bytes_1<0 || bytes_2<0 || bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
 					{
 						// Copy safe_mode_table
-						memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+						memcpy(&rlslms_ptr.mode_table, &safe_mode_table, sizeof(mtable));
 						RLSLMS_ext = 7;
 						RESET = 1;
 
@@ -1953,15 +2530,7 @@ short CLpacEncoder::EncodeFrame()
 		for (sce = 0; sce < SCE; sce++)
 		{
 			c0 = sce+2*CPE;
-			for(i=0;i<N;i++) MccBuf.m_dmat[c0][i]=x[c0][i];		// Save input
-			rlslms_ptr.channel = c0;
-			analyze(x[c0], N, &rlslms_ptr, RAframe || RESET, IntRes, &MccBuf);
-			for(i=0;i<N;i++)									// Restore input
-			{
-				tmp = MccBuf.m_dmat[c0][i];
-				MccBuf.m_dmat[c0][i]=x[c0][i];
-				x[c0][i] = tmp;
-			}
+			AnalyzeChannel(c0, RAframe || RESET);
 			if(PITCH) 
 			{
 				memset( MccBuf.m_Ltp.m_pBuffer[c0].m_ltpmat, 0, sizeof(int) * 2048 );
@@ -1970,10 +2539,10 @@ short CLpacEncoder::EncodeFrame()
 			bytes_1 = EncodeBlockCoding( &MccBuf, c0, MccBuf.m_dmat[c0], tmpbuf1, 0);
 			RLSLMS_ext=0;
 
-			if (bytes_1>N*IntRes/8)
+			if (bytes_1<0 || bytes_1>N*IntRes/8)
 			{
 				// Copy safe_mode_table
-				memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+				memcpy(&rlslms_ptr.mode_table, &safe_mode_table, sizeof(mtable));
 				RLSLMS_ext = 7;
 				RESET = 1;
 
@@ -1990,6 +2559,12 @@ short CLpacEncoder::EncodeFrame()
 				bytes_1 = EncodeBlockCoding( &MccBuf, c0, MccBuf.m_dmat[c0], tmpbuf1, 0);
 			}
 
+			if (bytes_1<0) 
+			{
+				printf("ALS file size error sce %ld \t",bytes_1);
+				exit(3);
+			}
+
 			// Write data to buffer
 			memcpy(buffer[0] + bpf_total, tmpbuf1, bytes_1);
 			bpf_total += bytes_1;
@@ -2267,12 +2842,12 @@ short CLpacEncoder::EncodeFrame()
 				memcpy(buffer[0], buffer_m, bpf_total_m);
 				bpf_total= bpf_total_m;
 				uu=0x80;
-				fwrite(&uu, 1, 1 , fpOutput);
+				fbuf[fbytes++] = uu;
 			}	
 			else
 			{
 				uu=0;
-				fwrite(&uu, 1, 1, fpOutput);
+				fbuf[fbytes++] = uu;
 			}
 		}
 
@@ -2297,32 +2872,21 @@ short CLpacEncoder::EncodeFrame()
 			memcpy(xs[cpe] - P, xs[cpe] + (N - P), P * sizeof(int));
 	}
 
-	// Write frame buffer
+	// Copy frame data into output buffer
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
 		// Floating point PCM
-		if ( fwrite( buffer[0], 1, bpf_total - 4 - bytes_diff, fpOutput ) != bpf_total - 4 - bytes_diff ) return 1;
-		WriteUIntMSBfirst(bytes_diff, fpOutput);
-		if ( fwrite( Float.GetDiffBuffer(), 1, bytes_diff, fpOutput ) != bytes_diff ) return 1;
+		memcpy( fbuf + fbytes, buffer[0], bpf_total - 4 - bytes_diff );
+		fbytes += bpf_total - 4 - bytes_diff;
+		fbuf[fbytes++] = (bytes_diff >> 24) & 0xFF;
+		fbuf[fbytes++] = (bytes_diff >> 16) & 0xFF;
+		fbuf[fbytes++] = (bytes_diff >> 8) & 0xFF;
+		fbuf[fbytes++] = bytes_diff & 0xFF;
+		memcpy( fbuf + fbytes, Float.GetDiffBuffer(), bytes_diff );
+		fbytes += bytes_diff;
 	} else {
 		// Integer PCM
-		if (fwrite(buffer[0], 1, bpf_total, fpOutput) != bpf_total) return(1);
-	}
-	if(MCC && !MCCnoJS)  bpf_total++; // switch for JS and MCC
-
-	if (RA)
-		ra_bytes += bpf_total;
-
-	if (RA && (fid == frames))	// Last frame
-	{
-		if (RAflag == 1)
-		{
-			// save size last RAU before the first frame of last RAU
-			fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);		// back to last RAU
-			WriteUIntMSBfirst(ra_bytes, fpOutput);				// write size
-			fseek(fpOutput, ra_bytes, SEEK_CUR);				// forward to current frame
-		}
-		else if (RAflag == 2)
-			RAUsize[RAUid] = ra_bytes;
+		memcpy(fbuf + fbytes, buffer[0], bpf_total);
+		fbytes += bpf_total;
 	}
 
 	if (ChanSort)
@@ -2350,6 +2914,82 @@ short CLpacEncoder::EncodeFrame()
 	delete [] xtmp;
 	delete [] bytes_MCC;
 
+	return(fbytes);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Write an encoded frame (frame number fid) including random access info
+short CLpacEncoder::WriteFrame(unsigned char *pFrame, long bytes)
+{
+	if (mp4file)
+		return WriteMp4Frame(pFrame, bytes);
+
+	// Random Access
+	if (RA && (((fid - 1) % RA) == 0))	// first frame of RA unit
+	{
+		if (RAflag == 1) 			// save random access info in frame
+		{
+			if (fid > 1)
+			{
+				// save size of RAU before its first frame
+				fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);	// back to the last RAU
+				WriteUIntMSBfirst(ra_bytes, fpOutput);			// write size
+				fseek(fpOutput, ra_bytes, SEEK_CUR);			// forward to current frame
+			}
+			WriteUIntMSBfirst(ra_bytes, fpOutput);			// write 4 dummy bytes for current RAU
+		}
+		else if (RAflag == 2)		// save random access info in header
+		{
+			if (fid > 1)
+			{
+				RAUsize[RAUid] = ra_bytes;		
+				RAUid++;
+			}
+		}
+
+		ra_bytes = 0;									// start counting bytes of current RAU
+	}
+
+	// Write frame buffer
+	if (fwrite(pFrame, 1, bytes, fpOutput) != bytes) return(1);
+
+	if (RA)
+		ra_bytes += bytes;
+
+	if (RA && (fid == frames))	// Last frame
+	{
+		if (RAflag == 1)
+		{
+			// save size last RAU before the first frame of last RAU
+			fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);		// back to last RAU
+			WriteUIntMSBfirst(ra_bytes, fpOutput);				// write size
+			fseek(fpOutput, ra_bytes, SEEK_CUR);				// forward to current frame
+		}
+		else if (RAflag == 2)
+			RAUsize[RAUid] = ra_bytes;
+	}
+
+	return(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Write an encoded frame (frame number fid) to the MP4 file
+// Each random access unit (without random access: the whole stream) is one MP4 sample,
+// the random access info is not stored in the frames.
+short CLpacEncoder::WriteMp4Frame(unsigned char *pFrame, long bytes)
+{
+	if (!Mp4Writer.WriteFrameData(pFrame, bytes))
+		return(1);
+
+	if ((fid == frames) || (RA && ((fid % RA) == 0)))	// Last frame of RA unit
+	{
+		// N is the length of the last frame when the last frame is written
+		ALS_INT64 Duration = ((fid == frames) ? Samples : fid * N) - Mp4Samples;
+		if ((Duration >> 32) || !Mp4Writer.EndFrame(static_cast<NAlsImf::IMF_UINT32>( Duration )))
+			return(1);
+		Mp4Samples += Duration;
+	}
+
 	return(0);
 }
 
@@ -2361,6 +3001,128 @@ long CLpacEncoder::EncodeBlock(int *x, unsigned char *bytebuf)
 	return EncodeBlockCoding( &MccBuf, 0, MccBuf.m_dmat[0], bytebuf, 0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encode all blocks of channel x0 at block switching level a into buf.
+// If x1 != NULL, x0 and x1 are coupled channels and the difference signal xd
+// may substitute one of them. The channels are also stored separately in
+// bufi[0/1] (if bufi != NULL) to check independent coding.
+// Returns the number of bytes in buf.
+long CLpacEncoder::EncodeLevel(int *x0, int *x1, int *xd, short a, long NN, short RAframe, unsigned char *buf, long *bpb, unsigned char **bufi, long **bpbi)
+{
+	long bytes_1, bytes_2, bytes_3;
+	long bpf = 0, bpfi[2] = { 0, 0 };
+	short b, B, RAsave = RA;
+	long i, Nb, Nrem = 0;
+
+	B = 1 << a;			// number of blocks = 2^a
+	Nb = NN / B;		// basic block length for this level
+
+	// Last frame
+	if (fid == frames)
+	{
+		B = N0 / Nb;		// #blocks of (full) length Nb
+		Nrem = N0 % Nb;		// one block of (remaining) length Nrem
+		if (Nrem)
+			B++;			// increase total #blocks
+	}
+
+	// Blocks /////////////////////////////////////////////////////////////////////////////////////
+	for (b = 0; b < B; b++)
+	{
+		bpb[b] = 0;
+
+		// Last block of last frame may be shorter 
+		if ((fid == frames) && (b == B - 1) && Nrem)
+			Nb = Nrem;
+
+		N = Nb;
+
+		if (RAframe && (b > 0))		// turn off RA temporarily, except for the first block 
+			RA = 0;
+
+		bytes_1 = EncodeBlock(x0, tmpbuf1);
+
+		if (x1 != NULL)	// two coupled channels
+		{
+			bytes_2 = EncodeBlock(x1, tmpbuf2);
+
+			if (bufi != NULL)
+			{
+				// byte per block
+				bpbi[0][b] = bytes_1;
+				bpbi[1][b] = bytes_2;
+				// copy block data into frame buffer
+				memcpy(bufi[0] + bpfi[0], tmpbuf1, bytes_1);
+				memcpy(bufi[1] + bpfi[1], tmpbuf2, bytes_2);
+				// increase bytes per frame value
+				bpfi[0] += bytes_1;
+				bpfi[1] += bytes_2;
+			}
+
+			// Generate difference signal
+			for (i = 0; i < Nb; i++)
+				xd[i] = x1[i] - x0[i];
+
+			if ((bytes_1 > 3) && (bytes_2 > 3))			// No channel is zero or constant
+			{
+				bytes_3 = EncodeBlock(xd, tmpbuf3);		// Encode difference signal
+
+				if ((bytes_3 < bytes_1) || (bytes_3 <= bytes_2))
+				{
+					BYTE h = tmpbuf3[0];
+					if (h & 0x80)						// Difference signal is not zero/constant
+						tmpbuf3[0] |= 0x40;					// h = 11xx xxxx
+					else								// Difference signal is zero or constant
+						tmpbuf3[0] |= 0x20;					// h = 0x1x xxxx
+
+					if (bytes_1 <= bytes_2)
+					{
+						memcpy(tmpbuf2, tmpbuf3, bytes_3);		// Difference substitutes channel 2
+						bytes_2 = bytes_3;
+					}
+					else
+					{
+						memcpy(tmpbuf1, tmpbuf3, bytes_3);		// Difference substitutes channel 1
+						bytes_1 = bytes_3;
+					}
+				}
+			}
+
+			// Write data to buffer
+			memcpy(buf + bpf, tmpbuf1, bytes_1);
+			memcpy(buf + bpf + bytes_1, tmpbuf2, bytes_2);
+			bpf += bytes_1 + bytes_2;
+			bpb[b] += bytes_1 + bytes_2;
+		}
+		else	// one independent channel
+		{
+			// Write data to buffer
+			memcpy(buf + bpf, tmpbuf1, bytes_1);
+			bpf += bytes_1;
+			bpb[b] += bytes_1;
+		}
+
+		// Increment pointers (except for last subblock)
+		if (b < B - 1)
+		{
+			x0 += Nb;
+			if (x1 != NULL)
+			{
+				x1 += Nb;
+				xd += Nb;
+			}
+		}
+
+		N = NN;		// restore value
+	}
+	// End of blocks //////////////////////////////////////////////////////////////////////////////
+
+	if (RAframe)		// turn on RA again in RA frames
+		RA = RAsave;
+
+	return(bpf);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Encode a single block analysis
 void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, int *x)
@@ -2371,13 +3133,9 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 	short *sft=&pBuffer->m_shift[Channel];
 	short *oP=&pBuffer->m_optP[Channel];
 
-	static double d2mean;
-	static long danz;
 	short optP;
 	long i, c;
 
-	static long count = 1;
-
     /* reconstruction levels for 1st and 2nd coefficients: */
     static int pc12_tbl[128] = {
         -1048544, -1048288, -1047776, -1047008, -1045984, -1044704, -1043168, -1041376, -1039328,
@@ -2446,11 +3204,8 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 		// for this block and the corresponding set of parcor coefficients (par).
 		if (!Adapt)
 			GetCof(x, N, P, Win, par);						// Fixed order
-#ifdef	LPC_ADAPT
 		else
-			//optP = GetCofAdaptOrder(x, N, Pmax, Win, par, Freq);		// Adaptive order
-			optP = GetCofAdaptOrder(x, N, Pmax, Win, par, (Freq > 96000) && !Sub ? 0 : Freq);		// Adaptive order
-#endif
+			optP = GetCofAdaptOrder(x, N, Pmax, Win, par, CoefTable, RA != 0);		// Adaptive order
 		double q = PI / 256;	// Quantizer step size
 
 		// Quantization of the coefficients
@@ -2571,6 +3326,19 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 	}	// End of NORMAL BLOCK
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Number of bits of the Rice codes of d[0..n-1] with parameter s
+static ALS_INT64 RiceBits(const int *d, long n, short s)
+{
+	ALS_INT64 bits = ALS_INT64(s + 1) * n;
+	for (long i = 0; i < n; i++)
+	{
+		unsigned int u = (d[i] >= 0) ? 2u * d[i] : ~(2u * d[i]);	// -2*d-1
+		bits += u >> s;
+	}
+	return bits;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Encode a single block coding
 long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int *d, unsigned char *bytebuf, long gmod)
@@ -2586,8 +3354,6 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 	short *MccMode=pBuffer->m_MccMode[Channel];
 	int **mtgmm=pBuffer->m_cubgmm[Channel];
 
-	static double d2mean;
-	static long danz;
 	BYTE h, hl[4];
 	short sub, s[8], sx[8], sfix, S[8];
 	long Ns;
@@ -2866,6 +3632,17 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 
 		if (PITCH) 	pBuffer->m_Ltp.Encode( Channel, d, bytebuf, N, Freq, &out );
 
+		// A diverging RLS-LMS predictor can leave a residual that does not even
+		// fit into the buffer, so give up (the caller falls back to the safe mode table)
+		if (RLSLMS)
+		{
+			ALS_INT64 bits = 0;
+			for (j = 0; j < sub; j++)
+				bits += RiceBits(d + j*Ns, Ns, s[j]);
+			if (bits > ALS_INT64(IntRes/8+10)*N*8)
+				return -1;
+		}
+
 		// Residual
 		if (!RA)
 		{
@@ -2914,29 +3691,29 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			out.WriteBits((UINT) RLSLMS_ext,3);
 			if (RLSLMS_ext&0x01) // change lambda only
 			{
-				out.WriteBits((c_mode_table.filter_len[1]>>1),4);
-				out.WriteBits(c_mode_table.nstage-2,3);
-				for(i=2;i<c_mode_table.nstage;i++)
+				out.WriteBits((rlslms_ptr.mode_table.filter_len[1]>>1),4);
+				out.WriteBits(rlslms_ptr.mode_table.nstage-2,3);
+				for(i=2;i<rlslms_ptr.mode_table.nstage;i++)
 				{
 					out.WriteBits(lookup_table(lms_order_table,
-							               c_mode_table.filter_len[i]
+							               rlslms_ptr.mode_table.filter_len[i]
 										   ),5);						
 				}
 			}
 			if (RLSLMS_ext&0x02)
 			{
-				if (c_mode_table.filter_len[1]){
-					out.WriteBits(c_mode_table.lambda[0],10);
-					out.WriteBits(c_mode_table.lambda[1],10);
+				if (rlslms_ptr.mode_table.filter_len[1]){
+					out.WriteBits(rlslms_ptr.mode_table.lambda[0],10);
+					out.WriteBits(rlslms_ptr.mode_table.lambda[1],10);
 				}
 			}
 			if (RLSLMS_ext&0x04)
 			{
-				for(i=2;i<c_mode_table.nstage;i++)
+				for(i=2;i<rlslms_ptr.mode_table.nstage;i++)
 				{
-					out.WriteBits(lookup_mu(c_mode_table.opt_mu[i]),5);
+					out.WriteBits(lookup_mu(rlslms_ptr.mode_table.opt_mu[i]),5);
 				}
-				out.WriteBits(c_mode_table.step_size/LMS_MU_INT,3);
+				out.WriteBits(rlslms_ptr.mode_table.step_size/LMS_MU_INT,3);
 			}
 		}
 		else
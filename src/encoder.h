@@ -120,9 +120,19 @@ contents : Header file for encoder.cpp
 #include "lms.h"
 #include "stream.h"
 #include "profiles.h"
+#include "Mp4aFile.h"
+
+class CEncoderJob;
+class CLevelJob;
+class CAnalyzeJob;
+class CWorkerPool;
 
 class CLpacEncoder
 {
+	friend class CEncoderJob;
+	friend class CLevelJob;
+	friend class CAnalyzeJob;
+
 protected:
 	long N;							// Frame length
 	short P;						// (Max.) Predictor order
@@ -175,16 +185,24 @@ protected:
 	long RAUid;						// current RAU
 	unsigned int *RAUsize;			// sizes of RAUs
 
+	unsigned long ra_bytes;			// bytes for all frames of current RAU
+
 	ALS_INT64 FilePos;				// file position pointer
 
 	HALSSTREAM fpInput;				// Input file
-	HALSSTREAM fpOutput;			// Output file
+	HALSSTREAM fpOutput;			// Output file (MP4: ALS header in memory)
+	HALSSTREAM fpMp4;				// MP4 output file
 	bool CloseInput;				// true:Need to close fpInput.
 	bool CloseOutput;				// true:Need to close fpOutput.
+	bool CloseMp4;					// true:Need to close fpMp4.
 	bool mp4file;					// true:MP4 file format / false:ALS file format
 	bool oafi_flag;					// true:Use oafi / false:Do not use oafi
+	bool Mp4Pli;					// true:Indicate audio profile level in MP4 file
+	ALS_INT64 Mp4Samples;			// Samples in completed MP4 samples (RAUs)
+	CAlsStream Mp4Stream;			// fpMp4 as stream for Mp4Writer
+	NAlsImf::CMp4aWriter Mp4Writer;	// MP4 file writer
 
-	unsigned char *bbuf, *buff, *tmpbuf1, *tmpbuf2, *tmpbuf3, *buffer[6], **tmpbuf_MCC, *buffer_m;
+	unsigned char *bbuf, *buff, *tmpbuf1, *tmpbuf2, *tmpbuf3, *buffer[6], **tmpbuf_MCC, *buffer_m, *fbuf;
 	int **x, **xp, **xs, **xps, *d, *cof;
 	double *par;
 
@@ -199,6 +217,14 @@ protected:
 	ALS_PROFILES EnforcedProfiles;
 	ALS_PROFILES ConformantProfiles;
 
+	short Threads;					// Number of encoder threads
+	CWorkerPool *LevelPool;			// Threads for the block switching search (NULL: serial search)
+	CLpacEncoder **LevelEnc;		// Encoder of each block switching thread
+	CLevelJob *LevelJob;			// Trial encodings [channel slot][level]
+	long LevelSlots;				// Number of channels with trial encodings in flight
+	CWorkerPool *RlsPool;			// Threads for the RLSLMS prediction (NULL: serial)
+	CAnalyzeJob *RlsJob;			// RLSLMS prediction [channel] (joint stereo pairs: see StartRlsThreads())
+
 public:
 	long MCCflag;					// Multi-channel correlation method	CLpacEncoder();	
 	CLpacEncoder();					// Constructor
@@ -212,8 +238,9 @@ public:
 	short SetInputFile( HALSSTREAM hStream ) { fpInput = hStream; CloseInput = false; ALSProfFillSet( ConformantProfiles ); ALSProfEmptySet( EnforcedProfiles ); return 0; }
 	short AnalyseInputFile(AUDIOINFO *ainfo);
 	short SpecifyAudioInfo(AUDIOINFO *ainfo);
-	short OpenOutputFile( const char *name, bool mp4, bool oafi ) { mp4file = mp4; oafi_flag = oafi; CloseOutput = ( OpenFileWriter( name, &fpOutput ) == 0 ); return CloseOutput ? 0 : 1; }
-	short SetOutputFile( HALSSTREAM hStream, bool mp4, bool oafi ) { mp4file = mp4; oafi_flag = oafi; fpOutput = hStream; CloseOutput = false; return 0; }
+	short OpenOutputFile( const char *name, bool mp4, bool oafi );
+	short SetOutputFile( HALSSTREAM hStream, bool mp4, bool oafi );
+	void SetProfileIndication( bool Indicate ) { Mp4Pli = Indicate; }
 	ALS_INT64 WriteHeader(ENCINFO *encinfo);
 	ALS_INT64 WriteTrailer();
 	short EncodeAll();
@@ -244,10 +271,33 @@ public:
 	short SetMlz(short MlzMode);
 	short SetMCCnoJS(short MCCnoJS);
 	short SetCRC(short CRCenabled);
+	short SetThreads(short Threads);
 	void SetEnforcedProfiles(ALS_PROFILES profiles) { EnforcedProfiles = profiles; EnforceProfiles(); }
 	ALS_PROFILES GetConformantProfiles() const { return ConformantProfiles; }
 
 protected:
+	void AllocateBuffers();
+	void CopyParameters(const CLpacEncoder &Enc);
+	long ReadSamples(int **ppx, long M, unsigned char *b, HALSSTREAM fp, unsigned int *crc = NULL);
+	long EncodeFrameData();					// Encode frame into fbuf
+	short WriteFrame(unsigned char *pFrame, long bytes);
+	short WriteMp4Frame(unsigned char *pFrame, long bytes);
+	short CopyMp4Data(ALS_INT64 Size, bool Trailer);
+	short CloseMp4File();
+	short EncodeAllThreads();				// Encode frames in parallel
+	short EncodeJob(CEncoderJob *pJob);
+	long EncodeLevel(int *x0, int *x1, int *xd, short a, long NN, short RAframe, unsigned char *buf, long *bpb, unsigned char **bufi, long **bpbi);
+	void StartLevelThreads();				// Start threads for the block switching search
+	void StopLevelThreads();
+	void QueueLevels(CLevelJob *pJob, long c, short CBS, short Bsub, long NN, short RAframe);
+	short EncodeLevelJob(CLevelJob *pJob);
+	void StartRlsThreads();					// Start threads for the RLSLMS prediction
+	void StopRlsThreads();
+	void QueueAnalyze(short RA);
+	void AnalyzeChannel(long c, short RA);
+	void AnalyzePair(long c, short RA);
+	void AnalyzeJob(CAnalyzeJob *pJob);
+	void AnalyzeSignal(rlslms_buf_ptr *pState, short RA);
 	long EncodeBlock(int *x, unsigned char *bytebuf);		// Encode block
 	void EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, int *d); //MCC
 	long EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int *x, unsigned char *bytebuf, long gmod); //MCC
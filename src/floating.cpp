@@ -1789,16 +1789,16 @@ void	CFloat::ReformatData( int const* const* ppIntBuf, long FrameSize )
 //         Decode difference          //
 //                                    //
 ////////////////////////////////////////
-// fp = Input file pointer
+// pInput = Input data
+// Size = Available bytes in pInput, receives the number of bytes read
 // FrameSize = Number of samples per frame
 // RandomAccess = true:Random accessible frame
 // Return value = true:Success / false:Error
-bool	CFloat::DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess )
+bool	CFloat::DecodeDiff( const unsigned char* pInput, unsigned long& Size, long FrameSize, bool RandomAccess )
 {
 	unsigned long	destLen, nNumByteAppend;
 	unsigned long	bit_count;
 	unsigned char*	cpOutBuff;
-	unsigned char	tmp[4];
 	int				i, j, ch, startPos, highest_bit;
 	unsigned int	readbuf;
 	CIEEE32			fx;
@@ -1822,20 +1822,21 @@ bool	CFloat::DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess )
 	length = new unsigned char [ FrameSize ];
 	//encodedBuffer = new unsigned char [ FrameSize * 32 ];
 
-	m_BitIO.InitBitRead( m_pCbitBuff );
 	cpOutBuff = m_pCbitBuff;
 
 	// read UIntMSBfirst
-	for ( i = 0; i < 4; i++ ) {
-		if ( fread( &(tmp[i]), 1, 1, fp ) != 1 ) return false;
-	}
-	nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>(tmp[0]) << 24 ) | ( static_cast<unsigned int>(tmp[1]) << 16 ) | ( static_cast<unsigned int>(tmp[2]) << 8 ) | tmp[3] );
+	if ( Size < 4 ) return false;
+	nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>(pInput[0]) << 24 ) | ( static_cast<unsigned int>(pInput[1]) << 16 ) | ( static_cast<unsigned int>(pInput[2]) << 8 ) | pInput[3] );
 
-	if ( fread( m_pCBuffD, 1, nNumByteAppend, fp ) != nNumByteAppend ) return false;
+	if ( nNumByteAppend > Size - 4 ) return false;
+	if ( nNumByteAppend > m_FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE + 100 ) return false;	// Larger than m_pCBuffD
+	memcpy( m_pCBuffD, pInput + 4, nNumByteAppend );
+	Size = 4 + nNumByteAppend;
 	destLen = FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE * 2;
 
 	memcpy( cpOutBuff, m_pCBuffD, nNumByteAppend );
 	destLen = nNumByteAppend;
+	m_BitIO.InitBitRead( m_pCbitBuff, nNumByteAppend );
 
 	bit_count = 0;
 	// out put ACD coding parameters
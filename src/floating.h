@@ -201,7 +201,7 @@ public:
 	// Decoding functions
 	void	ConvertFloatToRBuff( unsigned char* pRawBuf, long FrameSize );
 	void	ReformatData( int const* const* ppIntBuf, long FrameSize );
-	bool	DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess );
+	bool	DecodeDiff( const unsigned char* pInput, unsigned long& Size, long FrameSize, bool RandomAccess );
 	bool	AddIEEEDiff( long FrameSize );
 
 protected:
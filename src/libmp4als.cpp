@@ -0,0 +1,593 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : libmp4als.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : C interface of the encoder and decoder library (libmp4als)
+
+*************************************************************************/
+
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#include "libmp4als.h"
+#include "encoder.h"
+#include "decoder.h"
+#include "crc.h"
+
+// Number of samples written to the ALS header while the length is unknown
+// (the highest value which is allowed in ALS files, see WriteHeader())
+#define SAMPLES_UNKNOWN		0xfffffffeL
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encoder context
+// The PCM data is read from PcmData, the header is written to Header and the frames to
+// Frames. All frames are written by EncodeFrame() as they are (no random access info), so
+// that each frame is complete as soon as it has been encoded.
+struct MP4ALS_ENCODER : public CLpacEncoder
+{
+	MP4ALS_ENCODER() : hPcm( NULL ), hHeader( NULL ), hFrames( NULL ), Unknown( false ), Finished( false ), Pushed( 0 ), Pulled( 0 ) {}
+	~MP4ALS_ENCODER();
+
+	int Open( const MP4ALS_ENCODER_OPTIONS &Options );
+	int Push( const void *pPcm, unsigned long Size );
+	int Pull( const void **ppFrame, unsigned long *pSize );
+	int Finish();
+
+	long FrameBytes();						// Bytes of PCM data for the next frame
+	int EncodeNext();						// Encode the next frame from PcmData
+
+	CMemoryStream PcmData;					// Pushed PCM data
+	CMemoryStream Header;					// ALS header
+	CMemoryStream Frames;					// Encoded frames
+	HALSSTREAM hPcm, hHeader, hFrames;		// Stream handles of PcmData, Header and Frames
+	std::deque<ALS_INT64> FrameEnds;		// End of each frame in Frames which has not been pulled
+	bool Unknown;							// true: number of samples is set by Finish()
+	bool Finished;							// true: all frames have been encoded
+	ALS_INT64 Pushed;						// Bytes of PCM data pushed
+	ALS_INT64 Pulled;						// End of the last pulled frame in Frames
+};
+
+MP4ALS_ENCODER::~MP4ALS_ENCODER()
+{
+	CloseFiles();
+	if ( hPcm ) fclose( hPcm );
+	if ( hHeader ) fclose( hHeader );
+	if ( hFrames ) fclose( hFrames );
+}
+
+// Set up the encoder the same way as mp4als does for a raw input file, and write the header
+int MP4ALS_ENCODER::Open( const MP4ALS_ENCODER_OPTIONS &Options )
+{
+	const MP4ALS_AUDIO_INFO &Audio = Options.Audio;
+	AUDIOINFO ainfo;
+	ENCINFO encinfo;
+
+	// Check audio format (any sampling frequency of a WAV or AIFF file in mp4als, up to the 31 bits of a long)
+	if ( ( Audio.Channels < 1 ) || ( Audio.Channels > MAXCHAN ) || ( Audio.SampleRate < 1 ) || ( Audio.SampleRate > 0x7fffffffL ) )
+		return MP4ALS_ERR_PARAM;
+	if ( Audio.FloatSamples ? ( Audio.BitsPerSample != 32 ) : ( ( Audio.BitsPerSample % 8 ) || ( Audio.BitsPerSample < 8 ) || ( Audio.BitsPerSample > 32 ) ) )
+		return MP4ALS_ERR_PARAM;
+	if ( ( Audio.Samples < 0 ) || ( Audio.Samples >= 0xffffffffL ) )
+		return MP4ALS_ERR_PARAM;
+	if ( ( Options.MCC || ( Options.BlockSwitching > 0 ) ) && ( Options.RLSLMS > 0 ) )
+		return MP4ALS_ERR_PARAM;
+
+	if ( OpenMemoryStream( &PcmData, &hPcm ) || OpenMemoryStream( &Header, &hHeader ) || OpenMemoryStream( &Frames, &hFrames ) )
+		return MP4ALS_ERR_MEMORY;
+	SetInputFile( hPcm );
+	SetRawAudio( 1 );
+
+	Unknown = ( Audio.Samples == 0 );
+	ainfo.FileType = 0;
+	ainfo.MSBfirst = Audio.MSBfirst ? 1 : 0;
+	ainfo.Chan = Audio.Channels;
+	ainfo.Res = Audio.BitsPerSample;
+	ainfo.IntRes = Audio.FloatSamples ? IEEE754_PCM_RESOLUTION : Audio.BitsPerSample;
+	ainfo.SampleType = Audio.FloatSamples ? SAMPLE_TYPE_FLOAT : SAMPLE_TYPE_INT;
+	ainfo.Samples = Unknown ? SAMPLES_UNKNOWN : Audio.Samples;
+	ainfo.Freq = Audio.SampleRate;
+	ainfo.HeaderSize = 0;
+	ainfo.TrailerSize = 0;
+	if ( SpecifyAudioInfo( &ainfo ) )
+		return MP4ALS_ERR_PARAM;
+
+	// Coding options
+	SetFrameLength( Options.FrameLength );
+	SetOrder( Options.Order );
+	SetAdapt( Options.Order ? Options.Adapt : 0 );
+	SetJoint( Options.Joint ? 0 : -1 );
+	SetRA( Options.RandomAccess );
+	SetRAmode( 2 );								// Random access info is not stored
+	SetBGMC( Options.BGMC );
+	SetLSBcheck( Options.LSBcheck );
+	SetSub( Options.BlockSwitching );
+	SetMCC( Options.MCC );
+	SetPITCH( Options.PITCH );
+	SetHEMode( Options.RLSLMS );
+	SetCRC( Options.CRC );
+	SetThreads( Options.Threads );
+
+	SetOutputFile( hHeader, false, false );
+	if ( WriteHeader( &encinfo ) < 0 )
+		return MP4ALS_ERR_PARAM;
+	fpOutput = hFrames;
+
+	return MP4ALS_OK;
+}
+
+int MP4ALS_ENCODER::Push( const void *pPcm, unsigned long Size )
+{
+	if ( Finished )
+		return MP4ALS_ERR_STATE;
+	if ( !Unknown && ( Pushed + static_cast<ALS_INT64>( Size ) > Samples * Chan * ( Res / 8 ) ) )
+		return MP4ALS_ERR_PARAM;
+	if ( !PcmData.Append( pPcm, Size ) )
+		return MP4ALS_ERR_MEMORY;
+	Pushed += Size;
+
+	return MP4ALS_OK;
+}
+
+// Return the next encoded frame, encoding it first if there is enough PCM data.
+int MP4ALS_ENCODER::Pull( const void **ppFrame, unsigned long *pSize )
+{
+	int Result;
+
+	// The frame of the previous call is not needed any more
+	Frames.Discard( Pulled );
+
+	if ( FrameEnds.empty() )
+	{
+		if ( Finished )
+			return MP4ALS_END;
+		// If the number of samples is unknown, the last frame is encoded by Finish()
+		if ( ( fid >= frames ) || ( Unknown && ( fid + 1 >= frames ) ) || ( PcmData.GetEnd() - PcmData.Tell() < FrameBytes() ) )
+			return MP4ALS_NEED_MORE;
+		if ( ( Result = EncodeNext() ) != MP4ALS_OK )
+			return Result;
+	}
+
+	*ppFrame = Frames.GetData( Pulled );
+	*pSize = static_cast<unsigned long>( FrameEnds.front() - Pulled );
+	Pulled = FrameEnds.front();
+	FrameEnds.pop_front();
+
+	return MP4ALS_OK;
+}
+
+// Encode the remaining frames and complete the header
+int MP4ALS_ENCODER::Finish()
+{
+	long SampleBytes = Chan * ( Res / 8 );
+	ALS_INT64 Total;
+	int Result;
+
+	if ( Finished )
+		return MP4ALS_ERR_STATE;
+	if ( Pushed % SampleBytes )
+		return MP4ALS_ERR_PARAM;
+	Total = Pushed / SampleBytes;
+
+	if ( Unknown )
+	{
+		if ( Total >= SAMPLES_UNKNOWN )
+			return MP4ALS_ERR_PARAM;
+		Samples = Total;
+		if ( Total )
+		{
+			frames = ( Total + N - 1 ) / N;
+			N0 = static_cast<long>( Total - ( frames - 1 ) * N );
+		}
+
+		// The block switching threads copy the length of the last frame when they are started
+		StopLevelThreads();
+
+		// Number of samples in the header
+		if ( fseek( hHeader, 8, SEEK_SET ) )
+			return MP4ALS_ERR_ENCODE;
+		WriteUIntMSBfirst( static_cast<unsigned int>( Samples ), hHeader );
+	}
+	else if ( Total != Samples )
+		return MP4ALS_ERR_PARAM;
+
+	while ( Samples && ( fid < frames ) )
+	{
+		if ( ( Result = EncodeNext() ) != MP4ALS_OK )
+			return Result;
+	}
+
+	// CRC in the header
+	fpOutput = hHeader;
+	if ( WriteTrailer() < 0 )
+		return MP4ALS_ERR_ENCODE;
+	fpOutput = hFrames;
+	Finished = true;
+
+	return MP4ALS_OK;
+}
+
+long MP4ALS_ENCODER::FrameBytes()
+{
+	return ( ( fid + 1 == frames ) ? N0 : N ) * Chan * ( Res / 8 );
+}
+
+int MP4ALS_ENCODER::EncodeNext()
+{
+	if ( EncodeFrame() )
+		return MP4ALS_ERR_ENCODE;
+	PcmData.Discard( PcmData.Tell() );
+	FrameEnds.push_back( Frames.Tell() );
+	return MP4ALS_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Decoder context
+// The header is read from a memory reader (fpInput). The frames are parsed from InBuf,
+// which is refilled from Pending by TakeInput(), and the PCM data is written to Pcm.
+struct MP4ALS_DECODER : public CLpacDecoder
+{
+	MP4ALS_DECODER() : hPcm( NULL ), Started( false ), Finished( false ), Error( MP4ALS_OK ) {}
+	~MP4ALS_DECODER();
+
+	int ReadHeader();
+	int GetInfo( MP4ALS_AUDIO_INFO *pInfo );
+	int Pull( const void **ppPcm, unsigned long *pSize );
+
+	std::vector<unsigned char> HeaderData;	// ALS header (read through fpInput)
+	std::vector<unsigned char> Pending;		// Pushed data which has not been moved to InBuf yet
+	CMemoryStream Pcm;						// Decoded PCM data
+	HALSSTREAM hPcm;						// Stream handle of Pcm
+	bool Started;							// true: header has been read
+	bool Finished;							// true: no more data is pushed
+	int Error;								// Error which stops decoding
+};
+
+MP4ALS_DECODER::~MP4ALS_DECODER()
+{
+	CloseFiles();
+	if ( hPcm ) fclose( hPcm );
+}
+
+// Size of the ALS header at the beginning of p, up to the first frame
+// Returns 0 if more data is needed, or -1 if p is not an ALS stream.
+static long GetHeaderSize( const unsigned char *p, size_t Size )
+{
+	ALS_INT64 Len = 22, Frames, RAUnits;
+	ALS_UINT32 Samples, HeaderSize, TrailerSize, AuxSize;
+	long Chan, N, NeedPuchBit, i;
+	short RA, RAflag;
+
+	if ( Size < 22 )
+		return 0;
+	if ( ( p[0] != 'A' ) || ( p[1] != 'L' ) || ( p[2] != 'S' ) || p[3] )
+		return -1;
+
+	Samples = ( p[8] << 24 ) | ( p[9] << 16 ) | ( p[10] << 8 ) | p[11];
+	if ( Samples == 0xffffffff )
+		return -1;								// Only in MP4 files
+	Chan = ( ( p[12] << 8 ) | p[13] ) + 1;
+	N = ( ( p[15] << 8 ) | p[16] ) + 1;
+	RA = p[17];
+	RAflag = ( p[18] >> 6 ) & 0x03;
+
+	if ( p[20] & 0x02 )							// channel configuration
+		Len += 2;
+	if ( p[20] & 0x01 )							// channel sorting
+	{
+		i = ( Chan > 1 ) ? ( Chan - 1 ) : 1;
+		NeedPuchBit = 0;
+		while ( i ) { i /= 2; NeedPuchBit++; }
+		Len += ( NeedPuchBit * Chan + 7 ) / 8;
+	}
+
+	if ( static_cast<ALS_INT64>( Size ) < Len + 8 )
+		return 0;
+	HeaderSize = ( p[Len] << 24 ) | ( p[Len + 1] << 16 ) | ( p[Len + 2] << 8 ) | p[Len + 3];
+	TrailerSize = ( p[Len + 4] << 24 ) | ( p[Len + 5] << 16 ) | ( p[Len + 6] << 8 ) | p[Len + 7];
+	if ( ( HeaderSize == 0xffffffff ) || ( TrailerSize == 0xffffffff ) )
+		return -1;								// Only in MP4 files
+	Len += 8 + static_cast<ALS_INT64>( HeaderSize ) + TrailerSize;
+
+	if ( p[21] & 0x80 )							// CRC
+		Len += 4;
+
+	if ( RA && ( RAflag == 2 ) )				// random access info
+	{
+		Frames = ( Samples + N - 1 ) / N;
+		RAUnits = ( Frames + RA - 1 ) / RA;
+		Len += 4 * RAUnits;
+	}
+
+	if ( p[21] & 0x01 )							// aux data
+	{
+		if ( static_cast<ALS_INT64>( Size ) < Len + 4 )
+			return 0;
+		AuxSize = ( p[Len] << 24 ) | ( p[Len + 1] << 16 ) | ( p[Len + 2] << 8 ) | p[Len + 3];
+		Len += 4;
+		if ( AuxSize != 0xffffffff )
+			Len += AuxSize;
+	}
+
+	if ( Len > 0x7fffffff )
+		return -1;
+	return ( static_cast<ALS_INT64>( Size ) < Len ) ? 0 : static_cast<long>( Len );
+}
+
+// Read the header once it has been pushed completely
+// The original file header and trailer are skipped, only the audio data is decoded.
+int MP4ALS_DECODER::ReadHeader()
+{
+	AUDIOINFO ainfo;
+	ENCINFO encinfo;
+	MP4INFO Mp4Info;
+	HALSSTREAM hHeader;
+	long Size = GetHeaderSize( Pending.empty() ? NULL : &Pending[0], Pending.size() );
+
+	if ( Error )
+		return Error;
+	if ( ( Size < 0 ) || ( ( Size == 0 ) && Finished ) )
+		return ( Error = MP4ALS_ERR_FORMAT );
+	if ( Size == 0 )
+		return MP4ALS_NEED_MORE;
+
+	HeaderData.assign( Pending.begin(), Pending.begin() + Size );
+	Pending.erase( Pending.begin(), Pending.begin() + Size );
+	if ( OpenMemoryReader( &HeaderData[0], Size, &hHeader ) )
+		return ( Error = MP4ALS_ERR_MEMORY );
+	SetInputStream( hHeader, false );
+	CloseInput = true;
+
+	if ( AnalyseInputFile( &ainfo, &encinfo, Mp4Info ) )
+		return ( Error = MP4ALS_ERR_FORMAT );
+	if ( fseek( fpInput, HeaderSize, SEEK_CUR ) || ( ReadFrameInfo() < 0 ) )
+		return ( Error = MP4ALS_ERR_FORMAT );
+
+	if ( OpenMemoryStream( &Pcm, &hPcm ) )
+		return ( Error = MP4ALS_ERR_MEMORY );
+	SetOutputStream( hPcm );
+
+	// Parse the frames from InBuf only
+	TakeInput( Pending );
+	Started = true;
+
+	return MP4ALS_OK;
+}
+
+int MP4ALS_DECODER::GetInfo( MP4ALS_AUDIO_INFO *pInfo )
+{
+	pInfo->Channels = Chan;
+	pInfo->SampleRate = Freq;
+	pInfo->BitsPerSample = Res;
+	pInfo->FloatSamples = ( SampleType == SAMPLE_TYPE_FLOAT );
+	pInfo->MSBfirst = MSBfirst;
+	pInfo->Samples = Samples;
+	return MP4ALS_OK;
+}
+
+// Decode the next frame if it has been pushed completely, and return its PCM data
+int MP4ALS_DECODER::Pull( const void **ppPcm, unsigned long *pSize )
+{
+	int Result;
+	long Left;
+
+	// The PCM data of the previous call is not needed any more
+	Pcm.Discard( Pcm.Tell() );
+
+	if ( !Started && ( ( Result = ReadHeader() ) != MP4ALS_OK ) )
+		return Result;
+	if ( Error )
+		return Error;
+
+	if ( fid >= frames )
+	{
+		if ( CRCenabled && ( ( CRC ^ CRC_MASK ) != CRCorg ) )
+			return MP4ALS_ERR_CRC;
+		return MP4ALS_END;
+	}
+
+	// A frame is never longer than InSlack bytes
+	Left = InLen - InPos;
+	if ( !Finished && ( Left + static_cast<long>( Pending.size() ) < InSlack ) )
+		return MP4ALS_NEED_MORE;
+	if ( ( Left < InSlack ) && !Pending.empty() )
+	{
+		std::vector<unsigned char> Data( pIn + InPos, pIn + InLen );
+		Data.insert( Data.end(), Pending.begin(), Pending.end() );
+		Pending.clear();
+		TakeInput( Data );
+	}
+
+	if ( DecodeFrame() || ( InPos > InLen ) )
+		return ( Error = MP4ALS_ERR_DECODE );
+
+	*ppPcm = Pcm.GetData( Pcm.GetStart() );
+	*pSize = static_cast<unsigned long>( Pcm.Tell() - Pcm.GetStart() );
+
+	return MP4ALS_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                                           C interface
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Default options: 16-bit stereo at 44.1 kHz, and the defaults of mp4als
+void mp4als_encoder_default_options( MP4ALS_ENCODER_OPTIONS *pOptions )
+{
+	if ( pOptions == NULL )
+		return;
+
+	memset( pOptions, 0, sizeof(*pOptions) );
+	pOptions->Audio.Channels = 2;
+	pOptions->Audio.SampleRate = 44100;
+	pOptions->Audio.BitsPerSample = 16;
+	pOptions->Order = 10;
+	pOptions->Joint = 1;
+	pOptions->CRC = 1;
+	pOptions->Threads = 1;
+}
+
+// Create an encoder
+// The ALS header is available by mp4als_encoder_header() right away.
+int mp4als_encoder_create( const MP4ALS_ENCODER_OPTIONS *pOptions, MP4ALS_ENCODER **ppEncoder )
+{
+	MP4ALS_ENCODER *pEncoder;
+	int Result;
+
+	if ( ppEncoder == NULL )
+		return MP4ALS_ERR_PARAM;
+	*ppEncoder = NULL;
+	if ( pOptions == NULL )
+		return MP4ALS_ERR_PARAM;
+
+	if ( ( pEncoder = new MP4ALS_ENCODER ) == NULL )
+		return MP4ALS_ERR_MEMORY;
+	if ( ( Result = pEncoder->Open( *pOptions ) ) != MP4ALS_OK )
+	{
+		delete pEncoder;
+		return Result;
+	}
+
+	*ppEncoder = pEncoder;
+	return MP4ALS_OK;
+}
+
+// Add PCM data (Size does not need to be a multiple of the sample size)
+// If the number of samples has been given, more data than that is refused.
+int mp4als_encoder_push( MP4ALS_ENCODER *pEncoder, const void *pPcm, unsigned long Size )
+{
+	if ( ( pEncoder == NULL ) || ( ( pPcm == NULL ) && Size ) )
+		return MP4ALS_ERR_PARAM;
+	return pEncoder->Push( pPcm, Size );
+}
+
+// Get the next encoded frame
+// *ppFrame is valid until the next call for pEncoder.
+// Returns MP4ALS_NEED_MORE if there is not enough PCM data for the next frame,
+// or MP4ALS_END after the last frame.
+int mp4als_encoder_pull( MP4ALS_ENCODER *pEncoder, const void **ppFrame, unsigned long *pSize )
+{
+	if ( ( pEncoder == NULL ) || ( ppFrame == NULL ) || ( pSize == NULL ) )
+		return MP4ALS_ERR_PARAM;
+	*ppFrame = NULL;
+	*pSize = 0;
+	return pEncoder->Pull( ppFrame, pSize );
+}
+
+// Encode the rest of the PCM data after the last push, and complete the header
+// The frames are still returned by mp4als_encoder_pull().
+int mp4als_encoder_finish( MP4ALS_ENCODER *pEncoder )
+{
+	if ( pEncoder == NULL )
+		return MP4ALS_ERR_PARAM;
+	return pEncoder->Finish();
+}
+
+// Get the ALS header
+// *ppHeader is valid until the encoder is destroyed. The size of the header does not
+// change, but its contents are final after mp4als_encoder_finish() only.
+int mp4als_encoder_header( MP4ALS_ENCODER *pEncoder, const void **ppHeader, unsigned long *pSize )
+{
+	if ( ( pEncoder == NULL ) || ( ppHeader == NULL ) || ( pSize == NULL ) )
+		return MP4ALS_ERR_PARAM;
+	*ppHeader = pEncoder->Header.GetData( 0 );
+	*pSize = static_cast<unsigned long>( pEncoder->Header.GetEnd() );
+	return MP4ALS_OK;
+}
+
+void mp4als_encoder_destroy( MP4ALS_ENCODER *pEncoder )
+{
+	delete pEncoder;
+}
+
+// Create a decoder
+int mp4als_decoder_create( MP4ALS_DECODER **ppDecoder )
+{
+	if ( ppDecoder == NULL )
+		return MP4ALS_ERR_PARAM;
+	if ( ( *ppDecoder = new MP4ALS_DECODER ) == NULL )
+		return MP4ALS_ERR_MEMORY;
+	return MP4ALS_OK;
+}
+
+// Add ALS data (the header, followed by the frames)
+int mp4als_decoder_push( MP4ALS_DECODER *pDecoder, const void *pData, unsigned long Size )
+{
+	const unsigned char *p = static_cast<const unsigned char*>( pData );
+
+	if ( ( pDecoder == NULL ) || ( ( pData == NULL ) && Size ) )
+		return MP4ALS_ERR_PARAM;
+	if ( pDecoder->Finished )
+		return MP4ALS_ERR_STATE;
+	pDecoder->Pending.insert( pDecoder->Pending.end(), p, p + Size );
+	return MP4ALS_OK;
+}
+
+// Get the audio format, once the header has been pushed
+int mp4als_decoder_info( MP4ALS_DECODER *pDecoder, MP4ALS_AUDIO_INFO *pInfo )
+{
+	int Result;
+
+	if ( ( pDecoder == NULL ) || ( pInfo == NULL ) )
+		return MP4ALS_ERR_PARAM;
+	if ( !pDecoder->Started && ( ( Result = pDecoder->ReadHeader() ) != MP4ALS_OK ) )
+		return Result;
+	return pDecoder->GetInfo( pInfo );
+}
+
+// Get the PCM data of the next frame
+// *ppPcm is valid until the next call for pDecoder.
+// Returns MP4ALS_NEED_MORE if the next frame has not been pushed completely, or
+// MP4ALS_END (MP4ALS_ERR_CRC if the CRC does not match) after the last frame.
+int mp4als_decoder_pull( MP4ALS_DECODER *pDecoder, const void **ppPcm, unsigned long *pSize )
+{
+	if ( ( pDecoder == NULL ) || ( ppPcm == NULL ) || ( pSize == NULL ) )
+		return MP4ALS_ERR_PARAM;
+	*ppPcm = NULL;
+	*pSize = 0;
+	return pDecoder->Pull( ppPcm, pSize );
+}
+
+// No more data is pushed, so that the last frames can be decoded
+int mp4als_decoder_finish( MP4ALS_DECODER *pDecoder )
+{
+	if ( pDecoder == NULL )
+		return MP4ALS_ERR_PARAM;
+	pDecoder->Finished = true;
+	return MP4ALS_OK;
+}
+
+void mp4als_decoder_destroy( MP4ALS_DECODER *pDecoder )
+{
+	delete pDecoder;
+}
+
+// End of libmp4als.cpp
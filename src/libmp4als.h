@@ -0,0 +1,156 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : libmp4als.h
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : C interface of the encoder and decoder library (libmp4als)
+
+*************************************************************************/
+
+/*************************************************************************
+ * The library encodes and decodes in memory, without any file I/O.
+ *
+ * Encoding:
+ *   mp4als_encoder_default_options( &Options );
+ *   ...set Options.Audio (format of the PCM data) and coding options...
+ *   mp4als_encoder_create( &Options, &pEncoder );
+ *   for each block of interleaved PCM data:
+ *     mp4als_encoder_push( pEncoder, pPcm, Size );
+ *     while ( mp4als_encoder_pull( pEncoder, &pFrame, &FrameSize ) == MP4ALS_OK ) ...store frame...
+ *   mp4als_encoder_finish( pEncoder );
+ *   while ( mp4als_encoder_pull( pEncoder, &pFrame, &FrameSize ) == MP4ALS_OK ) ...store frame...
+ *   mp4als_encoder_header( pEncoder, &pHeader, &HeaderSize );
+ *   mp4als_encoder_destroy( pEncoder );
+ *
+ * The ALS header followed by all frames is an ALS file. The header has
+ * a fixed size, but its CRC (and the number of samples if it was not
+ * known in advance) is only filled in by mp4als_encoder_finish().
+ * Random access info is not stored in the stream (as in MP4 files), so
+ * every frame is final as soon as it has been pulled.
+ *
+ * Decoding:
+ *   mp4als_decoder_create( &pDecoder );
+ *   for each block of ALS data (header and frames, split anywhere):
+ *     mp4als_decoder_push( pDecoder, pData, Size );
+ *     while ( mp4als_decoder_pull( pDecoder, &pPcm, &PcmSize ) == MP4ALS_OK ) ...use PCM data...
+ *   mp4als_decoder_finish( pDecoder );
+ *   while ( mp4als_decoder_pull( pDecoder, &pPcm, &PcmSize ) == MP4ALS_OK ) ...use PCM data...
+ *   (the last pull returns MP4ALS_END, or MP4ALS_ERR_CRC)
+ *   mp4als_decoder_destroy( pDecoder );
+ *
+ * PCM data is interleaved, 8-bit samples are unsigned, 16/24/32-bit
+ * samples are signed, and floating-point samples are IEEE 754 single
+ * precision. The byte order is given by MSBfirst.
+ *
+ * A context must not be used by several threads at the same time.
+ ************************************************************************/
+
+#ifndef	LIBMP4ALS_INCLUDED
+#define	LIBMP4ALS_INCLUDED
+
+#if defined( _MSC_VER )
+typedef	__int64		MP4ALS_INT64;
+#else
+#include	<stdint.h>
+typedef	int64_t		MP4ALS_INT64;
+#endif
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Return values
+#define	MP4ALS_OK			0		// Success
+#define	MP4ALS_NEED_MORE	1		// More input is needed for the next output
+#define	MP4ALS_END			2		// All output has been pulled
+#define	MP4ALS_ERR_PARAM	-1		// Invalid parameter or option
+#define	MP4ALS_ERR_MEMORY	-2		// Out of memory
+#define	MP4ALS_ERR_STATE	-3		// Call not allowed in this state (e.g. push after finish)
+#define	MP4ALS_ERR_FORMAT	-4		// Input is not a supported ALS stream
+#define	MP4ALS_ERR_ENCODE	-5		// Encoding failed
+#define	MP4ALS_ERR_DECODE	-6		// Decoding failed (broken or truncated stream)
+#define	MP4ALS_ERR_CRC		-7		// Decoded audio data does not match the CRC
+
+// Contexts
+typedef	struct MP4ALS_ENCODER	MP4ALS_ENCODER;
+typedef	struct MP4ALS_DECODER	MP4ALS_DECODER;
+
+// Audio format
+typedef	struct MP4ALS_AUDIO_INFO {
+	long			Channels;		// Number of channels (1..65536)
+	long			SampleRate;		// Sampling frequency in Hz (1..2147483647, as for WAV files in mp4als)
+	short			BitsPerSample;	// Bits per sample (8, 16, 24 or 32)
+	short			FloatSamples;	// 1:Floating-point samples (BitsPerSample = 32)
+	short			MSBfirst;		// 1:Most significant byte first (big-endian)
+	MP4ALS_INT64	Samples;		// Number of samples per channel (encoder: 0 = unknown)
+} MP4ALS_AUDIO_INFO;
+
+// Encoder options (see the corresponding mp4als options)
+typedef	struct MP4ALS_ENCODER_OPTIONS {
+	MP4ALS_AUDIO_INFO	Audio;		// Format of the PCM data
+	long	FrameLength;			// -n: Frame length (0 = automatic)
+	short	Order;					// -o: (Maximum) prediction order
+	short	Adapt;					// -a: 1:Adaptive prediction order
+	short	Joint;					// 1:Joint stereo coding / 0:Independent coding (-i)
+	short	RandomAccess;			// -r: Random access distance in 1/10 s (-1 = each frame, 0 = off)
+	short	BGMC;					// -b: 1:BGMC coding of the residual
+	short	LSBcheck;				// -l: 1:Check for empty LSBs
+	short	BlockSwitching;			// -g: Block switching level (0..5)
+	long	MCC;					// -t: Multi-channel correlation (0 = off)
+	short	RLSLMS;					// -z: RLS-LMS mode (0 = off)
+	short	PITCH;					// -p: 1:Long-term prediction
+	short	CRC;					// 1:Store a CRC of the audio data / 0:No CRC (-e)
+	short	Threads;				// -j: Threads within a frame, used by the block switching search (-g) and the
+									// RLS-LMS prediction (-z) only (0 = all cores). Unlike mp4als -j, frames
+									// are not encoded in parallel.
+} MP4ALS_ENCODER_OPTIONS;
+
+// Encoder
+void	mp4als_encoder_default_options( MP4ALS_ENCODER_OPTIONS* pOptions );
+int		mp4als_encoder_create( const MP4ALS_ENCODER_OPTIONS* pOptions, MP4ALS_ENCODER** ppEncoder );
+int		mp4als_encoder_push( MP4ALS_ENCODER* pEncoder, const void* pPcm, unsigned long Size );
+int		mp4als_encoder_pull( MP4ALS_ENCODER* pEncoder, const void** ppFrame, unsigned long* pSize );
+int		mp4als_encoder_finish( MP4ALS_ENCODER* pEncoder );
+int		mp4als_encoder_header( MP4ALS_ENCODER* pEncoder, const void** ppHeader, unsigned long* pSize );
+void	mp4als_encoder_destroy( MP4ALS_ENCODER* pEncoder );
+
+// Decoder
+int		mp4als_decoder_create( MP4ALS_DECODER** ppDecoder );
+int		mp4als_decoder_push( MP4ALS_DECODER* pDecoder, const void* pData, unsigned long Size );
+int		mp4als_decoder_info( MP4ALS_DECODER* pDecoder, MP4ALS_AUDIO_INFO* pInfo );
+int		mp4als_decoder_pull( MP4ALS_DECODER* pDecoder, const void** ppPcm, unsigned long* pSize );
+int		mp4als_decoder_finish( MP4ALS_DECODER* pDecoder );
+void	mp4als_decoder_destroy( MP4ALS_DECODER* pDecoder );
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	// LIBMP4ALS_INCLUDED
+
+// End of libmp4als.h
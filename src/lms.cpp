@@ -62,22 +62,74 @@ contents : Recursive Least Square, Least Mean Square and related functions
 #include "lms.h"
 #include <cstring>
 
+// SIMD kernels (NLMS filters) are used on x86-64 if the CPU supports them
+#if defined(__x86_64__) || defined(_M_X64)
+#define LMS_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LMS_TARGET(t)
+#else
+#include <cpuid.h>
+#define LMS_TARGET(t) __attribute__ ((target (t)))
+#endif
+#endif
+
 #define MIN(a, b)  (((a) < (b)) ? (a) : (b)) 
 #define LEFT	0
 #define RIGHT	1
 
-BUF_TYPE *bufptr[MAX_STAGES];
-BUF_TYPE *bufptr_j[2][MAX_STAGES];
-W_TYPE *wptr[MAX_STAGES];  
-W_TYPE *wptr_j[2][MAX_STAGES];
-extern short store_residual;
+#ifdef	LMS_SIMD
+#define CPU_SSE41	0x01
+#define CPU_AVX2	0x02
+
+// Check the CPU (and OS support for AVX state)
+static unsigned int DetectCpu()
+{
+	unsigned int info[4] = { 0, 0, 0, 0 }, info7[4] = { 0, 0, 0, 0 };
+	unsigned int f = 0;
+	bool avx = false;
+
+#ifdef _MSC_VER
+	__cpuid((int *)info, 0);
+	if (info[0] >= 7)
+		__cpuidex((int *)info7, 7, 0);
+	__cpuid((int *)info, 1);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
+		avx = ((_xgetbv(0) & 6) == 6);
+#else
+	if (__get_cpuid_max(0, NULL) >= 7)
+		__cpuid_count(7, 0, info7[0], info7[1], info7[2], info7[3]);
+	__get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
+	{
+		unsigned int lo, hi;
+		__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+		avx = ((lo & 6) == 6);
+	}
+#endif
+
+	if (info[2] & (1 << 19))
+		f |= CPU_SSE41;
+	if (avx && (info7[1] & (1 << 5)))
+		f |= CPU_AVX2;
+	return(f);
+}
+
+// CPU features (checked once)
+static unsigned int CpuFeatures()
+{
+	static const unsigned int Features = DetectCpu();
+	return(Features);
+}
+#endif
 
 // mu for lms that can be used in the mode table
-char mu_table[32]={1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,18,20,22,24,26,
+const char mu_table[32]={1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,18,20,22,24,26,
                   28,30,35,40,45,50,55,60,70,80,100};
 
 // lms order that can be use in the mode table 
-short lms_order_table[32]={2,3,4,5,6,7,8,9,10,12,14,16,18,20,24,28,32,36,
+const short lms_order_table[32]={2,3,4,5,6,7,8,9,10,12,14,16,18,20,24,28,32,36,
                            48,64,80,96,128,256,384,448,512,640,768,896,1024,0};
 
 
@@ -92,7 +144,7 @@ short lms_order_table[32]={2,3,4,5,6,7,8,9,10,12,14,16,18,20,24,28,32,36,
 
 */
 
-mtable mode_table_48k[MAX_MODE] = 
+const mtable mode_table_48k[MAX_MODE] = 
 { {0, {		0,   0,   0,   0,   0,0,0,0,0,0 },		// Reserved 
 {			0,   0,   0,   0,   0,0,0,0,0,0 },
 {0, 0}, 0},	
@@ -110,7 +162,7 @@ mtable mode_table_48k[MAX_MODE] =
 {99,999}, 16777}	
 };
 
-mtable mode_table_96k[MAX_MODE] = 
+const mtable mode_table_96k[MAX_MODE] = 
 { {0, {		0,   0,   0,   0,   0,0,0,0,0,0 },		// Reserved 
 {			0,   0,   0,   0,   0,0,0,0,0,0 },
 {0, 0}, 0},	
@@ -128,7 +180,7 @@ mtable mode_table_96k[MAX_MODE] =
 {99,999},  16777}
 };
 
-mtable mode_table_192k[MAX_MODE] = 
+const mtable mode_table_192k[MAX_MODE] = 
 { {0, {    0,   0,   0,   0,   0,0,0,0,0,0 },		// Reserved 
 {    0,   0,   0,   0,   0,0,0,0,0,0 },
 {99,999}, 16777},							
@@ -147,16 +199,14 @@ mtable mode_table_192k[MAX_MODE] =
 };
 
 
-mtable *table_assigned[3] = 
+const mtable *table_assigned[3] = 
 { mode_table_48k, mode_table_96k, mode_table_192k };
 
-mtable safe_mode_table =
+const mtable safe_mode_table =
 {3, {		1,	0,	8,	0,0,0,0,0,0,0},				// safe mode
 {			0,	0,	30,	0,0,0,0,0,0,0},
 {99,999}, 16777};
 
-mtable c_mode_table;  // the current table used in the encode/decode
-
 /*************************************************************************/
 // fast_bitcount - locate and return the MSB bit of a 64 bit variable
 /*************************************************************************/
@@ -173,32 +223,263 @@ short fast_bitcount(INT64 temp)
 } 
 
 /*************************************************************************/
-// buffer_update - shift in the sample x into the end of array buf of 
-//                 length N and shift out buf[0] 
+// buffer_update - shift in the sample x into the end of the history of
+//                 length N and shift out the oldest sample
+// The history is a mirrored ring buffer buf of length 2*N, where buf[i] and
+// buf[i+N] hold the same sample. The last N samples are always found in 
+// order (oldest first) in buf[*pos] .. buf[*pos+N-1], so that the filters
+// can work on a contiguous array without moving it for every sample.
 /*************************************************************************/
+inline void buffer_update(int x, BUF_TYPE *buf, short N, short *pos)
+{
+	if (N<=0) return;
+	buf[*pos] = buf[*pos+N] = x;
+	if (++*pos == N) *pos = 0;
+}
 
-void buffer_update(int x, int *buf, short N)
+/*************************************************************************/
+// buffer_update_legacy - history update of the RLSLMS streams written by
+//                 older builds compiled as C++11 (e.g. with CMake). They
+//                 evaluated the unsequenced "*buf++ = *(buf+1)" of the
+//                 former shift loop with the increment first, so that the
+//                 history moved by two samples and took buf[N] (the oldest
+//                 sample of the next stage) along. The histories are not
+//                 mirrored then, but follow each other as in those builds,
+//                 and the ring positions stay 0.
+/*************************************************************************/
+static void buffer_update_legacy(int x, BUF_TYPE *buf, short N)
 {
 	short j;
-	j = N-1;
-	while(j-->0)
-		*buf++ = *(buf+1);
-	*buf = x;
+	for (j=0; j<N-1; j++)
+		buf[j] = buf[j+2];
+	buf[(N>0) ? N-1 : 0] = x;
+}
+
+/*************************************************************************/
+// check_bufpos - keep the ring positions of all stages within the filter 
+//                lengths. Valid streams reset the predictor whenever the
+//                filter lengths change, broken streams may not.
+/*************************************************************************/
+static void check_bufpos(short *pos, const mtable *table)
+{
+	short j;
+	for (j=1; j<table->nstage; j++)
+		if (pos[j] >= table->filter_len[j]) pos[j] = 0;
 }
 
 /*************************************************************************/
 // reinit_P - re-initialize P matrix ( inverse correlation matrix of RLS)
 //            with the initial values
+// P is symmetric, so only its lower triangle is stored (row by row, 
+// P(i,j) = Pmatrix[i*(i+1)/2+j] for j<=i). Pmatrix[P_MAG] holds the OR
+// of the magnitudes of all elements, so that the MSB of P is known 
+// without scanning it. It is kept up to date by UpdateRLSFilter().
 /*************************************************************************/
-void reinit_P(P_TYPE *Pmatrix)
+void reinit_P(P_TYPE *Pmatrix, short M)
 {
 	short i;
 	// clear the matrix of size rls_order by rls_order
-	for (i=0; i<c_mode_table.filter_len[1]*c_mode_table.filter_len[1];i++)
+	for (i=0; i<M*(M+1)/2;i++)
 		Pmatrix[i]=0;
 	// update the diagonal value with the initial value
-	for (i=0; i<c_mode_table.filter_len[1]; i++)
-		Pmatrix[i*c_mode_table.filter_len[1]+i]=(INT64) JS_INIT_P;
+	for (i=0; i<M; i++)
+		Pmatrix[i*(i+1)/2+i]=(INT64) JS_INIT_P;
+	Pmatrix[P_MAG] = (M>0) ? (INT64) JS_INIT_P : 0;
+}
+
+/*******************************************************************/
+// RLS kernels
+// Both work on row i of the lower triangle of P (elements 0..i).
+// RlsRowMul:    ya[i] += sum of t[j]*x[j] (j<=i), ya[j] += t[j]*x[i] (j<i)
+//               with t[j] = ((P(i,j)<<pscale)+0x80000000)>>32, so that 
+//               each element of P is used for both of its positions.
+// RlsRowUpdate: P(i,j) -= (k*vl[j])>>sh, P(i,j) += P(i,j)/lambda
+//               returns the OR of the new magnitudes, or -1 if an
+//               element is out of range (P has to be re-initialized).
+// The division by lambda is done as a multiplication by its 
+// reciprocal, which gives exactly the same (truncated) quotient.
+/*******************************************************************/  
+#if defined(__SIZEOF_INT128__)
+#define RLS_MULHI(a, b) ((UINT64) (((unsigned __int128) (a) * (b)) >> 64))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define RLS_MULHI(a, b) __umulh(a, b)
+#endif
+
+struct RLSDIV {
+	short d;		// divisor (lambda)
+	short s;		// |P|/d = mulhi(|P|, m) >> s
+	UINT64 m;
+};
+
+// Reciprocal for divisors 2..32767, valid for dividends below 2^63
+static void InitRlsDiv(RLSDIV *div, short d)
+{
+	UINT64 q, r;
+	short l = 0;
+
+	div->d = d;
+	div->s = 0;
+	div->m = 0;
+	if (d < 2)
+		return;
+	while ((1 << l) < d) l++;		// l = ceil(log2(d))
+	// m = ceil(2^(63+l)/d) < 2^64
+	q = (((UINT64) 1) << 63) / d;
+	r = (((UINT64) 1) << 63) % d;
+	div->m = (q << l) + ((r << l) / d) + (((r << l) % d) ? 1 : 0);
+	div->s = l - 1;
+}
+
+inline INT64 RlsDiv(INT64 p, const RLSDIV *div)
+{
+#ifdef	RLS_MULHI
+	if (div->m)
+	{
+		UINT64 a = (p > 0) ? p : -p;
+		INT64 q = (INT64) (RLS_MULHI(a, div->m) >> div->s);
+		return((p > 0) ? q : -q);
+	}
+#endif
+	return(p/div->d);
+}
+
+typedef void (*RLSROWMULPROC)(const P_TYPE *p, const int *x, long i, short pscale, INT64 *ya);
+typedef INT64 (*RLSROWUPDATEPROC)(P_TYPE *p, long i, int k, const int *vl, short sh, const RLSDIV *div);
+
+static void RlsRowMulScalar(const P_TYPE *p, const int *x, long i, short pscale, INT64 *ya)
+{
+	INT64 t, y = 0;
+
+	for (long j = 0; j < i; j++)
+	{
+		t = ((p[j]<<pscale)+(INT64) 0x80000000)>>32;
+		y += t * x[j];
+		ya[j] += t * x[i];
+	}
+	t = ((p[i]<<pscale)+(INT64) 0x80000000)>>32;
+	ya[i] += y + t * x[i];
+}
+
+static INT64 RlsRowUpdateScalar(P_TYPE *p, long i, int k, const int *vl, short sh, const RLSDIV *div)
+{
+	INT64 v, mag = 0;
+
+	for (long j = 0; j <= i; j++)
+	{
+		v = p[j] - (((INT64) k * vl[j])>>sh);
+		if (v>=_I64_MAX/2 || v<=_I64_MIN/2)
+			return(-1);
+		v += RlsDiv(v, div);
+		p[j] = v;
+		mag |= (v > 0 ? v : -v);
+	}
+	return(mag);
+}
+
+#ifdef	LMS_SIMD
+LMS_TARGET("avx2") static void RlsRowMulAVX2(const P_TYPE *p, const int *x, long i, short pscale, INT64 *ya)
+{
+	const __m128i ps = _mm_cvtsi32_si128(pscale);
+	const __m256i r = _mm256_set1_epi64x(0x80000000), xi = _mm256_set1_epi64x(x[i]);
+	__m256i acc = _mm256_setzero_si256(), t;
+	__m128i y2;
+	INT64 s[2], y, tt;
+	long j;
+
+	for (j = 0; j + 4 <= i; j += 4)
+	{
+		// The high halves of the rounded elements are multiplied as signed 32-bit values
+		t = _mm256_add_epi64(_mm256_sll_epi64(_mm256_loadu_si256((const __m256i *)(p + j)), ps), r);
+		t = _mm256_srli_epi64(t, 32);
+		acc = _mm256_add_epi64(acc, _mm256_mul_epi32(t, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(x + j)))));
+		_mm256_storeu_si256((__m256i *)(ya + j), _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(ya + j)), _mm256_mul_epi32(t, xi)));
+	}
+	y2 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	_mm_storeu_si128((__m128i *)s, y2);
+	y = s[0] + s[1];
+
+	for (; j < i; j++)
+	{
+		tt = ((p[j]<<pscale)+(INT64) 0x80000000)>>32;
+		y += tt * x[j];
+		ya[j] += tt * x[i];
+	}
+	tt = ((p[i]<<pscale)+(INT64) 0x80000000)>>32;
+	ya[i] += y + tt * x[i];
+}
+
+LMS_TARGET("avx2") static INT64 RlsRowUpdateAVX2(P_TYPE *p, long i, int k, const int *vl, short sh, const RLSDIV *div)
+{
+	const __m128i shift = _mm_cvtsi32_si128(sh), dshift = _mm_cvtsi32_si128(div->s);
+	const __m256i kk = _mm256_set1_epi64x(k), zero = _mm256_setzero_si256();
+	const __m256i hi = _mm256_set1_epi64x(_I64_MAX/2 - 1), lo = _mm256_set1_epi64x(_I64_MIN/2 + 1);
+	const __m256i ml = _mm256_set1_epi64x((INT64) (div->m & 0xffffffff)), mh = _mm256_set1_epi64x((INT64) (div->m >> 32));
+	const __m256i low = _mm256_set1_epi64x(0xffffffff);
+	__m256i v, d, sg, a, ll, lh, hl, q, mag = zero;
+	__m128i m2;
+	INT64 s[2], m;
+	long j;
+
+	for (j = 0; j + 4 <= i + 1; j += 4)
+	{
+		// P(i,j) -= (k*vl[j])>>sh (arithmetic shift of the products)
+		d = _mm256_mul_epi32(kk, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(vl + j))));
+		sg = _mm256_cmpgt_epi64(zero, d);
+		d = _mm256_xor_si256(_mm256_srl_epi64(_mm256_xor_si256(d, sg), shift), sg);
+		v = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(p + j)), d);
+		if (!_mm256_testz_si256(_mm256_or_si256(_mm256_cmpgt_epi64(v, hi), _mm256_cmpgt_epi64(lo, v)), _mm256_set1_epi64x(-1)))
+			return(-1);
+
+		// |P(i,j)|/lambda = mulhi(|P(i,j)|, m) >> s, |P(i,j)| < 2^62
+		sg = _mm256_cmpgt_epi64(zero, v);
+		a = _mm256_sub_epi64(_mm256_xor_si256(v, sg), sg);
+		ll = _mm256_mul_epu32(a, ml);
+		lh = _mm256_mul_epu32(a, mh);
+		hl = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), ml);
+		q = _mm256_add_epi64(_mm256_add_epi64(_mm256_srli_epi64(ll, 32), _mm256_and_si256(lh, low)), _mm256_and_si256(hl, low));
+		q = _mm256_add_epi64(_mm256_srli_epi64(q, 32), _mm256_mul_epu32(_mm256_srli_epi64(a, 32), mh));
+		q = _mm256_add_epi64(q, _mm256_add_epi64(_mm256_srli_epi64(lh, 32), _mm256_srli_epi64(hl, 32)));
+		q = _mm256_srl_epi64(q, dshift);
+
+		// P(i,j) += P(i,j)/lambda (both have the same sign)
+		a = _mm256_add_epi64(a, q);
+		mag = _mm256_or_si256(mag, a);
+		_mm256_storeu_si256((__m256i *)(p + j), _mm256_sub_epi64(_mm256_xor_si256(a, sg), sg));
+	}
+	m2 = _mm_or_si128(_mm256_castsi256_si128(mag), _mm256_extracti128_si256(mag, 1));
+	_mm_storeu_si128((__m128i *)s, m2);
+	m = s[0] | s[1];
+
+	if (j <= i)
+	{
+		INT64 t = RlsRowUpdateScalar(p + j, i - j, k, vl + j, sh, div);
+		if (t < 0)
+			return(-1);
+		m |= t;
+	}
+	return(m);
+}
+#endif
+
+// Get the RLS kernels for the current CPU (selected once)
+static RLSROWMULPROC GetRlsRowMul()
+{
+#ifdef	LMS_SIMD
+	static const RLSROWMULPROC RowMul = (CpuFeatures() & CPU_AVX2) ? RlsRowMulAVX2 : RlsRowMulScalar;
+	return(RowMul);
+#else
+	return(RlsRowMulScalar);
+#endif
+}
+
+static RLSROWUPDATEPROC GetRlsRowUpdate(short sh, const RLSDIV *div)
+{
+#if defined(LMS_SIMD) && defined(RLS_MULHI)
+	static const RLSROWUPDATEPROC RowUpdate = (CpuFeatures() & CPU_AVX2) ? RlsRowUpdateAVX2 : RlsRowUpdateScalar;
+	if ((sh >= 0) && (sh < 64) && div->m)
+		return(RowUpdate);
+#endif
+	return(RlsRowUpdateScalar);
 }
 
 /***********************************************************************/
@@ -208,25 +489,23 @@ void reinit_P(P_TYPE *Pmatrix)
 /***********************************************************************/ 
 void MulMtxVec(P_TYPE *P, int *x, short M, int *yi, short *vscale)
 {
-	short i,j,pscale,nscale;
+	short i,pscale,nscale;
 	INT64 imax,temp,ya[256];
+	P_TYPE *p;
+	RLSROWMULPROC RowMul = GetRlsRowMul();
 	*vscale = 0;
 	imax = 0;
-	temp = 0;
-	// find MSB in Pmatrix
-	for(i=0;i<M;i++)
-		for(j=0;j<=i;j++)
-			temp |= (P[i*M+j]> 0 ? P[i*M+j] : -P[i*M+j]); 
+	// MSB in Pmatrix (see reinit_P)
+	temp = P[P_MAG];
 	// calculate the shift needed to maximize Pmatrix
 	pscale = 63-fast_bitcount(temp);
-	temp = 0;
 	for (i=0; i<M; i++)
-	{
 		ya[i]=0;
-		for (j=0; j<M; j++)
-			ya[i] += (INT64) (((P[i*M+j]<<pscale)+(INT64) 0x80000000)>>32) * x[j];
+	for (i=0, p=P; i<M; p+=++i)
+		RowMul(p, x, i, pscale, ya);
+	temp = 0;
+	for (i=0; i<M; i++)
 		temp |= (ya[i]>0 ? ya[i]:-ya[i]);
-	}
 	nscale = fast_bitcount(temp);
 	if (nscale>28)
 	{
@@ -282,24 +561,30 @@ INT64 MulVecVec(int *x, int *y, short M, short *scale)
 // y		- RLS predicted sample
 // *w		- array of RLS weights length (M)
 // M		- order of RLS
-// *bufl	- array of past M samples
+// *bufl	- ring buffer of past M samples (see buffer_update)
+// *pos		- ring position of bufl
 // lambda	- the forgetting factor in classics RLS filter algorithm
+// legacy	- 1: history update of older builds (see buffer_update_legacy)
 // The routine also compute the error and store in *x
 /*************************************************************************/
 void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M, 
-					 int *bufl, P_TYPE *P, short lambda)
+					 BUF_TYPE *bufl, short *pos, P_TYPE *P, short lambda, short legacy)
 {
-	short i,j,shift,vscale,dscale;
-	INT64 k[256],wtemp,wtemp2,htemp,ir,htemp1;
+	short i,shift,vscale,dscale;
+	INT64 k[256],wtemp,wtemp2,htemp,ir,htemp1,mag;
 	int vl[256],lr,e,shifted_e;
+	P_TYPE *p;
+	RLSDIV div;
+	RLSROWUPDATEPROC RowUpdate;
+	BUF_TYPE *hist = bufl + *pos;	// past M samples, oldest first
 
 	e = (*x-y);					// compute the error in X.4 format
 
 	if (M==0) { return;}		// zero order RLS, just return
 	// Step1. Compute gain vector k
-	MulMtxVec(P, bufl, M, vl, &vscale);
+	MulMtxVec(P, hist, M, vl, &vscale);
 		
-	wtemp = MulVecVec(bufl, vl, M, &dscale);
+	wtemp = MulVecVec(hist, vl, M, &dscale);
 	assert((vscale+dscale)<64);
 	i = 0;
 	while(wtemp> INT_MAX/4 && wtemp!=0) {wtemp>>=1;i++;}
@@ -309,7 +594,7 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 	else
 	{
 		assert(wtemp!=0);
-		reinit_P(P);
+		reinit_P(P, M);
 	}
 	wtemp2 = wtemp;
 	assert(i<90);
@@ -369,22 +654,28 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 		w[i] = (int) wtemp;
 	}
 	vscale += dscale;
-	// Step3. Update P matrix
-	for (i=0; i<M; i++)						// Lower triangular
-		for (j=0; j<=i; j++)
+	// Step3. Update P matrix (lower triangular, see reinit_P)
+	InitRlsDiv(&div, lambda);
+	RowUpdate = GetRlsRowUpdate(14-vscale, &div);
+	mag = 0;
+	for (i=0, p=P; i<M; p+=++i)
+	{
+		wtemp = RowUpdate(p, i, (int) k[i], vl, 14-vscale, &div);
+		if (wtemp<0)
 		{
-			wtemp = ((INT64) k[i] * vl[j])>>(14-vscale);
-			P[i*M+j] -= wtemp;
-			if (P[i*M+j]>=_I64_MAX/2) { reinit_P(P); break; }
-			if (P[i*M+j]<=_I64_MIN/2) { reinit_P(P); break; }
-			wtemp = P[i*M+j]/lambda;
-			P[i*M+j] += wtemp;
+			// Start again with the following rows
+			reinit_P(P, M);
+			mag = P[P_MAG];
 		}
-	for (i=1; i<M; i++)						// Upper triangular
-		for (j=0; j<i; j++)
-			P[j*M+i] = P[i*M+j];
+		else
+			mag |= wtemp;
+	}
+	P[P_MAG] = mag;
 	// Buffer update
-	buffer_update(*x>>4,bufl,M);
+	if (legacy)
+		buffer_update_legacy(*x>>4,bufl,M);
+	else
+		buffer_update(*x>>4,bufl,M,pos);
 	*x = (int) e;
 }
 
@@ -392,11 +683,14 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 // update_ptr_array (Joint Stereo ptr)
 // this routine is used to divide the large weight buffer,
 // **weight and large history buf, **buf into smaller ones
-// based on the c_mode_table definition 
+// based on the mode table definition 
 /***********************************************************/
-void update_ptr_array(W_TYPE **weight,BUF_TYPE **buf,short ch)
+void update_ptr_array(rlslms_buf_ptr *rlslms_ptr,W_TYPE **weight,BUF_TYPE **buf,short ch)
 {
 	short i,j,k;
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+	W_TYPE *(*wptr_j)[MAX_STAGES] = rlslms_ptr->wptr_j;
 	bufptr_j[LEFT][0]=&buf[ch][0];
 	bufptr_j[RIGHT][0]=&buf[ch+1][0];
 	wptr_j[LEFT][0]=&weight[ch][0];
@@ -404,10 +698,10 @@ void update_ptr_array(W_TYPE **weight,BUF_TYPE **buf,short ch)
 	for(j=0;j<2;j++)  // 2 channel 
 	{
 		k = 0;
-		for(i=1;i<=c_mode_table.nstage;i++)
+		for(i=1;i<=table->nstage;i++)
 		{
-			k += c_mode_table.filter_len[i-1];
-			bufptr_j[j][i]=&buf[ch+j][k];
+			k += table->filter_len[i-1];
+			bufptr_j[j][i]=&buf[ch+j][rlslms_ptr->legacy ? k : 2*k];	// mirrored history buffers (see buffer_update_legacy())
 			wptr_j[j][i]=&weight[ch+j][k];
 		}
 	}
@@ -417,29 +711,30 @@ void update_ptr_array(W_TYPE **weight,BUF_TYPE **buf,short ch)
 // update_ptr (mono ptr) 
 // this routine is used to divide the large weight buffer,
 // *weight and large history buf, *buf into smaller ones
-// based on the c_mode_table definition
+// based on the mode table definition
 /***********************************************************/
-void update_ptr(W_TYPE *weight,BUF_TYPE *buf)
+void update_ptr(rlslms_buf_ptr *rlslms_ptr,W_TYPE *weight,BUF_TYPE *buf)
 {
 	short i,k;
-	bufptr[0]=buf;
-	wptr[0]=weight;
+	mtable *table = &rlslms_ptr->mode_table;
+	rlslms_ptr->bufptr[0]=buf;
+	rlslms_ptr->wptr[0]=weight;
 	k = 0;
-	for(i=1;i<=c_mode_table.nstage;i++)
+	for(i=1;i<=table->nstage;i++)
 	{
-		k += c_mode_table.filter_len[i-1];
-		bufptr[i]=&buf[k];
-		wptr[i]=&weight[k];
+		k += table->filter_len[i-1];
+		rlslms_ptr->bufptr[i]=&buf[rlslms_ptr->legacy ? k : 2*k];	// mirrored history buffers (see buffer_update_legacy())
+		rlslms_ptr->wptr[i]=&weight[k];
 	}
 }
 
 /*************************************************************************/
-// initCoefTable - initial the current_table c_mode_table based on 
+// initCoefTable - initial the current table rlslms_ptr->mode_table based on 
 //                 the mode (1 to 3) and sampling_frequence 
 /*************************************************************************/
-void initCoefTable(short mode, unsigned char CoefTable)
+void initCoefTable(rlslms_buf_ptr *rlslms_ptr, short mode, unsigned char CoefTable)
 {		
-	memcpy((void*)&c_mode_table,
+	memcpy((void*)&rlslms_ptr->mode_table,
 		   &table_assigned[MIN(CoefTable,2)][mode],sizeof(mtable));
 }
 
@@ -451,27 +746,32 @@ void initCoefTable(short mode, unsigned char CoefTable)
 void predict_init(rlslms_buf_ptr *rlslms_ptr)
 {
 	short i,j,ch,rls_order;
+	mtable *table = &rlslms_ptr->mode_table;
+	W_TYPE **wptr = rlslms_ptr->wptr;
 
 	ch = rlslms_ptr->channel;
-	rls_order = c_mode_table.filter_len[1];
+	rls_order = table->filter_len[1];
 
-	update_ptr(rlslms_ptr->weight[ch],
+	update_ptr(rlslms_ptr,
+			   rlslms_ptr->weight[ch],
 		       rlslms_ptr->pbuf[ch]);
 
 	for (i=0; i<rls_order; i++)
 		wptr[1][i] = 0;  // RLS filter weight initialized to 0 
 	
-	for (j=LMS_START;j<c_mode_table.nstage;j++)
-		for (i=0; i<c_mode_table.filter_len[j]; i++)
+	for (j=LMS_START;j<table->nstage;j++)
+		for (i=0; i<table->filter_len[j]; i++)
 			wptr[j][i] = 0;
 		
-	for (i=0; i<c_mode_table.nstage; i++)
-		wptr[c_mode_table.nstage][i] = FRACTION;     // 7.24 format
+	for (i=0; i<table->nstage; i++)
+		wptr[table->nstage][i] = FRACTION;     // 7.24 format
 
-	reinit_P(rlslms_ptr->Pmatrix[ch]); // initialize Pmatrix
+	reinit_P(rlslms_ptr->Pmatrix[ch], rls_order); // initialize Pmatrix
 
-	for(j=0;j<TOTAL_LMS_LEN;j++)
+	for(j=0;j<TOTAL_BUF_LEN;j++)
 		rlslms_ptr->pbuf[ch][j] = 0; // reset all buffers
+	for(j=0;j<MAX_STAGES;j++)
+		rlslms_ptr->bufpos[ch][j] = 0;
 }
 
 /**********************************************************************/
@@ -481,7 +781,7 @@ void predict_init(rlslms_buf_ptr *rlslms_ptr)
 // of weights and output the final predictor.  The final error is computed
 // and used to update the weight of the LMS filter only.
 /************************************************************************/
-int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode)
+int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode, int step_size)
 {
 	short i;
 	INT64 y,e,temp;
@@ -498,7 +798,7 @@ int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode)
 	 	x = x + ROUND1(y); // reconstruct the sample from error
 		e = (x<<4) - y;    // compute the true error to update the weight
 	}
-	wchange = c_mode_table.step_size;
+	wchange = step_size;
 	if (e>0)
 	{
 		for (i=LMS_START; i<M; i++)
@@ -585,6 +885,14 @@ inline int gen_rls_predictor(BUF_TYPE *buf, W_TYPE *w, short M)
 // multiplication of two matrix 1xM weight and Mx1 buf, resulting 
 // in a 1x1 predictor value
 /*******************************************************************/  
+inline int lms_output(INT64 y)
+{
+	y >>= 20;   // change y to 28.4 format 
+	if (y > 0x7ffffff)	y = 0x7ffffff;   // clip to 24.4
+	if (y < -0x7ffffff) y = -0x7ffffff;   
+	return((int) y);
+}
+
 inline int gen_predictor(BUF_TYPE *buf, W_TYPE *w, short M)
 {
 	INT64 y;
@@ -594,10 +902,110 @@ inline int gen_predictor(BUF_TYPE *buf, W_TYPE *w, short M)
 	{
 		y += ((INT64) *w++) * *buf++;  // 8.24 * 24.0  -> 32.24
 	}
-	y >>= 20;   // change y to 28.4 format 
-	if (y > 0x7ffffff)	y = 0x7ffffff;   // clip to 24.4
-	if (y < -0x7ffffff) y = -0x7ffffff;   
-	return((int) y);
+	return(lms_output(y));
+}
+
+/*******************************************************************/
+// NLMS kernels
+// The weight update of the current sample and the filter output of
+// the next sample are done in one pass over the history buffer:
+//   w[j] += (hist[j]*fact + 0x8000) >> 16		j = 0..M-1
+//   y = sum of w[j]*hist[j+1]					(new weights)
+// hist[M] must already hold the new sample. The SIMD kernels are
+// only used if fact fits into 32 bits.
+/*******************************************************************/  
+typedef INT64 (*LMSUPDATEPROC)(const BUF_TYPE *hist, W_TYPE *w, long M, INT64 fact);
+
+static INT64 LmsUpdateScalar(const BUF_TYPE *hist, W_TYPE *w, long M, INT64 fact)
+{
+	INT64 y = 0;
+
+	for (long j = 0; j < M; j++)
+	{
+		w[j] = w[j] + (int) (((INT64) hist[j] * fact + 0x8000) >> 16);
+		y += (INT64) w[j] * hist[j+1];
+	}
+	return(y);
+}
+
+#ifdef	LMS_SIMD
+LMS_TARGET("sse4.1") static INT64 LmsUpdateSSE41(const BUF_TYPE *hist, W_TYPE *w, long M, INT64 fact)
+{
+	const __m128i f = _mm_set1_epi32((int) fact), r = _mm_set1_epi64x(0x8000);
+	__m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128(), h, v, lo, hi;
+	INT64 s[2], y;
+	long j;
+
+	for (j = 0; j + 4 <= M; j += 4)
+	{
+		// Weight update of even and odd lanes (only the low 32 bits of the shifted products are kept)
+		h = _mm_loadu_si128((const __m128i *)(hist + j));
+		lo = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epi32(h, f), r), 16);
+		hi = _mm_slli_epi64(_mm_add_epi64(_mm_mul_epi32(_mm_srli_epi64(h, 32), f), r), 16);
+		v = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(w + j)), _mm_blend_epi16(lo, hi, 0xCC));
+		_mm_storeu_si128((__m128i *)(w + j), v);
+
+		// Filter output with the history of the next sample
+		h = _mm_loadu_si128((const __m128i *)(hist + j + 1));
+		acc0 = _mm_add_epi64(acc0, _mm_mul_epi32(v, h));
+		acc1 = _mm_add_epi64(acc1, _mm_mul_epi32(_mm_srli_epi64(v, 32), _mm_srli_epi64(h, 32)));
+	}
+	_mm_storeu_si128((__m128i *)s, _mm_add_epi64(acc0, acc1));
+	y = s[0] + s[1];
+
+	return(y + LmsUpdateScalar(hist + j, w + j, M - j, fact));
+}
+
+LMS_TARGET("avx2") static INT64 LmsUpdateAVX2(const BUF_TYPE *hist, W_TYPE *w, long M, INT64 fact)
+{
+	const __m256i f = _mm256_set1_epi32((int) fact), r = _mm256_set1_epi64x(0x8000);
+	__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), h, v, lo, hi;
+	__m128i acc;
+	INT64 s[2], y;
+	long j;
+
+	for (j = 0; j + 8 <= M; j += 8)
+	{
+		h = _mm256_loadu_si256((const __m256i *)(hist + j));
+		lo = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epi32(h, f), r), 16);
+		hi = _mm256_slli_epi64(_mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(h, 32), f), r), 16);
+		v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(w + j)), _mm256_blend_epi32(lo, hi, 0xAA));
+		_mm256_storeu_si256((__m256i *)(w + j), v);
+
+		h = _mm256_loadu_si256((const __m256i *)(hist + j + 1));
+		acc0 = _mm256_add_epi64(acc0, _mm256_mul_epi32(v, h));
+		acc1 = _mm256_add_epi64(acc1, _mm256_mul_epi32(_mm256_srli_epi64(v, 32), _mm256_srli_epi64(h, 32)));
+	}
+	acc0 = _mm256_add_epi64(acc0, acc1);
+	acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+	_mm_storeu_si128((__m128i *)s, acc);
+	y = s[0] + s[1];
+
+	return(y + LmsUpdateScalar(hist + j, w + j, M - j, fact));
+}
+
+// Select the NLMS kernel for the current CPU
+static LMSUPDATEPROC SelectLmsUpdate()
+{
+	unsigned int f = CpuFeatures();
+
+	if (f & CPU_AVX2)
+		return(LmsUpdateAVX2);
+	if (f & CPU_SSE41)
+		return(LmsUpdateSSE41);
+	return(LmsUpdateScalar);
+}
+#endif
+
+// Get the NLMS kernel for the current CPU (selected once)
+static LMSUPDATEPROC GetLmsUpdate(short M, INT64 fact)
+{
+#ifdef	LMS_SIMD
+	static const LMSUPDATEPROC LmsUpdate = SelectLmsUpdate();
+	if ((M >= 4) && (fact >= INT_MIN) && (fact <= INT_MAX))
+		return(LmsUpdate);
+#endif
+	return(LmsUpdateScalar);
 }
 
 /*************************************************************************/
@@ -608,17 +1016,22 @@ inline int gen_predictor(BUF_TYPE *buf, W_TYPE *w, short M)
 // y		- LMS predicted sample
 // *w		- array of LMS weights length (M)
 // M		- order of LMS
-// *buf 	- array of past M samples
+// *buf 	- ring buffer of past M samples (see buffer_update)
+// *pos		- ring position of buf
 // mu		- the stepsize of the NLMS filter algorithm
 // *pow     - ptr to the energy of the history buffer
+// *ynext	- LMS predicted sample of the next sample (with the new weights)
+// legacy	- 1: history update of older builds (see buffer_update_legacy)
 // The routine also compute the error and store in *x
 /*************************************************************************/
-inline void update_predictor(int *x, int y, BUF_TYPE *buf, 
-							 W_TYPE *w, short M, short mu, INT64 *pow)
+inline void update_predictor(int *x, int y, BUF_TYPE *buf, short *pos,
+							 W_TYPE *w, short M, short mu, INT64 *pow, int *ynext,
+							 short legacy)
 {
-	short i,j;
+	short i;
 	INT64 fact, wtemp,e,wtemp1;
 	int temp;
+	BUF_TYPE *hist = buf + *pos;	// past M samples, oldest first
 
 	// Prediction error
 	e =  (*x - y);   // y is 24.4 format change x to 24.4
@@ -630,17 +1043,31 @@ inline void update_predictor(int *x, int y, BUF_TYPE *buf,
 	fact = ((INT64) e<<(29-i))/(INT64)((wtemp1 + 1)>>i);   
        													
 	//assert(fact<INT_MAX && fact >INT_MIN);
-	for (j=0; j<M; j++)
-		w[j] = w[j] + (int)  (((INT64) buf[j]* (INT64) fact + 0x8000)>>16);
 
 	// NLMS power update
     temp = (*x)>>4;
-	*pow -= (INT64) buf[0] * (INT64) buf[0];
+	*pow -= (INT64) hist[0] * (INT64) hist[0];
 	*pow += (INT64) temp * temp ;
 	if (*pow>_I64_MAX) *pow = _I64_MAX;
 	
-	// Buffer update
-	buffer_update(temp,buf,M);
+	// Weight update and buffer update (see buffer_update). The new sample
+	// is stored in the mirror of the oldest one first, so that hist[1..M]
+	// is the history of the next sample while hist[0] is still available.
+	if (legacy)
+	{
+		if (M>0) GetLmsUpdate(M, fact)(hist, w, M, fact);	// filter output is not used
+		buffer_update_legacy(temp, buf, M);
+		*ynext = gen_predictor(buf, w, M);
+	}
+	else if (M>0)
+	{
+		hist[M] = temp;
+		*ynext = lms_output(GetLmsUpdate(M, fact)(hist, w, M, fact));
+		hist[0] = temp;
+		if (++*pos == M) *pos = 0;
+	}
+	else
+		*ynext = 0;
 
 	// Predictor output
 	*x = (int) e ;
@@ -677,53 +1104,61 @@ void predict(int *x, int *d, long N,
 	INT64 pow[MAX_STAGES]; 
 	int predictor[MAX_STAGES];
 	int temp;
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE **bufptr = rlslms_ptr->bufptr;
+	W_TYPE **wptr = rlslms_ptr->wptr;
+	short *pos = rlslms_ptr->bufpos[ch];
 
 	w			= rlslms_ptr->weight[ch];
 	buf			= rlslms_ptr->pbuf[ch];
 	Pmatrix		= rlslms_ptr->Pmatrix[ch];
-	rls_order	= c_mode_table.filter_len[1];
-	update_ptr(w,buf);	
+	rls_order	= table->filter_len[1];
+	update_ptr(rlslms_ptr,w,buf);	
+	check_bufpos(pos, table);
 	
-	lambda		= c_mode_table.lambda[!RA];
+	lambda		= table->lambda[!RA];
 
-	for(j=LMS_START;j<c_mode_table.nstage;j++)
-		cal_power(&pow[j], bufptr[j], c_mode_table.filter_len[j]);
+	// The LMS predictors of the following samples are generated by update_predictor()
+	for(j=LMS_START;j<table->nstage;j++)
+	{
+		cal_power(&pow[j], bufptr[j]+pos[j], table->filter_len[j]);
+		predictor[j]=gen_predictor(	bufptr[j]+pos[j], wptr[j], 
+									table->filter_len[j]);
+	}
 	
 	for(i=0;i<N;i++)
 	{
-		if (RA && i>300) lambda = c_mode_table.lambda[1];		
+		if (RA && i>300) lambda = table->lambda[1];		
 		// Cascade LMS predictors
 		predictor[0] = *bufptr[0]<<4;
-		predictor[1] = gen_rls_predictor(bufptr[1],	wptr[1],rls_order);
+		predictor[1] = gen_rls_predictor(bufptr[1]+pos[1], wptr[1],rls_order);
 
-		for(j=LMS_START;j<c_mode_table.nstage;j++)
-			predictor[j]=gen_predictor(	bufptr[j], wptr[j], 
-										c_mode_table.filter_len[j]);
 		if (mode==ENCODE) // encoding
 		{
 			temp = (x[i]<<4)-(predictor[0]);
 			*bufptr[0]=x[i];
-			d[i] = SignLMS(x[i],predictor,wptr[c_mode_table.nstage],
-					           c_mode_table.nstage, RA, ENCODE);
+			d[i] = SignLMS(x[i],predictor,wptr[table->nstage],
+					           table->nstage, RA, ENCODE, table->step_size);
 		}
 		else // decoding
 		{
-			x[i] = SignLMS(	d[i],predictor,wptr[c_mode_table.nstage],
-								c_mode_table.nstage, RA, DECODE);
+			x[i] = SignLMS(	d[i],predictor,wptr[table->nstage],
+								table->nstage, RA, DECODE, table->step_size);
 			temp = (x[i]<<4)-(predictor[0]);
 			*bufptr[0]=x[i];
 		}
 		// update RLS filter weight and Pmatrix
-		UpdateRLSFilter(&temp,predictor[1],wptr[1], rls_order, bufptr[1], 
-						Pmatrix, lambda);
+		UpdateRLSFilter(&temp,predictor[1],wptr[1], rls_order, bufptr[1], &pos[1],
+						Pmatrix, lambda, rlslms_ptr->legacy);
 		// update LMS filter weight
 		if ((RA && i>RA_TRANS) || !RA)
 		{
-			for(j=LMS_START;j<c_mode_table.nstage;j++)
+			for(j=LMS_START;j<table->nstage;j++)
 			{
-				update_predictor(&temp,predictor[j], bufptr[j],  wptr[j], 
-								c_mode_table.filter_len[j], 
-								c_mode_table.opt_mu[j], &pow[j]);
+				update_predictor(&temp,predictor[j], bufptr[j], &pos[j], wptr[j], 
+								table->filter_len[j], 
+								table->opt_mu[j], &pow[j], &predictor[j],
+								rlslms_ptr->legacy);
 			}
 		}
 	}  //End of sample loop
@@ -758,42 +1193,54 @@ void predict_joint(int *x_left, int *x_right, long N,
 	long i;
 	short j, k, lambda, ch, rls_order;
 	INT64 pow[2][MAX_STAGES];
-	int predictor[MAX_STAGES],temp;
+	int predictor_j[2][MAX_STAGES],temp;
+	int *predictor;
 	int *ch_ptr[2];
+	short *pos_j[2];
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+	W_TYPE *(*wptr_j)[MAX_STAGES] = rlslms_ptr->wptr_j;
 
 	w			= rlslms_ptr->weight;
 	buf			= rlslms_ptr->pbuf;
 	Pmatrix		= rlslms_ptr->Pmatrix;
 	ch			= rlslms_ptr->channel;
-	rls_order	= c_mode_table.filter_len[1];
+	rls_order	= table->filter_len[1];
+	pos_j[LEFT]	= rlslms_ptr->bufpos[ch];
+	pos_j[RIGHT]= rlslms_ptr->bufpos[ch+1];
 
-	update_ptr_array(w,buf,ch);
+	update_ptr_array(rlslms_ptr,w,buf,ch);
+	check_bufpos(pos_j[LEFT], table);
+	check_bufpos(pos_j[RIGHT], table);
 
-	lambda = c_mode_table.lambda[!RA];
+	lambda = table->lambda[!RA];
 	ch_ptr[0] = x_left;
 	ch_ptr[1] = x_right;
 
+	// The LMS predictors of the following samples are generated by update_predictor()
     for(i=0;i<2;i++)  //  2 channel ch, ch+1
-		for(j=LMS_START;j<c_mode_table.nstage;j++)
-			cal_power(&pow[i][j], bufptr_j[i][j], 
-			          c_mode_table.filter_len[j]);
+		for(j=LMS_START;j<table->nstage;j++)
+		{
+			cal_power(&pow[i][j], bufptr_j[i][j]+pos_j[i][j], 
+			          table->filter_len[j]);
+			predictor_j[i][j]=gen_predictor(	bufptr_j[i][j]+pos_j[i][j],
+												wptr_j[i][j], 
+												table->filter_len[j]);
+		}
 
 	for(i=0;i<N;i++)
 	{
 		// reset to normal lambda after 300 samples 
-		if (RA && i>300) lambda = c_mode_table.lambda[1]; 
+		if (RA && i>300) lambda = table->lambda[1]; 
 		// loop for each channel 
 		for(k=0;k<2;k++)	
 		{
 			// Generation of all the various predictors
+			predictor = predictor_j[k];
 			predictor[0] = *bufptr_j[k][0]<<4;
-			predictor[1] = gen_rls_predictor(	bufptr_j[LEFT][1],
+			predictor[1] = gen_rls_predictor(	bufptr_j[LEFT][1]+pos_j[LEFT][1],
 												wptr_j[k][1],
 												rls_order);
-			for(j=LMS_START;j<c_mode_table.nstage;j++)
-				predictor[j]=gen_predictor(	bufptr_j[k][j],
-											wptr_j[k][j], 
-											c_mode_table.filter_len[j]);
 			
 			if (mode==ENCODE) // encoding mode
 			{
@@ -802,35 +1249,218 @@ void predict_joint(int *x_left, int *x_right, long N,
 
 				// combine weight update and compute the error signal
 				ch_ptr[k][i] = SignLMS(	ch_ptr[k][i], predictor,
-										wptr_j[k][c_mode_table.nstage],
-										c_mode_table.nstage, RA, ENCODE);
+										wptr_j[k][table->nstage],
+										table->nstage, RA, ENCODE, table->step_size);
 			}
 			else // decoding mode
 			{
 				// combine weight update and restore x from residual error
 				ch_ptr[k][i] = SignLMS(	ch_ptr[k][i], predictor,
-										wptr_j[k][c_mode_table.nstage],
-										c_mode_table.nstage, RA, DECODE);
+										wptr_j[k][table->nstage],
+										table->nstage, RA, DECODE, table->step_size);
 
 				*bufptr_j[k][0]=ch_ptr[k][i];				// DPCM buf update	
 				temp = (ch_ptr[k][i]<<4)-predictor[0];		// error computation.
 			}
 			// RLS filter updates
 			UpdateRLSFilter(	&temp, predictor[1], wptr_j[k][1], 
-								rls_order, bufptr_j[LEFT][1], Pmatrix[k], 
-								lambda);		
+								rls_order, bufptr_j[LEFT][1], &pos_j[LEFT][1],
+								Pmatrix[k], lambda, rlslms_ptr->legacy);		
 			// LMS filter updates
 			if ((RA && i>RA_TRANS) || !RA)
 			{
-				for(j=LMS_START;j<c_mode_table.nstage;j++)
+				for(j=LMS_START;j<table->nstage;j++)
 					update_predictor(	&temp, predictor[j], bufptr_j[k][j],
-										wptr_j[k][j], c_mode_table.filter_len[j], 
-										c_mode_table.opt_mu[j], &pow[k][j]);
+										&pos_j[k][j], wptr_j[k][j], table->filter_len[j], 
+										table->opt_mu[j], &pow[k][j], &predictor[j],
+										rlslms_ptr->legacy);
 			}
 		} // end of channel
 	}// end of a sample
 }
 
+/***********************************************************************/
+// predict_joint_dpcm, analyze_joint_rls and predict_joint_lms 
+// (joint stereo, encoding only)
+// predict_joint() for encoding, split into the DPCM stage, the RLS stage
+// of each channel and the NLMS stages. 
+// The RLS stages of all channel pairs use Pmatrix[0] and Pmatrix[1], so
+// they have to be run for the pairs in order. Both channels share the 
+// RLS history of the left channel, which gets the DPCM errors of both
+// channels in turn. It only depends on the input, so that the RLS stage
+// of the left channel can run in parallel to the one of the right channel
+// on a copy of the history. The NLMS stages of a pair only depend on its
+// own state, so predict_joint_lms() can run in parallel to the other pairs.
+// rlsbuf[0..6*N-1] holds the DPCM and RLS predictions and the RLS error
+// of both channels, rlsbuf[6*N..] the copy of the history and its ring
+// position (see JS_RLSBUF_LEN).
+/***********************************************************************/  
+static void predict_joint_dpcm(int *x_left, int *x_right, long N, 
+							   rlslms_buf_ptr *rlslms_ptr, int *rlsbuf)
+{
+	BUF_TYPE **buf;
+	W_TYPE **w;
+	BUF_TYPE *hist;
+	long i;
+	short j, k, ch, rls_order;
+	int *ch_ptr[2];
+	short *pos_j[2];
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+
+	w			= rlslms_ptr->weight;
+	buf			= rlslms_ptr->pbuf;
+	ch			= rlslms_ptr->channel;
+	rls_order	= table->filter_len[1];
+	pos_j[LEFT]	= rlslms_ptr->bufpos[ch];
+	pos_j[RIGHT]= rlslms_ptr->bufpos[ch+1];
+
+	update_ptr_array(rlslms_ptr,w,buf,ch);
+	check_bufpos(pos_j[LEFT], table);
+	check_bufpos(pos_j[RIGHT], table);
+
+	ch_ptr[0] = x_left;
+	ch_ptr[1] = x_right;
+	for(k=0;k<2;k++)
+	{
+		for(i=0;i<N;i++)
+		{
+			rlsbuf[3*k*N+i] = *bufptr_j[k][0]<<4;
+			*bufptr_j[k][0]=ch_ptr[k][i];		// DPCM buf update
+			rlsbuf[(3*k+2)*N+i] = (ch_ptr[k][i]<<4)-rlsbuf[3*k*N+i]; // error computation.
+		}
+	}
+
+	// RLS history for the left channel
+	hist = rlsbuf + 6*N;
+	for (j=0; j<2*rls_order; j++)
+		hist[j] = bufptr_j[LEFT][1][j];
+	hist[2*JS_LEN] = pos_j[LEFT][1];
+}
+
+/***********************************************************************/
+// analyze_joint_rls - RLS stage of channel k (LEFT or RIGHT) of a joint 
+// stereo pair after analyze_joint_init(), see predict_joint_dpcm().
+// The calls for both channels may run in parallel, each with its own
+// copy of *rlslms_ptr.
+/***********************************************************************/  
+void analyze_joint_rls(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr, 
+					   short RA, short k, int *rlsbuf)
+{
+	BUF_TYPE **buf;
+	W_TYPE **w;
+	P_TYPE **Pmatrix; 
+	BUF_TYPE *hist;
+	long i;
+	short lambda, ch, rls_order, posl;
+	short *pos;
+	int predictor,temp;
+	int *ch_ptr[2];
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+	W_TYPE *(*wptr_j)[MAX_STAGES] = rlslms_ptr->wptr_j;
+
+	w			= rlslms_ptr->weight;
+	buf			= rlslms_ptr->pbuf;
+	Pmatrix		= rlslms_ptr->Pmatrix;
+	ch			= rlslms_ptr->channel;
+	rls_order	= table->filter_len[1];
+
+	update_ptr_array(rlslms_ptr,w,buf,ch);
+
+	lambda = table->lambda[!RA];
+	ch_ptr[0] = x0;
+	ch_ptr[1] = x1;
+	if (k == LEFT)
+	{
+		hist = rlsbuf + 6*N;
+		posl = static_cast<short>(hist[2*JS_LEN]);
+		pos = &posl;
+	}
+	else
+	{
+		hist = bufptr_j[LEFT][1];
+		pos = &rlslms_ptr->bufpos[ch][1];
+	}
+
+	for(i=0;i<N;i++)
+	{
+		// reset to normal lambda after 300 samples 
+		if (RA && i>300) lambda = table->lambda[1]; 
+		if (k == RIGHT)
+			buffer_update(((ch_ptr[LEFT][i]<<4)-rlsbuf[i])>>4, hist, rls_order, pos);
+
+		predictor = gen_rls_predictor(hist+*pos, wptr_j[k][1], rls_order);
+		temp = rlsbuf[(3*k+2)*N+i];
+
+		// RLS filter updates
+		UpdateRLSFilter(	&temp, predictor, wptr_j[k][1], 
+							rls_order, hist, pos,
+							Pmatrix[k], lambda, 0);		
+
+		rlsbuf[(3*k+1)*N+i] = predictor;
+		rlsbuf[(3*k+2)*N+i] = temp;
+
+		if (k == LEFT)
+			buffer_update(((ch_ptr[RIGHT][i]<<4)-rlsbuf[3*N+i])>>4, hist, rls_order, pos);
+	}
+}
+
+static void predict_joint_lms(int *x_left, int *x_right, long N, 
+							  rlslms_buf_ptr *rlslms_ptr, short RA, const int *rlsbuf)
+{
+	long i;
+	short j, k, ch;
+	INT64 pow[MAX_STAGES];
+	int predictor[MAX_STAGES],temp;
+	int *x;
+	short *pos;
+	const int *rls;
+	mtable *table = &rlslms_ptr->mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+	W_TYPE *(*wptr_j)[MAX_STAGES] = rlslms_ptr->wptr_j;
+
+	ch = rlslms_ptr->channel;
+	update_ptr_array(rlslms_ptr,rlslms_ptr->weight,rlslms_ptr->pbuf,ch);
+
+	for(k=0;k<2;k++)  //  2 channel ch, ch+1
+	{
+		x = k ? x_right : x_left;
+		pos = rlslms_ptr->bufpos[ch+k];
+		rls = rlsbuf + 3*k*N;
+
+		// The LMS predictors of the following samples are generated by update_predictor()
+		for(j=LMS_START;j<table->nstage;j++)
+		{
+			cal_power(&pow[j], bufptr_j[k][j]+pos[j], table->filter_len[j]);
+			predictor[j]=gen_predictor(	bufptr_j[k][j]+pos[j],
+										wptr_j[k][j], 
+										table->filter_len[j]);
+		}
+
+		for(i=0;i<N;i++)
+		{
+			predictor[0] = rls[i];
+			predictor[1] = rls[N+i];
+
+			// combine weight update and compute the error signal
+			x[i] = SignLMS(	x[i], predictor, wptr_j[k][table->nstage],
+							table->nstage, RA, ENCODE, table->step_size);
+
+			// LMS filter updates
+			temp = rls[2*N+i];
+			if ((RA && i>RA_TRANS) || !RA)
+			{
+				for(j=LMS_START;j<table->nstage;j++)
+					update_predictor(	&temp, predictor[j], bufptr_j[k][j],
+										&pos[j], wptr_j[k][j], table->filter_len[j], 
+										table->opt_mu[j], &pow[j], &predictor[j],
+										rlslms_ptr->legacy);
+			}
+		}
+	}
+}
+
 /*******************************************************************/
 // return the index of the table who value is greater or equal
 // to the input value mu
@@ -848,7 +1478,7 @@ short lookup_mu(short mu)
 // return the index of the table who value is greater or equal
 // to the input value 
 /********************************************************************/
-short lookup_table(short *table, short value)
+short lookup_table(const short *table, short value)
 {
 	int i;
 	for(i=0;i<32;i++)
@@ -940,13 +1570,41 @@ void synthesize(int *x, long N, rlslms_buf_ptr *rlslms_ptr,
 void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 				   short RA, short IntRes, short *mono_frame, 
 				   MCC_ENC_BUFFER *mccbuf)
+{
+	int *rlsbuf = new int[JS_RLSBUF_LEN(N)];
+	if (analyze_joint_init(x0, x1, N, rlslms_ptr, RA, IntRes, mono_frame, mccbuf, rlsbuf))
+	{
+		if (!*mono_frame)
+		{
+			analyze_joint_rls(x0, x1, N, rlslms_ptr, RA, LEFT, rlsbuf);
+			analyze_joint_rls(x0, x1, N, rlslms_ptr, RA, RIGHT, rlsbuf);
+		}
+		analyze_joint_lms(x0, x1, N, rlslms_ptr, RA, IntRes, *mono_frame, mccbuf, rlsbuf);
+	}
+	delete [] rlsbuf;
+}
+
+/*******************************************************************/
+// analyze_joint_init, analyze_joint_rls and analyze_joint_lms
+// analyze_joint() in parts, see predict_joint_dpcm(). 
+// analyze_joint_init() also updates old_flag, and the RLS stages use
+// the P matrices of the previous pair, so they have to be called for
+// the channel pairs in order. analyze_joint_init() returns 0 if the
+// pair is done (both blocks are zero or constant). Otherwise a joint
+// frame (*mono_frame 0) continues with analyze_joint_rls() of both 
+// channels, and both frame types end with analyze_joint_lms() to get 
+// the residual errors. rlsbuf has JS_RLSBUF_LEN(N) elements.
+/*******************************************************************/ 
+short analyze_joint_init(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
+						 short RA, short IntRes, short *mono_frame, 
+						 MCC_ENC_BUFFER *mccbuf, int *rlsbuf)
 {
 	char *xpr0, *xpr1;
 	long i;
-	short ch;
-	static short old_flag=0;
+	short ch, rls_order;
 	int x2[65536],d[65536];
 	ch = rlslms_ptr->channel;
+	rls_order = rlslms_ptr->mode_table.filter_len[1];
 	xpr0 = &mccbuf->m_xpara[ch];
 	xpr1 = &mccbuf->m_xpara[ch+1];
 	if (RA) // random access
@@ -970,19 +1628,19 @@ void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 
 	if (*xpr0!=0 && *xpr1!=0) /* both block is zero */
 	{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
-			return; 
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order);
+			return(0); 
 	} 
 	if (Left_equal_Right(x0,x1,x2,N)<=36*N)
 	{
 		*xpr0 = *xpr1 = 0;
-		if (old_flag == 0) 
+		if (rlslms_ptr->old_flag == 0) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order);
 		}
-		old_flag = 1;
+		rlslms_ptr->old_flag = 1;
 		*mono_frame = 1;
 		for(i=0;i<N;i++) x1[i]-=x0[i];
 		predict(x0, d, N, rlslms_ptr,ch,RA,ENCODE);
@@ -991,15 +1649,29 @@ void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 	else
 	{
 		*xpr0 = *xpr1 = 0;
-		if (old_flag==1)
+		if (rlslms_ptr->old_flag==1)
 		{
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order);
 		}
-		old_flag = 0;
+		rlslms_ptr->old_flag = 0;
 		*mono_frame = 0;
-		predict_joint(x0, x1, N, rlslms_ptr, RA, ENCODE);
+		predict_joint_dpcm(x0, x1, N, rlslms_ptr, rlsbuf);
 	}
+	return(1);
+}
+
+void analyze_joint_lms(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
+					   short RA, short IntRes, short mono_frame, 
+					   MCC_ENC_BUFFER *mccbuf, const int *rlsbuf)
+{
+	char *xpr0, *xpr1;
+	short ch;
+	ch = rlslms_ptr->channel;
+	xpr0 = &mccbuf->m_xpara[ch];
+	xpr1 = &mccbuf->m_xpara[ch+1];
+	if (!mono_frame)
+		predict_joint_lms(x0, x1, N, rlslms_ptr, RA, rlsbuf);
 	if (BlockIsZero(x0, N))	
 		*xpr0 = 1;
 	else if (BlockIsConstant(x0, N, IntRes)) 
@@ -1024,9 +1696,9 @@ void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 	int d[65536];
 	char *xpr0,*xpr1;
 	long i;
-	short ch;
-	static short old_flag=0;
+	short ch, rls_order;
 	ch = rlslms_ptr->channel;
+	rls_order = rlslms_ptr->mode_table.filter_len[1];
 	xpr0 = &mccbuf->m_xpara[ch];
 	xpr1 = &mccbuf->m_xpara[ch+1];
 	// ZERO BLOCK
@@ -1041,30 +1713,30 @@ void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 
 	if (*xpr0!=0 && *xpr1!=0) /* both block are zero or constant */
 	{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order);
 			return; 
 	} 
     if (mono_frame==1)
 	{
-		if (old_flag==0) 
+		if (rlslms_ptr->old_flag==0) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order);
 		}
 		for(i=0;i<N;i++) d[i]=x0[i];
 		predict(x0, d, N, rlslms_ptr, ch, RA, DECODE);
 		for(i=0;i<N;i++) x1[i]+=x0[i];
-		old_flag = 1;
+		rlslms_ptr->old_flag = 1;
 	}
 	else
 	{
-		if (old_flag==1) 
+		if (rlslms_ptr->old_flag==1) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]); 
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]); 
+			reinit_P(rlslms_ptr->Pmatrix[ch], rls_order); 
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rls_order); 
 		}
-		old_flag = 0;
+		rlslms_ptr->old_flag = 0;
 		predict_joint(x0, x1, N, rlslms_ptr, RA, DECODE);
 	}
 }
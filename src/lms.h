@@ -55,6 +55,7 @@ contents : Header file for lms.h
 #else
 	#include <stdint.h>
 	typedef int64_t INT64;
+	typedef uint64_t UINT64;
 	#define _I64_MAX 9223372036854775807LL
 	#define _I64_MIN (-9223372036854775807LL - 1LL)
 	#define JS_INIT_P 115292150460684LL 
@@ -69,13 +70,16 @@ contents : Header file for lms.h
 #define JS_LEN1 30
 #define JS_LEN2	30
 #define JS_LEN (JS_LEN1+JS_LEN2)
+#define P_MAG (JS_LEN*JS_LEN-1)	// element of the P matrix buffer with the OR of all magnitudes, see reinit_P()
 #define JS_LAMBDA 999         // 0.999
+#define JS_RLSBUF_LEN(N) (6*(N)+2*JS_LEN+1)	// buffer of analyze_joint_init() for a block of length N
 
 
 #define LMS_START 2
 
 #define LMS_LEN 1024*8   
 #define TOTAL_LMS_LEN LMS_LEN // depend on how many predictor stage
+#define TOTAL_BUF_LEN (2*TOTAL_LMS_LEN) // mirrored history buffers, see buffer_update()
 #define LMS_MU_INT  16777 // 7.24 format for 0.001
 
 #define FRACTION (1L <<24)
@@ -96,27 +100,37 @@ struct rlslms_buf_ptr {
 	BUF_TYPE **pbuf;
 	W_TYPE **weight;
 	P_TYPE **Pmatrix;
+	short (*bufpos)[MAX_STAGES];		// ring position of the history buffer of each stage (per channel)
     short channel; // which channel is currently processing		
+	mtable mode_table;					// the current table used in the encode/decode
+	BUF_TYPE *bufptr[MAX_STAGES];		// history buffer of each stage (mono)
+	W_TYPE *wptr[MAX_STAGES];			// weights of each stage (mono)
+	BUF_TYPE *bufptr_j[2][MAX_STAGES];	// history buffer of each stage (joint stereo)
+	W_TYPE *wptr_j[2][MAX_STAGES];		// weights of each stage (joint stereo)
+	short old_flag;						// last joint stereo frame was coded as mono
+	short legacy;						// 1: history update of older builds (see buffer_update_legacy())
 };
 
 void analyze(int *x, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, MCC_ENC_BUFFER *mccbuf);
 void synthesize(int *x, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, MCC_DEC_BUFFER *mccbuf);
 void analyze_joint(int *x0, int *x1, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, short *mono, MCC_ENC_BUFFER *mccbuf);
+short analyze_joint_init(int *x0, int *x1, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, short *mono, MCC_ENC_BUFFER *mccbuf, int *rlsbuf);
+void analyze_joint_rls(int *x0, int *x1, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short k, int *rlsbuf);
+void analyze_joint_lms(int *x0, int *x1, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, short mono, MCC_ENC_BUFFER *mccbuf, const int *rlsbuf);
 void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr, short RA, short mono, MCC_DEC_BUFFER *mccbuf);
 void predict_init(rlslms_buf_ptr *ptr);
-void initCoefTable(short mode, unsigned char CoefTable);
+void initCoefTable(rlslms_buf_ptr *ptr, short mode, unsigned char CoefTable);
 
 
 extern short BlockIsZero(int *x, long N);
 extern int BlockIsConstant(int *x, long N, short IntRes);
 extern short ShiftOutEmptyLSBs(int *x, long N);
 extern short lookup_mu(short mu);
-extern short lookup_table(short *,short mu);
+extern short lookup_table(const short *,short mu);
 
 
-extern mtable c_mode_table;
-extern mtable safe_mode_table;
-extern mtable *table_assigned[3];
-extern char mu_table[32];
-extern short lms_order_table[32]; 
+extern const mtable safe_mode_table;
+extern const mtable *table_assigned[3];
+extern const char mu_table[32];
+extern const short lms_order_table[32]; 
 #endif
@@ -67,9 +67,328 @@ contents : Linear prediction and related functions
 #include <memory.h>
 #include <limits.h>
 
+#include <map>
+#include <vector>
+#include "lpc.h"
+
+// SIMD kernels (prediction filters, ACF) are used on x86-64 if the CPU supports them
+#if defined(__x86_64__) || defined(_M_X64)
+#define LPC_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LPC_TARGET(t)
+#else
+#include <cpuid.h>
+#define LPC_TARGET(t) __attribute__ ((target (t)))
+#endif
+#endif
+
 #define MIN(a, b)  (((a) < (b)) ? (a) : (b)) 
 #define PI 3.14159265359
 #define LN2 0.69314718056
+#define ACF_FFT_RATIO 20		// Use the FFT if N*(k+1) >= ACF_FFT_RATIO*M*log2(M)
+
+#ifdef	LPC_SIMD
+#define CPU_SSE41	0x01
+#define CPU_AVX		0x02
+#define CPU_AVX2	0x04
+
+// Check the CPU (and OS support for AVX state)
+static unsigned int DetectCpu()
+{
+	unsigned int info[4] = { 0, 0, 0, 0 }, info7[4] = { 0, 0, 0, 0 };
+	unsigned int f = 0;
+
+#ifdef _MSC_VER
+	__cpuid((int *)info, 0);
+	if (info[0] >= 7)
+		__cpuidex((int *)info7, 7, 0);
+	__cpuid((int *)info, 1);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
+	{
+		if ((_xgetbv(0) & 6) == 6)
+			f |= CPU_AVX;
+	}
+#else
+	if (__get_cpuid_max(0, NULL) >= 7)
+		__cpuid_count(7, 0, info7[0], info7[1], info7[2], info7[3]);
+	__get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE, AVX
+	{
+		unsigned int lo, hi;
+		__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+		if ((lo & 6) == 6)
+			f |= CPU_AVX;
+	}
+#endif
+
+	if ((f & CPU_AVX) && (info7[1] & (1 << 5)))
+		f |= CPU_AVX2;
+	if (info[2] & (1 << 19))
+		f |= CPU_SSE41;
+	return(f);
+}
+
+// CPU features (checked once)
+static unsigned int CpuFeatures()
+{
+	static const unsigned int Features = DetectCpu();
+	return(Features);
+}
+#endif
+
+// Tables cached by each thread
+struct CLpcTables
+{
+	std::map<long, std::vector<double> > Window[4];	// Window functions [type][block length]
+	long FFTsize;									// Size of the FFT twiddle factors
+	std::vector<double> Cos, Sin;					// FFT twiddle factors
+	std::vector<double> Re, Im, Pow;				// FFT buffers, power spectrum
+	std::vector<double> Xd;							// Windowed block (GetCof)
+
+	CLpcTables() : FFTsize( 0 ) {}
+};
+
+static CLpcTables &GetLpcTables()
+{
+	static thread_local CLpcTables Tables;
+	return(Tables);
+}
+
+// Get window function win (0 = hanning, 1 = hamming, 3 = blackman) for N samples
+static const double *GetWindow(short win, long N)
+{
+	std::map<long, std::vector<double> > &Cache = GetLpcTables().Window[win];
+	std::map<long, std::vector<double> >::iterator it = Cache.find(N);
+	long n;
+
+	if (it != Cache.end())
+		return(&it->second[0]);
+
+	if (Cache.size() >= 32)		// many different block lengths
+		Cache.clear();
+
+	std::vector<double> &w = Cache[N];
+	w.resize(N + 1);
+	for (n = 0; n < N; n++)
+	{
+		if (win == 1)
+			w[n] = 0.54 - 0.46 * cos(2.0*PI*n/(N-1));
+		else if (win == 3)
+			w[n] = 0.42 - 0.5 * cos(2.0*PI*n/(N-1)) + 0.08 * cos(4.0*PI*n/(N-1));
+		else
+			w[n] = 0.5 - 0.5 * cos(2.0*PI*n/(N-1));
+	}
+	return(&w[0]);
+}
+
+// ACF of the lags i0...k, direct calculation
+static void AcfDirect(const double *x, long N, long i0, long k, double *rxx)
+{
+	long i, n;
+
+	for (i = i0; i <= k; i++)
+	{
+		rxx[i] = 0.0;
+		for (n = i; n < N; n++)
+			rxx[i] += x[n] * x[n-i];
+	}
+}
+
+#ifdef	LPC_SIMD
+// ACF, direct calculation of 4 (SSE2) or 8 (AVX) lags at once. Each lag is summed
+// up in the same order as in AcfDirect(), so the results are identical.
+static void AcfHead(const double *x, long i, long L, double *h)
+{
+	long j, n;
+
+	// Terms of lag i+j which precede the vector loop (n < i+L-1)
+	for (j = 0; j < L; j++)
+	{
+		h[j] = 0.0;
+		for (n = i + j; n < i + L - 1; n++)
+			h[j] += x[n] * x[n-i-j];
+	}
+}
+
+static void AcfSSE2(const double *x, long N, long i0, long k, double *rxx)
+{
+	__m128d acc0, acc1, xn;
+	double h[4], t[4];
+	long i, n;
+
+	for (i = i0; (i + 3 <= k) && (i + 3 < N); i += 4)
+	{
+		// Lanes hold the lags (i+1, i) and (i+3, i+2)
+		AcfHead(x, i, 4, h);
+		acc0 = _mm_set_pd(h[0], h[1]);
+		acc1 = _mm_set_pd(h[2], h[3]);
+		for (n = i + 3; n < N; n++)
+		{
+			xn = _mm_set1_pd(x[n]);
+			acc0 = _mm_add_pd(acc0, _mm_mul_pd(xn, _mm_loadu_pd(x + n - i - 1)));
+			acc1 = _mm_add_pd(acc1, _mm_mul_pd(xn, _mm_loadu_pd(x + n - i - 3)));
+		}
+		_mm_storeu_pd(t, acc0);
+		_mm_storeu_pd(t + 2, acc1);
+		rxx[i] = t[1];
+		rxx[i+1] = t[0];
+		rxx[i+2] = t[3];
+		rxx[i+3] = t[2];
+	}
+
+	AcfDirect(x, N, i, k, rxx);		// remaining lags
+}
+
+LPC_TARGET("avx") static void AcfAVX(const double *x, long N, long i0, long k, double *rxx)
+{
+	__m256d acc0, acc1, xn;
+	double h[8], t[8];
+	long i, n;
+
+	for (i = i0; (i + 7 <= k) && (i + 7 < N); i += 8)
+	{
+		// Lanes hold the lags (i+3 ... i) and (i+7 ... i+4)
+		AcfHead(x, i, 8, h);
+		acc0 = _mm256_set_pd(h[0], h[1], h[2], h[3]);
+		acc1 = _mm256_set_pd(h[4], h[5], h[6], h[7]);
+		for (n = i + 7; n < N; n++)
+		{
+			xn = _mm256_set1_pd(x[n]);
+			acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(xn, _mm256_loadu_pd(x + n - i - 3)));
+			acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(xn, _mm256_loadu_pd(x + n - i - 7)));
+		}
+		_mm256_storeu_pd(t, acc0);
+		_mm256_storeu_pd(t + 4, acc1);
+		for (n = 0; n < 4; n++)
+		{
+			rxx[i+n] = t[3-n];
+			rxx[i+4+n] = t[7-n];
+		}
+	}
+
+	AcfSSE2(x, N, i, k, rxx);		// remaining lags
+}
+#endif
+
+// Twiddle factors for a real FFT of M values: e^(-2*pi*i*j/M), j = 0...M/2-1
+static void SetTwiddles(CLpcTables &T, long M)
+{
+	if (T.FFTsize == M)
+		return;
+
+	T.Cos.resize(M / 2);
+	T.Sin.resize(M / 2);
+	for (long j = 0; j < M / 2; j++)
+	{
+		T.Cos[j] = cos(2.0*PI*j/M);
+		T.Sin[j] = sin(2.0*PI*j/M);
+	}
+	T.FFTsize = M;
+}
+
+// In-place radix-2 FFT of n = M/2 complex values, inverse FFT (without scaling) if inv
+static void FFT(CLpcTables &T, double *re, double *im, long n, bool inv)
+{
+	long i, j, l, m, len, half, step;
+	double wr, wi, tr, ti;
+
+	// Bit reversal
+	for (i = 1, j = 0; i < n; i++)
+	{
+		for (m = n >> 1; j & m; m >>= 1)
+			j ^= m;
+		j |= m;
+		if (i < j)
+		{
+			tr = re[i]; re[i] = re[j]; re[j] = tr;
+			ti = im[i]; im[i] = im[j]; im[j] = ti;
+		}
+	}
+
+	// Butterflies, block by block to keep the accesses sequential
+	for (len = 2; len <= n; len <<= 1)
+	{
+		half = len >> 1;
+		step = 2 * n / len;
+		for (l = 0; l < n; l += len)
+		{
+			for (j = 0; j < half; j++)
+			{
+				wr = T.Cos[j * step];
+				wi = inv ? T.Sin[j * step] : -T.Sin[j * step];
+				i = l + j;
+				m = i + half;
+				tr = re[m] * wr - im[m] * wi;
+				ti = re[m] * wi + im[m] * wr;
+				re[m] = re[i] - tr;
+				im[m] = im[i] - ti;
+				re[i] += tr;
+				im[i] += ti;
+			}
+		}
+	}
+}
+
+// ACF via FFT: rxx = IFFT(|FFT(x)|^2), zero-padded to M >= N+k+1 to avoid circular overlap.
+// The real sequences are packed into complex sequences of half length.
+static void AcfFFT(const double *x, long N, long k, double *rxx)
+{
+	CLpcTables &T = GetLpcTables();
+	long i, j, M, n;
+	double ar, ai, br, bi, er, ei, pj, pn;
+
+	for (M = 4; M < N + k + 1; M <<= 1);
+	n = M / 2;
+	SetTwiddles(T, M);
+
+	// z[i] = x[2i] + j*x[2i+1]
+	T.Re.assign(n, 0.0);
+	T.Im.assign(n, 0.0);
+	for (i = 0; i < N; i++)
+	{
+		if (i & 1)
+			T.Im[i >> 1] = x[i];
+		else
+			T.Re[i >> 1] = x[i];
+	}
+	FFT(T, &T.Re[0], &T.Im[0], n, false);
+
+	// Power spectrum P[j] = |X[j]|^2 (j = 0...n), X[j] = E[j] + e^(-2*pi*i*j/M) * O[j]
+	// with E[j] = (Z[j] + Z*[n-j]) / 2 and O[j] = (Z[j] - Z*[n-j]) / 2i
+	T.Pow.resize(n + 1);
+	double *P = &T.Pow[0];
+	for (j = 0; j <= n / 2; j++)
+	{
+		i = (n - j) & (n - 1);
+		ar = 0.5 * (T.Re[j] + T.Re[i]);		// E[j]
+		ai = 0.5 * (T.Im[j] - T.Im[i]);
+		br = 0.5 * (T.Im[j] + T.Im[i]);		// O[j]
+		bi = -0.5 * (T.Re[j] - T.Re[i]);
+		er = T.Cos[j];
+		ei = -T.Sin[j];
+		pj = ar + (br * er - bi * ei);		// X[j]
+		pn = ai + (br * ei + bi * er);
+		P[j] = pj * pj + pn * pn;
+		pj = ar - (br * er - bi * ei);		// X[n-j] = conj(E[j] - e^(-2*pi*i*j/M) * O[j])
+		pn = ai - (br * ei + bi * er);
+		P[n - j] = pj * pj + pn * pn;
+	}
+
+	// Inverse: Z[j] = (P[j] + P[n-j]) + i * e^(2*pi*i*j/M) * (P[j] - P[n-j]), IFFT(Z) = M * (r[2i] + i*r[2i+1])
+	for (j = 0; j < n; j++)
+	{
+		ar = P[j] + P[n - j];
+		br = P[j] - P[n - j];
+		T.Re[j] = ar - br * T.Sin[j];
+		T.Im[j] = br * T.Cos[j];
+	}
+	FFT(T, &T.Re[0], &T.Im[0], n, true);
+
+	for (i = 0; i <= k; i++)
+		rxx[i] = ((i & 1) ? T.Im[i >> 1] : T.Re[i >> 1]) / M;
+}
 
 // Autocorrelation function (ACF)
 // x	: Samples
@@ -79,14 +398,23 @@ contents : Linear prediction and related functions
 // rxx	: ACF values
 void acf(double *x, long N, long k, short norm, double *rxx)
 {
-	long i, n;
+	long i, M, L;
 
-	for (i = 0; i <= k; i++)
-	{
-		rxx[i] = 0.0;
-		for (n = i; n < N; n++)
-			rxx[i] += x[n] * x[n-i];
-	}
+	// FFT length M = 2^L
+	for (M = 1, L = 0; M < N + k + 1; M <<= 1, L++);
+
+	// The FFT only pays off against the vectorized direct sum for high orders
+	if ((k >= 64) && (N * (k + 1) >= ACF_FFT_RATIO * M * L))
+		AcfFFT(x, N, k, rxx);
+#ifdef	LPC_SIMD
+	else if (CpuFeatures() & CPU_AVX)
+		AcfAVX(x, N, 0, k, rxx);
+	else
+		AcfSSE2(x, N, 0, k, rxx);
+#else
+	else
+		AcfDirect(x, N, 0, k, rxx);
+#endif
 
 	if (norm)
 	{
@@ -99,19 +427,21 @@ void acf(double *x, long N, long k, short norm, double *rxx)
 // Hanning window
 void hanning(int *x, double *xd, long N)
 {
+	const double *w = GetWindow(0, N);
 	long n;
 
 	for (n = 0; n < N; n++)
-		xd[n] = (double)x[n] * (0.5 - 0.5 * cos(2.0*PI*n/(N-1)));
+		xd[n] = (double)x[n] * w[n];
 }
 
 // Hamming window
 void hamming(int *x, double *xd, long N)
 {
+	const double *w = GetWindow(1, N);
 	long n;
 
 	for (n = 0; n < N; n++)
-		xd[n] = (double)x[n] * (0.54 - 0.46 * cos(2.0*PI*n/(N-1)));
+		xd[n] = (double)x[n] * w[n];
 }
 
 // Rect window
@@ -126,17 +456,19 @@ void rect(int *x, double *xd, long N)
 // Blackman window
 void blackman(int *x, double *xd, long N)
 {
+	const double *w = GetWindow(3, N);
 	long n;
 
 	for (n = 0; n < N; n++)
-		xd[n] = (double)x[n] * (0.42 - 0.5 * cos(2.0*PI*n/(N-1)) + 0.08 * cos(4.0*PI*n/(N-1)));
+		xd[n] = (double)x[n] * w[n];
 }
 
 // Levinson-Durbin algorithm
 // -> ord: Predictor order
 // -> rxx: ACF values (rxx[0...ord])
 // <- par: Parcor coefficients (par[0...ord-1])
-short durbin(short ord, double *rxx, double *par)
+// <- err: Prediction error energy for each order (err[0...ord], optional)
+short durbin(short ord, double *rxx, double *par, double *err)
 {
 	short i, j;
 	double evar, temp, dir[1024];
@@ -144,6 +476,8 @@ short durbin(short ord, double *rxx, double *par)
 	par--;
 
 	evar = rxx[0];
+	if (err)
+		err[0] = evar;
 
 	for (i = 1; i <= ord; i++)
 	{
@@ -159,21 +493,27 @@ short durbin(short ord, double *rxx, double *par)
 			dir[j] = temp;
 		}
 		evar *= (1.0 - par[i] * par[i]);
+		if (err)
+			err[i] = evar;
 	}
 
 	return(0);
 }
 
-// Calculate LPC coefficients for a block of samples
+// Calculate the ACF of a windowed block of samples
 // -> x		: Samples
 // -> N		: Number of samples
 // -> P		: Predictor order
 // -> win	: Window type
-// <- par	: Parcor coefficients
-short GetCof(int *x, long N, short P, short win, double *par)
+// <- rxx	: ACF values (rxx[0...P])
+void GetAcf(int *x, long N, short P, short win, double *rxx)
 {
-	double *xd = new double[N];
-	double *rxx = new double[P+1];
+	std::vector<double> &Xd = GetLpcTables().Xd;
+	double *xd;
+
+	if ((long)Xd.size() < N)
+		Xd.resize(N);
+	xd = &Xd[0];
 
 	// Windowing
 	if (win == 1)
@@ -187,13 +527,23 @@ short GetCof(int *x, long N, short P, short win, double *par)
 
 	// Calculate ACF
 	acf(xd, N, P, 0, rxx);
+}
+
+// Calculate LPC coefficients for a block of samples
+// -> x		: Samples
+// -> N		: Number of samples
+// -> P		: Predictor order
+// -> win	: Window type
+// <- par	: Parcor coefficients
+short GetCof(int *x, long N, short P, short win, double *par)
+{
+	double rxx[1024];
+
+	GetAcf(x, N, P, win, rxx);
 
 	// Calculate LPC coefficients
 	durbin(P, rxx, par);
 
-	delete [] xd;
-	delete [] rxx;
-
 	return(0);
 }
 
@@ -228,23 +578,113 @@ short par2cof(int *cof, int *par, short ord, short Q)
 	return(0);
 }
 
+// Sum of c[i] * x[i] for i = 0..P-1 (exact 64-bit arithmetic)
+typedef INT64 (*DOTPROC)(const int *c, const int *x, long P);
+
+static INT64 DotScalar(const int *c, const int *x, long P)
+{
+	INT64 y = 0;
+
+	for (long i = 0; i < P; i++)
+		y += (INT64)c[i] * x[i];
+
+	return(y);
+}
+
+#ifdef	LPC_SIMD
+LPC_TARGET("sse4.1") static INT64 DotSSE41(const int *c, const int *x, long P)
+{
+	__m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128(), a, b;
+	INT64 s[2], y;
+	long i;
+
+	// Products of even and odd lanes are accumulated separately
+	for (i = 0; i + 4 <= P; i += 4)
+	{
+		a = _mm_loadu_si128((const __m128i *)(c + i));
+		b = _mm_loadu_si128((const __m128i *)(x + i));
+		acc0 = _mm_add_epi64(acc0, _mm_mul_epi32(a, b));
+		acc1 = _mm_add_epi64(acc1, _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)));
+	}
+	_mm_storeu_si128((__m128i *)s, _mm_add_epi64(acc0, acc1));
+	y = s[0] + s[1];
+
+	for (; i < P; i++)
+		y += (INT64)c[i] * x[i];
+
+	return(y);
+}
+
+LPC_TARGET("avx2") static INT64 DotAVX2(const int *c, const int *x, long P)
+{
+	__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), a, b;
+	__m128i acc;
+	INT64 s[2], y;
+	long i;
+
+	for (i = 0; i + 8 <= P; i += 8)
+	{
+		a = _mm256_loadu_si256((const __m256i *)(c + i));
+		b = _mm256_loadu_si256((const __m256i *)(x + i));
+		acc0 = _mm256_add_epi64(acc0, _mm256_mul_epi32(a, b));
+		acc1 = _mm256_add_epi64(acc1, _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)));
+	}
+	acc0 = _mm256_add_epi64(acc0, acc1);
+	acc = _mm_add_epi64(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+	_mm_storeu_si128((__m128i *)s, acc);
+	y = s[0] + s[1];
+
+	for (; i < P; i++)
+		y += (INT64)c[i] * x[i];
+
+	return(y);
+}
+
+// Select the filter kernel for the current CPU
+static DOTPROC SelectDot()
+{
+	unsigned int f = CpuFeatures();
+
+	if (f & CPU_AVX2)
+		return(DotAVX2);
+	if (f & CPU_SSE41)
+		return(DotSSE41);
+	return(DotScalar);
+}
+#endif
+
+// Get the filter kernel for the current CPU (selected once)
+static DOTPROC GetDot(short P)
+{
+#ifdef	LPC_SIMD
+	static const DOTPROC Dot = SelectDot();
+	if (P >= 8)
+		return(Dot);
+#endif
+	return(DotScalar);
+}
+
 // Caculate prediction residual
 void GetResidual(int *x, long N, short P, short Q, int *cof, int *d)
 {
 	long n, i;
-	int korr;
+	int korr, rcof[1023];
 	INT64 y;
+	DOTPROC Dot = GetDot(P);
 
 	korr = 1 << (Q - 1);	// Korrekturterm
 
+	// Koeffizienten in umgekehrter Reihenfolge (rcof[P-i] = cof[i-1])
+	for (i = 0; i < P; i++)
+		rcof[i] = cof[P-1-i];
+
 	for (n = 0; n < N; n++)
 	{
 		// Initialisierung mit Korrekturterm
 		y = korr;
 
 		// Schtzwert berechnen
-		for (i = 1; i <= P; i++)
-			y += (INT64)cof[i-1] * x[n-i];
+		y += Dot(rcof, x + n - P, P);
 
 		// Schtzwert vom Signal abziehen
 		d[n] = x[n] + (int)(y >> Q);				// Division y / 2^Q
@@ -255,18 +695,22 @@ void GetResidual(int *x, long N, short P, short Q, int *cof, int *d)
 void GetSignal(int *x, long N, short P, short Q, int *cof, int *d)
 {
 	long n, i;
-	int korr;
+	int korr, rcof[1023];
 	INT64 y;
+	DOTPROC Dot = GetDot(P);
 
 	korr = 1 << (Q - 1);	// Korrekturterm
 
+	// Koeffizienten in umgekehrter Reihenfolge (rcof[P-i] = cof[i-1])
+	for (i = 0; i < P; i++)
+		rcof[i] = cof[P-1-i];
+
 	for (n = 0; n < N; n++)
 	{
 		y = korr;
 
 		// Schtzwert berechnen
-		for (i = 1; i <= P; i++)
-			y += (INT64)cof[i-1] * x[n-i];
+		y += Dot(rcof, x + n - P, P);
 
 		// Schtzwert zum Restfehlersignal addieren
 		x[n] = d[n] - (int)(y >> Q);
@@ -277,12 +721,14 @@ void GetSignal(int *x, long N, short P, short Q, int *cof, int *d)
 short GetResidualRA(int *x, long N, short P, short Q, int *par, int *cof, int *d)
 {
 	long n, i, m;
-	int korr;
+	int korr, rcof[1023];
 	INT64 y, temp, temp2;
+	DOTPROC Dot;
 
 	if(N < P) P = (short)N;
 
 	korr = 1 << (Q - 1);	// Correction term
+	Dot = GetDot(P);
 
 	par--;
 	cof--;
@@ -317,14 +763,17 @@ short GetResidualRA(int *x, long N, short P, short Q, int *par, int *cof, int *d
 		cof[m] = par[m];
 	}
 
+	// Coefficients in reversed order (rcof[P-i] = cof[i])
+	for (i = 0; i < P; i++)
+		rcof[i] = cof[P-i];
+
 	for (n = P; n < N; n++)
 	{
 		// Initialisation with correction term
 		y = korr;
 
 		// Calculate estimate
-		for (i = 1; i <= P; i++)
-			y += (INT64)cof[i] * x[n-i];
+		y += Dot(rcof, x + n - P, P);
 
 		// Subtract estimate from signal
 		d[n] = x[n] + (int)(y >> Q);				// Division y / 2^Q
@@ -337,12 +786,14 @@ short GetResidualRA(int *x, long N, short P, short Q, int *par, int *cof, int *d
 short GetSignalRA(int *x, long N, short P, short Q, int *par, int *cof, int *d)
 {
 	long n, i, m;
-	int korr;
+	int korr, rcof[1023];
 	INT64 y, temp, temp2;
+	DOTPROC Dot;
 
 	if(N < P) P = (short)N;
 
 	korr = 1 << (Q - 1);	// Correction term
+	Dot = GetDot(P);
 
 	par--;
 	cof--;
@@ -377,14 +828,17 @@ short GetSignalRA(int *x, long N, short P, short Q, int *par, int *cof, int *d)
 		cof[m] = par[m];
 	}
 
+	// Coefficients in reversed order (rcof[P-i] = cof[i])
+	for (i = 0; i < P; i++)
+		rcof[i] = cof[P-i];
+
 	for (n = P; n < N; n++)
 	{
 		// Initialisation with correction term
 		y = korr;
 
 		// Calculate estimate
-		for (i = 1; i <= P; i++)
-			y += (INT64)cof[i] * x[n-i];
+		y += Dot(rcof, x + n - P, P);
 
 		// Add estimate to residual
 		x[n] = d[n] - (int)(y >> Q);				// Division y / 2^Q
@@ -505,10 +959,12 @@ short par2cof_nocheck(int *cof, int *par, short ord, short Q)
 short GetSignalRA_nocheck(int *x, long N, short P, short Q, int *par, int *cof, int *d)
 {
 	long n, i, m;
-	int korr;
+	int korr, rcof[1023];
 	INT64 y, temp, temp2;
+	DOTPROC Dot;
 
 	korr = 1 << (Q - 1);	// Correction term
+	Dot = GetDot(P);
 
 	par--;
 	cof--;
@@ -539,14 +995,17 @@ short GetSignalRA_nocheck(int *x, long N, short P, short Q, int *par, int *cof,
 		cof[m] = par[m];
 	}
 
+	// Coefficients in reversed order (rcof[P-i] = cof[i])
+	for (i = 0; i < P; i++)
+		rcof[i] = cof[P-i];
+
 	for (n = P; n < N; n++)
 	{
 		// Initialisation with correction term
 		y = korr;
 
 		// Calculate estimate
-		for (i = 1; i <= P; i++)
-			y += (INT64)cof[i] * x[n-i];
+		y += Dot(rcof, x + n - P, P);
 
 		// Add estimate to residual
 		x[n] = d[n] - (int)(y >> Q);				// Division y / 2^Q
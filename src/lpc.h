@@ -52,9 +52,10 @@ void hamming(int *x, double *xd, long N);
 void hanning(int *x, double *xd, long N);
 void blackman(int *x, double *xd, long N);
 void rect(int *x, double *xd, long N);
-short durbin(short ord, double *rxx, double *par);
+short durbin(short ord, double *rxx, double *par, double *err = 0);
 short par2cof(int *cof, int *par, short ord, short Q);
 
+void GetAcf(int *x, long N, short P, short win, double *rxx);
 short GetCof(int *x, long N, short P, short win, double *par);
 void GetResidual(int *x, long N, short P, short Q, int *cof, int *d);
 void GetSignal(int *x, long N, short P, short Q, int *cof, int *d);
@@ -0,0 +1,303 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : lpc_adapt.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : Adaptive choice of the prediction order
+
+*************************************************************************/
+
+#include <math.h>
+#include <vector>
+#include "lpc.h"
+#include "lpc_adapt.h"
+
+#define LN2 0.69314718055994530942
+#define Q 20			// Quantizer value of the coefficients (as in the encoder)
+
+// Rice code parameters {offset, parameter} of the first 20 parcor coefficients
+// (the same tables as in CLpacEncoder::EncodeBlockCoding())
+static const struct pv {int m,s;} parcor_vars[3][20] = {
+	// 48kHz
+	{{-52, 4}, {-29, 5}, {-31, 4}, { 19, 4}, {-16, 4}, { 12, 3}, { -7, 3}, {  9, 3}, { -5, 3}, {  6, 3},
+	 { -4, 3}, {  3, 3}, { -3, 2}, {  3, 2}, { -2, 2}, {  3, 2}, { -1, 2}, {  2, 2}, { -1, 2}, {  2, 2}},
+	// 96kHz
+	{{-58, 3}, {-42, 4}, {-46, 4}, { 37, 5}, {-36, 4}, { 29, 4}, {-29, 4}, { 25, 4}, {-23, 4}, { 20, 4},
+	 {-17, 4}, { 16, 4}, {-12, 4}, { 12, 3}, {-10, 4}, {  7, 3}, { -4, 4}, {  3, 3}, { -1, 3}, {  1, 3}},
+	// 192kHz
+	{{-59, 3}, {-45, 5}, {-50, 4}, { 38, 4}, {-39, 4}, { 32, 4}, {-30, 4}, { 25, 3}, {-23, 3}, { 20, 3},
+	 {-20, 3}, { 16, 3}, {-13, 3}, { 10, 3}, { -7, 3}, {  3, 3}, {  0, 3}, { -1, 3}, {  2, 3}, { -1, 2}}
+};
+
+// Reconstruction levels of the first and second coefficient
+// (the same table as in CLpacEncoder::EncodeBlockAnalysis())
+static const int pc12_tbl[128] = {
+	-1048544, -1048288, -1047776, -1047008, -1045984, -1044704, -1043168, -1041376, -1039328,
+	-1037024, -1034464, -1031648, -1028576, -1025248, -1021664, -1017824, -1013728, -1009376,
+	-1004768, -999904, -994784, -989408, -983776, -977888, -971744, -965344, -958688, -951776,
+	-944608, -937184, -929504, -921568, -913376, -904928, -896224, -887264, -878048, -868576,
+	-858848, -848864, -838624, -828128, -817376, -806368, -795104, -783584, -771808, -759776,
+	-747488, -734944, -722144, -709088, -695776, -682208, -668384, -654304, -639968, -625376,
+	-610528, -595424, -580064, -564448, -548576, -532448, -516064, -499424, -482528, -465376,
+	-447968, -430304, -412384, -394208, -375776, -357088, -338144, -318944, -299488, -279776,
+	-259808, -239584, -219104, -198368, -177376, -156128, -134624, -112864, -90848, -68576,
+	-46048, -23264, -224, 23072, 46624, 70432, 94496, 118816, 143392, 168224, 193312, 218656,
+	244256, 270112, 296224, 322592, 349216, 376096, 403232, 430624, 458272, 486176, 514336,
+	542752, 571424, 600352, 629536, 658976, 688672, 718624, 748832, 779296, 810016, 840992,
+	872224, 903712, 935456, 967456, 999712, 1032224 };
+
+// Length of a Rice code word (see rice_encode())
+static long RiceLength(int symbol, int s)
+{
+	unsigned int i = (symbol < 0) ? -symbol - 1 : symbol;
+
+	return((i >> (s - 1)) + 1 + s);
+}
+
+// Quantized index of the i-th parcor coefficient (as in the encoder)
+static int QuantizePar(double par, short i)
+{
+	int a;
+
+	if (i == 0)
+		a = (int)floor((-1 + sqrt(2.0) * sqrt(par + 1.0)) * 64);
+	else if (i == 1)
+		a = (int)floor((-1 + sqrt(2.0) * sqrt(-par + 1.0)) * 64);
+	else
+		a = (int)floor(par * 64);
+	if (a > 63) a = 63; else if (a < -64) a = -64;
+
+	return(a);
+}
+
+// Number of bits for the i-th quantized parcor coefficient (as written by the encoder)
+static long CoefBits(double par, short i, short table)
+{
+	int a = QuantizePar(par, i);
+
+	if (table > 2)
+		return(7);
+	else if (i < 20)
+		return(RiceLength(a - parcor_vars[table][i].m, parcor_vars[table][i].s));
+	else if (i < 127)
+		return(RiceLength(a - (i & 1), 2));
+	else
+		return(RiceLength(a, 1));
+}
+
+// Expected number of bits per sample of the Rice codes of a Laplacian residual
+// with variance var. With the scale b = sqrt(var/2), a code word with parameter
+// s has s+1 bits plus the number of times 2^s fits into |2*e|, which is
+// geometric: q/(1-q) with q = exp(-2^s/(2*b)). Unlike log2(sigma), this does
+// not keep on rewarding smaller errors once they are below 2^s.
+static double RiceBitsPerSample(double var)
+{
+	double b = sqrt(var * 0.5), bits, minbits = 64.0, q;
+	int s, s0;
+
+	if (b < 1e-3)
+		return(1.0);
+
+	s0 = (int)floor(log(2.0 * b) / LN2);
+	for (s = (s0 > 1) ? s0 - 1 : 0; s <= s0 + 1; s++)
+	{
+		q = exp(-ldexp(1.0, s) / (2.0 * b));
+		bits = s + 1 + q / (1.0 - q);
+		if (bits < minbits)
+			minbits = bits;
+	}
+	return(minbits);
+}
+
+// Number of bits of the Rice codes of d[0..N-1] with the best parameter
+static double ResidualBits(const int *d, long N)
+{
+	double sum = 0.0, bits, minbits = -1.0;
+	long n;
+	int s, s0;
+
+	for (n = 0; n < N; n++)
+		sum += (d[n] >= 0) ? 2.0 * d[n] : -2.0 * d[n] - 1.0;
+
+	s0 = (sum > N) ? (int)floor(log(sum / N) / LN2) : 0;
+	for (s = (s0 > 1) ? s0 - 1 : 0; s <= s0 + 1 && s < 32; s++)
+	{
+		bits = (double)(s + 1) * N;
+		for (n = 0; n < N; n++)
+			bits += ((d[n] >= 0) ? 2u * (unsigned int)d[n] : ~(2u * (unsigned int)d[n])) >> s;
+		if ((minbits < 0.0) || (bits < minbits))
+			minbits = bits;
+	}
+	return(minbits);
+}
+
+// Number of bits of the residual and the coefficients for predictor order P,
+// calculated with the quantized coefficients exactly as the encoder does it.
+// The residual is Rice coded in the partition of the encoder (4 parts with
+// their own parameter). Stops as soon as more than limit bits are reached.
+// Returns -1 if the coefficients cannot be converted (the encoder then falls
+// back to a first order predictor).
+static double OrderBits(int *x, long N, short P, const double *par, short table, short RA, double limit)
+{
+	static thread_local std::vector<int> Residual;
+	int parq[1023], cof[1023], a, *d;
+	double bits = 0.0;
+	long Ns;
+	short i, j, sub;
+
+	if ((long)Residual.size() < N)
+		Residual.resize(N);
+	d = &Residual[0];
+
+	for (i = 0; i < P; i++)
+	{
+		a = QuantizePar(par[i], i);
+		if (i == 0)
+			parq[i] = pc12_tbl[a + 64];
+		else if (i == 1)
+			parq[i] = -pc12_tbl[a + 64];
+		else
+			parq[i] = (a << (Q - 6)) + (1 << (Q - 7));
+		bits += CoefBits(par[i], i, table);
+	}
+
+	if (RA)
+	{
+		if (GetResidualRA(x, N, P, Q, parq, cof, d))
+			return(-1.0);
+	}
+	else if (par2cof(cof, parq, P, Q))
+		return(-1.0);
+
+	sub = ((N < 512) || (N % 8)) ? 1 : 4;
+	Ns = N / sub;
+	for (j = 0; (j < sub) && (bits <= limit); j++)
+	{
+		if (!RA)
+			GetResidual(x + j * Ns, Ns, P, Q, cof, d + j * Ns);
+		bits += ResidualBits(d + j * Ns, Ns);
+	}
+
+	return(bits);
+}
+
+// Calculate LPC coefficients and the optimum predictor order for a block of samples
+// -> x		: Samples (x[-maxP...-1] must be valid unless RA is set)
+// -> N		: Number of samples
+// -> maxP	: Maximum predictor order
+// -> win	: Window type
+// <- par	: Parcor coefficients (par[0...maxP-1])
+// -> table	: Coefficient code table (CoefTable of the encoder, 0..3)
+// -> RA	: Random access block (progressive prediction)
+// Returns the predictor order which minimizes the number of bits (residual +
+// coefficients). The prediction error of all orders is obtained from a single
+// Levinson-Durbin recursion, and the Rice code length of the residual is
+// estimated from it. As the windowed error overrates long predictors, the
+// actual number of bits is then calculated for the estimated order, for some
+// shorter orders and the neighbours of the best one, and for the maximum
+// order, so the adaptive order never costs more bits than the fixed one.
+short GetCofAdaptOrder(int *x, long N, short maxP, short win, double *par, short table, short RA)
+{
+	double rxx[1024], err[1024], bits, minbits, cbits, energy;
+	short p, optP, estP, step;
+	long n;
+
+	GetAcf(x, N, maxP, win, rxx);
+	if (rxx[0] <= 0.0)
+	{
+		// Silent block
+		for (p = 0; p < maxP; p++)
+			par[p] = 0.0;
+		return(1);
+	}
+
+	durbin(maxP, rxx, par, err);
+
+	// Energy per sample of the (unwindowed) block
+	energy = 0.0;
+	for (n = 0; n < N; n++)
+		energy += (double)x[n] * x[n];
+	energy /= N;
+
+	// Estimated bits of each order: the prediction gain of the windowed block,
+	// applied to the energy of the block itself
+	estP = 0;
+	minbits = N * RiceBitsPerSample(energy);
+	cbits = 0.0;
+	for (p = 1; p <= maxP; p++)
+	{
+		if (!(err[p] > 0.0))
+			break;
+		cbits += CoefBits(par[p-1], p - 1, table);
+		bits = N * RiceBitsPerSample(energy * err[p] / rxx[0]) + cbits;
+		if (bits < minbits)
+		{
+			minbits = bits;
+			estP = p;
+		}
+	}
+
+	// Actual bits of the estimated order and of shorter orders (1, 2, 3, 4, 6, 8, 12, ...)
+	optP = estP;
+	minbits = OrderBits(x, N, estP, par, table, RA, INFINITY);
+	if (minbits < 0.0)
+		minbits = INFINITY;
+	for (p = 1; p < estP; p = (p < 4) ? p + 1 : ((p & (p - 1)) ? p / 3 * 4 : p / 2 * 3))
+	{
+		bits = OrderBits(x, N, p, par, table, RA, minbits);
+		if ((bits >= 0.0) && (bits < minbits))
+		{
+			minbits = bits;
+			optP = p;
+		}
+	}
+
+	// Neighbours of the best order (downwards first)
+	estP = optP;
+	for (step = -1; (step <= 1) && (optP == estP); step += 2)
+	{
+		for (p = optP + step; (p >= 0) && (p <= maxP); p += step)
+		{
+			bits = OrderBits(x, N, p, par, table, RA, minbits);
+			if ((bits < 0.0) || (bits >= minbits))
+				break;
+			minbits = bits;
+			optP = p;
+		}
+	}
+
+	// Maximum order
+	if (optP < maxP)
+	{
+		bits = OrderBits(x, N, maxP, par, table, RA, minbits);
+		if ((bits >= 0.0) && (bits < minbits))
+			optP = maxP;
+	}
+
+	return(optP);
+}
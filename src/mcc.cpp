@@ -48,6 +48,7 @@ contents : Multi-channel correlation
 
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <memory.h>
 #include <time.h>
 #include <stdlib.h>
@@ -71,6 +72,7 @@ contents : Multi-channel correlation
 #include "rn_bitio.h"
 
 #define PI 3.14159265359
+#define XCORR_2PI 6.283185307179586477	// FFT twiddle factors need full precision
 
 
 #define min(a, b)  (((a) < (b)) ? (a) : (b))
@@ -78,6 +80,8 @@ contents : Multi-channel correlation
 
 #define LTPcompand 0
 
+static void FreeXCorr( MCC_XCORR* pX );
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        Encoding functions                        //
@@ -167,6 +171,9 @@ void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res
 	// Save maximum of time lag
 	pBuffer->m_MaxTau = MaxTau;
 
+	// Time difference search buffers are allocated on first use
+	memset( &pBuffer->m_XCorr, 0, sizeof(MCC_XCORR) );
+
 }
 
 ////////////////////////////////////////
@@ -219,6 +226,9 @@ void	FreeMccEncBuffer( MCC_ENC_BUFFER* pBuffer )
 
 	// Free LTP buffers
 	pBuffer->m_Ltp.Free();
+
+	// Free time difference search buffers
+	FreeXCorr( &pBuffer->m_XCorr );
 }
 
 ////////////////////////////////////////
@@ -832,15 +842,7 @@ void	CLtp::RiceEncodePlus( int symbol, int s, BITIO* p )
 
 void	CLtp::PutBit( unsigned char bit, BITIO* p )
 {
-	unsigned int	l = p->bit_offset + 1;
-
-	// add the bit to the bitstream
-	p->pbs[0] |= bit << ( 8 - l );
-	p->pbs[1] = 0;	// can be avoided if we zero buffer first
-
-	// update bitstream vars
-	p->pbs += l >> 3;
-	p->bit_offset = l & 7;
+	put_bits( bit, 1, p );
 }
 
 ////////////////////////////////////////
@@ -860,13 +862,7 @@ int	CLtp::RiceDecodePlus( int s, BITIO* p )
 
 unsigned int	CLtp::GetBit( BITIO* p )
 {
-	unsigned int	l = p->bit_offset + 1;
-	unsigned int	bit = static_cast<unsigned int>( p->pbs[0] ) >> ( 8 - l );
-
-	// update the bitstream
-	p->pbs += l >> 3;
-	p->bit_offset = l & 7;
-	return bit & 1;
+	return get_bits( 1, p );
 }
 
 
@@ -880,129 +876,410 @@ unsigned int	CLtp::GetBit( BITIO* p )
 // Search Time Difference //
 ///////////////////////////
 
-long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau)
+/*
+	The time difference is the lag tau with the largest |r(tau)|, where
+
+		r(tau) = sum_s dn[s+tau] * ds[s]
+
+	For many lags, all r(tau) are estimated with an FFT first. Only the lags whose
+	estimate is within the error bound of the maximum are calculated directly, so
+	the result is exactly that of the direct search.
+	The FFT length is not extended by the lag range: the few products which wrap
+	around are subtracted from the circular correlation instead (XCorrUnwrap()).
+*/
+
+// Allocate the buffers of the time difference search for Chan channels
+// (FFT length 0: the direct search is faster)
+static void AllocateXCorr( MCC_XCORR* pX, long Chan, long N, long MaxTau )
 {
-	long smpl,outtau=3,tau;
-	double powin=0.0,maxpow=0.0;
-	/*
-		As we use 3(no TimeDiff)+3(TimeDiff) taps,
+	long	i, L, Log2;
 
-		0   1   2   3   4   5   6   7 .....
-	   |          |           |
-        noTD 3taps   TD 3taps
+	if ( Chan < 2 ) Chan = 2;
+	if ( ( N <= pX->m_N ) && ( Chan <= pX->m_Chan ) && ( MaxTau <= pX->m_MaxTau ) )
+		return;
+	FreeXCorr( pX );
+
+	// Direct search: 2*MaxTau*N products, FFT: about 2*L*log2(L) operations
+	for( L=4, Log2=2; L<N; L<<=1, Log2++ );
+	if ( MaxTau * N < 2 * L * Log2 ) L = 0;
+
+	pX->m_N = N;
+	pX->m_Chan = Chan;
+	pX->m_MaxTau = MaxTau;
+	pX->m_Lag = MaxTau+2;
+	pX->m_Size = L;
+	pX->m_Sig = new double* [Chan];
+	for( i=0; i<Chan; i++ ) pX->m_Sig[i] = new double [N];
+	if ( L )
+	{
+		pX->m_Twiddle = new double [L];
+		pX->m_Work = new double [2*L];
+		pX->m_Spec = new double* [Chan];
+		for( i=0; i<Chan; i++ ) pX->m_Spec[i] = new double [L+2];
+		pX->m_Est = new double [Chan*(Chan-1)/2 * (2*pX->m_Lag+1)];
+		for( i=0; i<L/2; i++ )
+		{
+			pX->m_Twiddle[2*i] = cos( XCORR_2PI * i / L );
+			pX->m_Twiddle[2*i+1] = -sin( XCORR_2PI * i / L );
+		}
+	}
+}
 
-		therefore minimum TimeDiff should be 4.
-												*/
-	double *dn = new double [N];
-	double *ds = new double [N];
-	double *pds, *pdn;
+static void FreeXCorr( MCC_XCORR* pX )
+{
+	long	i;
 
-	for( smpl=0; smpl<N; smpl++ )
+	if ( pX->m_Sig )
 	{
-		dn[smpl]= (double)sdmas[smpl];
-		ds[smpl]= (double)sdsla[smpl];
+		for( i=0; i<pX->m_Chan; i++ ) delete [] pX->m_Sig[i];
+		delete [] pX->m_Sig;
+	}
+	if ( pX->m_Spec )
+	{
+		for( i=0; i<pX->m_Chan; i++ ) delete [] pX->m_Spec[i];
+		delete [] pX->m_Spec;
 	}
-	pdn=dn;
-	pds=ds;
+	delete [] pX->m_Twiddle;
+	delete [] pX->m_Work;
+	delete [] pX->m_Est;
+	memset( pX, 0, sizeof(MCC_XCORR) );
+}
 
-	if(MaxTau > N-3) MaxTau = N-3;
-	for( tau=3; tau<MaxTau+3; tau++)
+// In-place FFT of L complex values (Sign = 1: forward, -1: inverse without 1/L).
+// Two radix-2 stages are done per pass, plus one radix-2 pass if log2(L) is odd.
+static void Fft( double* z, long L, const double* tw, short Sign )
+{
+	long	i, j, k, h, step;
+	double	tr, ti, *a, *b, *c, *d;
+	double	w1r, w1i, w2r, w2i, br, bi, dr, di, a1r, a1i, b1r, b1i, c1r, c1i, d1r, d1i;
+
+	for( i=1, j=0; i<L; i++ )				// Bit reversed order
 	{
-		pdn=dn+tau;
-		pds=ds;
-		for( powin=0.0, smpl=0; smpl<N-tau; smpl++ )
+		for( k=L>>1; j&k; k>>=1 ) j ^= k;
+		j |= k;
+		if ( i < j )
 		{
-			powin += *(pdn++) * *(pds++);
+			tr = z[2*i]; z[2*i] = z[2*j]; z[2*j] = tr;
+			ti = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = ti;
 		}
-		if(powin*powin>maxpow)
+	}
+	h = 1;
+	step = L/2;
+	for( k=L; k>2; k>>=2 );
+	if ( k == 2 )
+	{
+		for( i=0; i<2*L; i+=4 )
 		{
-			outtau=tau;
-			maxpow=powin*powin;
+			tr = z[i+2];
+			ti = z[i+3];
+			z[i+2] = z[i] - tr;
+			z[i+3] = z[i+1] - ti;
+			z[i] += tr;
+			z[i+1] += ti;
 		}
+		h = 2;
+		step = L/4;
 	}
-	for( tau=-3-MaxTau+1; tau<-3+1; tau++)
+	for( ; h<L; h<<=2, step>>=2 )
 	{
-		pdn=dn;
-		pds=ds-tau;
-		for(powin=0.0, smpl=-tau; smpl<N; smpl++ )
+		for( i=0; i<L; i+=4*h )
 		{
-			powin += *(pdn++) * *(pds++);
+			a = z + 2*i;
+			b = a + 2*h;
+			c = b + 2*h;
+			d = c + 2*h;
+			for( k=0; k<h; k++, a+=2, b+=2, c+=2, d+=2 )
+			{
+				w1r = tw[2*k*step];			// exp(-2*pi*i*k/(2h))
+				w1i = Sign * tw[2*k*step+1];
+				w2r = tw[k*step];			// exp(-2*pi*i*k/(4h))
+				w2i = Sign * tw[k*step+1];
+
+				// Stage h: (a,b), (c,d)
+				br = b[0]*w1r - b[1]*w1i;
+				bi = b[0]*w1i + b[1]*w1r;
+				dr = d[0]*w1r - d[1]*w1i;
+				di = d[0]*w1i + d[1]*w1r;
+				a1r = a[0] + br;  a1i = a[1] + bi;
+				b1r = a[0] - br;  b1i = a[1] - bi;
+				c1r = c[0] + dr;  c1i = c[1] + di;
+				d1r = c[0] - dr;  d1i = c[1] - di;
+
+				// Stage 2h: (a,c) with w2, (b,d) with w2 * (-i) (inverse: +i)
+				tr = c1r*w2r - c1i*w2i;
+				ti = c1r*w2i + c1i*w2r;
+				a[0] = a1r + tr;  a[1] = a1i + ti;
+				c[0] = a1r - tr;  c[1] = a1i - ti;
+				tr = Sign * ( d1r*w2i + d1i*w2r );
+				ti = -Sign * ( d1r*w2r - d1i*w2i );
+				b[0] = b1r + tr;  b[1] = b1i + ti;
+				d[0] = b1r - tr;  d[1] = b1i - ti;
+			}
 		}
-		if(powin*powin>maxpow)
+	}
+}
+
+// Spectra (k = 0..L/2) of the real signals x0 and x1 with one complex FFT
+static void XCorrSpectra( MCC_XCORR* pX, const double* x0, const double* x1, long N, double* s0, double* s1 )
+{
+	long	k, L = pX->m_Size;
+	double	*z = pX->m_Work, *zk, *zm;
+
+	for( k=0; k<N; k++ )
+	{
+		z[2*k] = x0[k];
+		z[2*k+1] = x1 ? x1[k] : 0.0;
+	}
+	memset( z + 2*N, 0, 2*(L-N) * sizeof(double) );
+	Fft( z, L, pX->m_Twiddle, 1 );
+
+	for( k=0; k<=L/2; k++ )
+	{
+		zk = z + 2*k;
+		zm = z + 2*((L-k) & (L-1));
+		s0[2*k] = 0.5 * ( zk[0] + zm[0] );
+		s0[2*k+1] = 0.5 * ( zk[1] - zm[1] );
+		if ( s1 )
 		{
-			outtau=tau;
-			maxpow=powin*powin;
+			s1[2*k] = 0.5 * ( zk[1] + zm[1] );
+			s1[2*k+1] = 0.5 * ( zm[0] - zk[0] );
 		}
 	}
+}
 
-	delete[] dn;
-	delete[] ds;
-	return(outtau);
+// Estimates of r(tau) of the pairs (a0,b0) and (a1,b1) from their spectra with one
+// complex inverse FFT, stored at e0[Lag+tau] and e1[Lag+tau] (|tau| <= Lag)
+static void XCorrEstimate( MCC_XCORR* pX, const double* a0, const double* b0, const double* a1, const double* b1, double* e0, double* e1 )
+{
+	long	k, tau, L = pX->m_Size, Lag = pX->m_Lag;
+	double	*z = pX->m_Work, pr0, pi0, pr1, pi1, scale = 1.0 / L;
+
+	for( k=0; k<=L/2; k++ )
+	{
+		// P(k) = A(k) * conj(B(k)), P(L-k) = conj(P(k))
+		pr0 = a0[2*k] * b0[2*k] + a0[2*k+1] * b0[2*k+1];
+		pi0 = a0[2*k+1] * b0[2*k] - a0[2*k] * b0[2*k+1];
+		pr1 = pi1 = 0.0;
+		if ( a1 )
+		{
+			pr1 = a1[2*k] * b1[2*k] + a1[2*k+1] * b1[2*k+1];
+			pi1 = a1[2*k+1] * b1[2*k] - a1[2*k] * b1[2*k+1];
+		}
+		// Z = P0 + i*P1
+		z[2*k] = pr0 - pi1;
+		z[2*k+1] = pi0 + pr1;
+		if ( ( k > 0 ) && ( k < L/2 ) )
+		{
+			z[2*(L-k)] = pr0 + pi1;
+			z[2*(L-k)+1] = pr1 - pi0;
+		}
+	}
+	Fft( z, L, pX->m_Twiddle, -1 );
+
+	for( tau=-Lag; tau<=Lag; tau++ )
+	{
+		k = 2*(tau & (L-1));
+		e0[Lag+tau] = z[k] * scale;
+		if ( e1 ) e1[Lag+tau] = z[k+1] * scale;
+	}
 }
 
-long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau)
+// The FFT correlation is circular: subtract the products of lag tau-L (tau > 0)
+// and tau+L (tau < 0) from the estimates e[tau]
+static void XCorrUnwrap( const MCC_XCORR* pX, const double* dn, const double* ds, long N, double* e )
 {
-//include Tau=0
-	long smpl,outtau=3,tau;
-	double powin=0.0,maxpow=0.0;
-	/*
-		As we use 3(no TimeDiff)+3(TimeDiff) taps,
+	long	tau, s, L = pX->m_Size, Lag = min( pX->m_Lag, N-1 );
+	double	w;
 
-		0   1   2   3   4   5   6   7 .....
-	   |          |           |
-        noTD 3taps   TD 3taps
+	for( tau=L-N+1; tau<=Lag; tau++ )
+	{
+		for( w=0.0, s=L-tau; s<N; s++ ) w += dn[s+tau-L] * ds[s];
+		e[tau] -= w;
+		for( w=0.0, s=0; s<N-L+tau; s++ ) w += dn[s-tau+L] * ds[s];
+		e[-tau] -= w;
+	}
+}
 
-		therefore minimum TimeDiff should be 3.
-												*/
-	double *dn = new double [N];
-	double *ds = new double [N];
-	double *pds, *pdn;
+// Estimates of the pair of channels a < b (lag 0)
+static double* XCorrEst( MCC_XCORR* pX, long a, long b, long Chan )
+{
+	return( pX->m_Est + ( a*Chan - a*(a+1)/2 + b-a-1 ) * ( 2*pX->m_Lag+1 ) + pX->m_Lag );
+}
 
-	for( smpl=0; smpl<N; smpl++ )
+// Error bound of the estimates (Power: largest signal power involved)
+static double XCorrError( const MCC_XCORR* pX, long N, double Power )
+{
+	long	Log2, L;
+
+	for( L=1, Log2=0; L<pX->m_Size; L<<=1, Log2++ );
+	return( 4.0 * ( N + 16.0 * Log2 ) * DBL_EPSILON * Power );
+}
+
+// Signals of the channels x[0..Chan-1] as double, and estimates of r(tau) of all pairs of
+// channels which are not skipped. Returns the error bound of the estimates.
+static double XCorrChannels( MCC_XCORR* pX, int** x, const char* skip, long Chan, long N )
+{
+	long	a, b, c, smpl, pa = -1, pb = -1;
+	double	Power, MaxPower = 0.0, *pe = NULL, *e;
+
+	for( c=0; c<Chan; c++ )
 	{
-		dn[smpl]= (double)sdmas[smpl];
-		ds[smpl]= (double)sdsla[smpl];
+		for( Power=0.0, smpl=0; smpl<N; smpl++ )
+		{
+			pX->m_Sig[c][smpl] = (double)x[c][smpl];
+			Power += pX->m_Sig[c][smpl] * pX->m_Sig[c][smpl];
+		}
+		MaxPower = max( MaxPower, Power );
 	}
-	pdn=dn;
-	pds=ds;
-	for( powin=0.0, smpl=0; smpl<N; smpl++ ) powin += *(pdn++) * *(pds++);
-	outtau=0;
-	maxpow=powin*powin;
-	if(MaxTau > N) MaxTau = N;
-	for( tau=3; tau<MaxTau+3; tau++)
+	if ( pX->m_Size == 0 )
+		return( 0.0 );
+
+	// Spectra, two channels per FFT
+	for( a=-1, c=0; c<Chan; c++ )
 	{
-		pdn=dn+tau;
-		pds=ds;
-		for( powin=0.0, smpl=0; smpl<N-tau; smpl++ )
+		if ( skip[c] ) continue;
+		if ( a < 0 ) { a = c; continue; }
+		XCorrSpectra( pX, pX->m_Sig[a], pX->m_Sig[c], N, pX->m_Spec[a], pX->m_Spec[c] );
+		a = -1;
+	}
+	if ( a >= 0 ) XCorrSpectra( pX, pX->m_Sig[a], NULL, N, pX->m_Spec[a], NULL );
+
+	// Correlations, two pairs per inverse FFT
+	for( a=0; a<Chan; a++ )
+	{
+		for( b=a+1; b<Chan; b++ )
+		{
+			if ( skip[a] || skip[b] ) continue;
+			e = XCorrEst( pX, a, b, Chan ) - pX->m_Lag;
+			if ( pe == NULL ) { pa = a; pb = b; pe = e; continue; }
+			XCorrEstimate( pX, pX->m_Spec[pa], pX->m_Spec[pb], pX->m_Spec[a], pX->m_Spec[b], pe, e );
+			pe = NULL;
+		}
+	}
+	if ( pe ) XCorrEstimate( pX, pX->m_Spec[pa], pX->m_Spec[pb], NULL, NULL, pe, NULL );
+
+	for( a=0; a<Chan; a++ )
+	{
+		for( b=a+1; b<Chan; b++ )
 		{
-			powin += *(pdn++) * *(pds++);
+			if ( !skip[a] && !skip[b] ) XCorrUnwrap( pX, pX->m_Sig[a], pX->m_Sig[b], N, XCorrEst( pX, a, b, Chan ) );
 		}
+	}
+
+	return( XCorrError( pX, N, MaxPower ) );
+}
+
+// Direct correlation at lag tau
+static double XCorrLag( const double* dn, const double* ds, long N, long tau )
+{
+	long	smpl;
+	double	powin = 0.0;
+
+	if ( tau >= 0 ) { dn += tau; N -= tau; }
+	else { ds -= tau; N += tau; }
+	for( smpl=0; smpl<N; smpl++ ) powin += dn[smpl] * ds[smpl];
+	return( powin );
+}
+
+// Search the lags 3..MaxTau+2 and -MaxTau-2..-3 (and 0 first, if Tau0).
+// pEst[Dir*tau]: estimates of r(tau) with error bound Err (NULL: direct search)
+static long SearchTimeDiff( const double* dn, const double* ds, long N, long MaxTau, bool Tau0, const double* pEst, long Dir, double Err )
+{
+	long	outtau=3, tau, Lag;
+	double	powin, maxpow=0.0, thr=0.0;
+
+	Lag = min( MaxTau+2, N-1 );				// r(tau) = 0 for larger lags
+	if ( pEst )
+	{
+		for( tau=3; tau<=Lag; tau++ ) thr = max( thr, max( fabs( pEst[tau] ), fabs( pEst[-tau] ) ) );
+		thr -= 2.0 * Err;
+	}
+	if ( Tau0 )
+	{
+		powin = XCorrLag( dn, ds, N, 0 );
+		outtau = 0;
+		maxpow = powin*powin;
+	}
+	for( tau=3; tau<=Lag; tau++ )
+	{
+		if ( pEst && ( fabs( pEst[Dir*tau] ) < thr ) ) continue;
+		powin = XCorrLag( dn, ds, N, tau );
 		if(powin*powin>maxpow)
 		{
 			outtau=tau;
 			maxpow=powin*powin;
 		}
 	}
-	for( tau=-3-MaxTau+1; tau<-3+1; tau++)
+	for( tau=-Lag; tau<=-3; tau++ )
 	{
-		pdn=dn;
-		pds=ds-tau;
-		for(powin=0.0, smpl=-tau; smpl<N; smpl++ )
-		{
-			powin += *(pdn++) * *(pds++);
-		}
+		if ( pEst && ( fabs( pEst[Dir*tau] ) < thr ) ) continue;
+		powin = XCorrLag( dn, ds, N, tau );
 		if(powin*powin>maxpow)
 		{
 			outtau=tau;
 			maxpow=powin*powin;
 		}
 	}
-
-	delete[] dn;
-	delete[] ds;
 	return(outtau);
 }
 
+// Time difference of one channel pair
+static long GetTimeDiffPair(int *sdmas, int *sdsla, long N, long MaxTau, bool Tau0, MCC_XCORR *pXCorr)
+{
+	long	smpl;
+	double	*dn, *ds, *pEst = NULL, Power[2] = { 0.0, 0.0 };
+
+	AllocateXCorr( pXCorr, 2, N, MaxTau );
+	dn = pXCorr->m_Sig[0];
+	ds = pXCorr->m_Sig[1];
+	for( smpl=0; smpl<N; smpl++ )
+	{
+		dn[smpl]= (double)sdmas[smpl];
+		ds[smpl]= (double)sdsla[smpl];
+		Power[0] += dn[smpl] * dn[smpl];
+		Power[1] += ds[smpl] * ds[smpl];
+	}
+	if ( pXCorr->m_Size )
+	{
+		XCorrSpectra( pXCorr, dn, ds, N, pXCorr->m_Spec[0], pXCorr->m_Spec[1] );
+		XCorrEstimate( pXCorr, pXCorr->m_Spec[0], pXCorr->m_Spec[1], NULL, NULL, pXCorr->m_Est, NULL );
+		pEst = pXCorr->m_Est + pXCorr->m_Lag;
+		XCorrUnwrap( pXCorr, dn, ds, N, pEst );
+	}
+	return( SearchTimeDiff( dn, ds, N, MaxTau, Tau0, pEst, 1, pEst ? XCorrError( pXCorr, N, max( Power[0], Power[1] ) ) : 0.0 ) );
+}
+
+long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau, MCC_XCORR *pXCorr)
+{
+	/*
+		As we use 3(no TimeDiff)+3(TimeDiff) taps,
+
+		0   1   2   3   4   5   6   7 .....
+	   |          |           |
+        noTD 3taps   TD 3taps
+
+		therefore minimum TimeDiff should be 4.
+												*/
+	if(MaxTau > N-3) MaxTau = N-3;
+	return( GetTimeDiffPair( sdmas, sdsla, N, MaxTau, false, pXCorr ) );
+}
+
+long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau, MCC_XCORR *pXCorr)
+{
+//include Tau=0
+	/*
+		As we use 3(no TimeDiff)+3(TimeDiff) taps,
+
+		0   1   2   3   4   5   6   7 .....
+	   |          |           |
+        noTD 3taps   TD 3taps
+
+		therefore minimum TimeDiff should be 3.
+												*/
+	if(MaxTau > N) MaxTau = N;
+	return( GetTimeDiffPair( sdmas, sdsla, N, MaxTau, true, pXCorr ) );
+}
+
 
 ////////////////////////////////////////
 // Subtract Residual Signal (encoder) //
@@ -1076,7 +1353,7 @@ void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccM
 			}//MM=1
 			else if(MccMode==2)
 			{
-				tdtau[cnl]=GetTimeDiff(sdmas,sdsla,N,maxtau);
+				tdtau[cnl]=GetTimeDiff(sdmas,sdsla,N,maxtau,&pBuffer->m_XCorr);
 				if(tdtau[cnl]>0) {ss=1; se=N-tdtau[cnl]-1;}
 				else {ss=-tdtau[cnl]+1; se=N-1;}
 				GetGammaMulti6Tap(sdmas,sdsla,N,mtgmm[cnl],tdtau[cnl]);
@@ -1235,6 +1512,7 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 	int*	puchan = pBuffer->m_tmppuchan;
 	char*	xpara = pBuffer->m_xpara;
 	long	maxtau = pBuffer->m_MaxTau;
+	MCC_XCORR*	pXCorr = &pBuffer->m_XCorr;
 	long	NumMat, rowi, colj, smpl, cnl, ntm, stopflag, cnlmas, cnlsla, nbest, tdtau;
 	long	Nclus;
 	long	ite;
@@ -1242,6 +1520,8 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 	int*	dsla;
 	long ss, se;
 	double	powsla, powmas, powin, tmppow, tmpcos, tsdist;
+	double	*pEst = NULL, Err;
+	long	Dir = 1;
 	CHANDISTMAT*	DistanceEandS;
 	CHANDISTMAT*	DistanceEonly;
 	int*	endflag;
@@ -1262,8 +1542,12 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 
 	endflag = new int [ Chan * Nclus ];
 
+	AllocateXCorr( pXCorr, Chan, N, maxtau );
+	if ( maxtau > N ) maxtau = N;
+
 	for( ite=0; ite<Nclus; ite++ ) {
 		for( cnl=ite*Chan; cnl<Chan*(ite+1); cnl++ ) endflag[cnl] = 0;
+		Err = XCorrChannels( pXCorr, dmat + ite*Chan, xpara + ite*Chan, Chan, N );
 		ntm = 0;
 		for( rowi=ite*Chan; rowi<ite*Chan+Chan; rowi++ ) {	// Difference
 			memcpy( dsla, dmat[rowi], N * sizeof(int) );
@@ -1300,7 +1584,12 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 					powmas = 0.0;
 					tmpcos = 0.0;
 					powin = 0.0;
-					tdtau=GetTimeDiff0(dmas,dsla,N,maxtau);
+					if ( pXCorr->m_Size )
+					{
+						if ( colj < rowi ) { pEst = XCorrEst( pXCorr, colj-ite*Chan, rowi-ite*Chan, Chan ); Dir = 1; }
+						else { pEst = XCorrEst( pXCorr, rowi-ite*Chan, colj-ite*Chan, Chan ); Dir = -1; }
+					}
+					tdtau=SearchTimeDiff(pXCorr->m_Sig[colj-ite*Chan],pXCorr->m_Sig[rowi-ite*Chan],N,maxtau,true,pEst,Dir,Err);
 					if(tdtau>0) {ss=1; se=N-tdtau-1;}
 					else {ss=-tdtau+1; se=N-1;}
 					for( smpl=ss; smpl<se; smpl++ ) {
@@ -109,6 +109,20 @@ public:
 //                    Multi-channel correlation                     //
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
+// Buffers of the time difference search (allocated on first use)
+typedef	struct _MCC_XCORR {
+	long			m_N;			// Frame length
+	long			m_Chan;			// Number of channels
+	long			m_MaxTau;		// Maximum of time lag
+	long			m_Lag;			// Estimates are kept for lags -m_Lag..m_Lag
+	long			m_Size;			// FFT length (0: direct search only)
+	double*			m_Twiddle;		// exp(-2*pi*i*k/m_Size), k < m_Size/2
+	double*			m_Work;			// Complex FFT buffer
+	double**		m_Sig;			// Residuals as double [channel]
+	double**		m_Spec;			// Spectra, k <= m_Size/2 [channel]
+	double*			m_Est;			// Estimated correlations [channel pair][lag]
+} MCC_XCORR;
+
 typedef	struct _MCC_ENC_BUFFER {
 	int**			m_dmat;
 	int**			m_stdmat;
@@ -137,6 +151,7 @@ typedef	struct _MCC_ENC_BUFFER {
 	int**			m_mtgmm;
 	int*			m_vgmm;
 	long			m_MaxTau;
+	MCC_XCORR		m_XCorr;
 } MCC_ENC_BUFFER;
 
 typedef	struct _MCC_DEC_BUFFER {
@@ -197,8 +212,8 @@ void	Cholesky( double* a, double* b, const double* c, int n );
 // MCC-extension functions
 void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccMode);
 void	ReconstructResidualTD( MCC_DEC_BUFFER* pBuffer, long Chan, long N );
-long	GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau);
-long	GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau);
+long	GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau, MCC_XCORR *pXCorr);
+long	GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau, MCC_XCORR *pXCorr);
 void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCC );
 void	GetGammaMulti3Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau);
 void	GetGammaMulti6Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau);
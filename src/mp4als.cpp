@@ -218,15 +218,15 @@ contents : Main file for MPEG-4 Audio Lossless Coding framework
 #endif
 
 #define CODEC_STR "mp4alsRM23"
-#define	ALS_TMP_FILENAME	CODEC_STR ".$$$"
 
 void ShowUsage(void);
 void ShowHelp(void);
+bool GetRangeOption(short argc, char **argv, ALS_INT64 &Start, ALS_INT64 &Length);
 
 int main(int argc, char **argv)
 {
 	clock_t start, finish;
-	short verbose, decode, info, autoname = 0, output, len, crc = 0, result = 0, input, wrongext;
+	short verbose, decode, info, buildindex, autoname = 0, output, len, crc = 0, result = 0, input, wrongext;
 	char *infile, *outfile, tmp[255], *tmp2;
 	double playtime;
 	AUDIOINFO ainfo;
@@ -299,6 +299,9 @@ int main(int argc, char **argv)
 
 	verbose = CheckOption(argc, argv, "-v");
 	decode = CheckOption(argc, argv, "-x");
+	buildindex = CheckOption(argc, argv, "-index");
+	if (buildindex)
+		decode = 1;
 	info = CheckOption(argc, argv, "-I");
 	mp4file = ( CheckOption( argc, argv, "-MP4" ) != 0 );
 	oafi_flag = ( CheckOption( argc, argv, "-OAFI" ) != 0 );
@@ -473,6 +476,7 @@ int main(int argc, char **argv)
 		short bs = GetOptionValue(argc, argv, "-g");				// block switching level
 		encoder.SetSub(bs);
 		encoder.SetCRC(!CheckOption(argc, argv, "-e"));				// disable CRC
+		short threads = encoder.SetThreads(GetOptionValue(argc, argv, "-j", 1));	// encoder threads
 		
 		long mccnojs = GetOptionValue(argc, argv, "-s");
 		if (mccnojs)
@@ -561,25 +565,10 @@ int main(int argc, char **argv)
 		if ( mp4file ) {
 			// Check options.
 			if ( strcmp( outfile, " " ) == 0 ) { fprintf( stderr, "\nstdout is not available for MP4 file format.\n" ); exit( 3 ); }
-			if ( CheckOption( argc, argv, "-c" ) ) { fprintf( stderr, "\n-c option is not available for MP4 file format.\n" ); exit( 3 ); }
 			if ( GetOptionValue( argc, argv, "-u" ) == 2 ) { fprintf( stderr, "\n-u2 option is not available for MP4 file format.\n" ); exit( 3 ); }
 
-			// Build up MP4INFO structure.
-			mp4info.m_pInFile = ALS_TMP_FILENAME;
-			mp4info.m_pOutFile = outfile;
-			mp4info.m_pOriginalFile = infile;
-			mp4info.m_Samples = ainfo.Samples;
-			mp4info.m_HeaderSize = oafi_flag ? ainfo.HeaderSize : 0;
-			mp4info.m_TrailerSize = oafi_flag ? ainfo.TrailerSize : 0;
-			mp4info.m_AuxDataSize = 0;	// Not used.
-			mp4info.m_HeaderOffset = mp4info.m_TrailerOffset = mp4info.m_AuxDataOffset = 0;	// Not used in encoding.
-			mp4info.m_FileType = static_cast<NAlsImf::IMF_UINT8>( type );
-			mp4info.m_FileTypeName.erase();
-			mp4info.m_RMflag = true;
-			mp4info.m_StripRaInfo = true;	// true:Strip RA info / false:Do not strip RA info
-			mp4info.m_RaLocation = 0;		// RAU size location: 0=frames, 1=header, 2=none
-			mp4info.m_UseMeta = oafi_flag;
-			outfile = (char*)ALS_TMP_FILENAME;
+			// The frames are written directly to the MP4 file.
+			encoder.SetProfileIndication( !CheckOption( argc, argv, "-npi" ) );
 		}
 
 		// Open Output File
@@ -593,16 +582,20 @@ int main(int argc, char **argv)
 		if (verbose)
 		{
 			printf("\nPCM file: %s", strcmp(infile, " ") ? infile : "-");
-			if ( mp4file ) printf( "\nMP4 file: %s", mp4info.m_pOutFile );
-			else printf("\nALS file: %s", outfile);
+			printf("\n%s file: %s", mp4file ? "MP4" : "ALS", outfile);
 			printf("\n\nEncoding...   0%%");
 			fflush(stdout);
 		}
 
 		// Encoding ///////////////////////////////////////////////////////////////////////////////
-		if (!verbose)
+		if (!verbose || (threads > 1))
 		{
 			result = encoder.EncodeAll();
+			if (verbose)
+			{
+				printf("\b\b\b\b100%%");
+				fflush(stdout);
+			}
 		}
 		else
 		{
@@ -648,29 +641,10 @@ int main(int argc, char **argv)
 			}
 		}
 
-		// Converting ALS to MP4 //////////////////////////////////////////////////////////////////
-		if ( mp4file ) {
-			if ( !CheckOption( argc, argv, "-npi" ) ) {
-				// Set the indicated profile levels
-				if ( ALSProfIsMember( encoder.GetConformantProfiles(), ALS_SIMPLE_PROFILE_L1 ) )
-					mp4info.m_audioProfileLevelIndication = MP4_AUDIO_PROFILE_ALS_SP_L1;
-			}
-
-			A2MERR	A2mErr = AlsToMp4( mp4info );
-			if ( A2mErr != A2MERR_NONE ) {
-				fprintf( stderr, "\nERROR: Unable to convert ALS to MP4: %s\n", ToErrorString( A2mErr ) );
-				encoder.CloseFiles();
-				remove( ALS_TMP_FILENAME );
-				exit( 1 );
-			}
-			outfile = const_cast<char*>( mp4info.m_pOutFile );
-		}
-
 		// End of encoding ////////////////////////////////////////////////////////////////////////
 
 		if ( result < 0 ) {
 			encoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			switch( result ) {
 			case -1:
 				fprintf(stderr, "\nERROR: %s is not a supported sound file!\n", infile);
@@ -708,17 +682,8 @@ int main(int argc, char **argv)
 			long freq = ainfo.Freq;
 			long chan = ainfo.Chan;
 			ALS_INT64 samp = ainfo.Samples;
-			ALS_INT64 pcmsize, alssize, mp4size;
+			ALS_INT64 pcmsize, alssize;
 			encoder.GetFilePositions(&pcmsize, &alssize);
-			mp4size = 0;
-			if ( mp4file ) {
-				HALSSTREAM hMp4Stream = NULL;
-				if ( OpenFileReader( mp4info.m_pOutFile, &hMp4Stream ) == 0 ) {
-					fseek( hMp4Stream, 0, SEEK_END );
-					mp4size = ftell( hMp4Stream );
-					fclose( hMp4Stream );
-				}
-			}
 			double ratio = (double)pcmsize / alssize;
 			playtime = (double)samp / freq;
 
@@ -729,8 +694,7 @@ int main(int argc, char **argv)
 			printf("\nBit rate     : %.1f kbit/s", freq * chan * res / 1000.0);
 			printf("\nPlaying time : %.1f sec", playtime);
 			printf("\nPCM file size: " PRINTF_LL " bytes", pcmsize);
-			if ( mp4file ) printf("\nMP4 file size: " PRINTF_LL " bytes", mp4size);
-			else printf("\nALS file size: " PRINTF_LL " bytes", alssize);
+			printf("\n%s file size: " PRINTF_LL " bytes", mp4file ? "MP4" : "ALS", alssize);
 			printf("\nCompr. ratio : %.3f (%.2f %%)", ratio, 100 / ratio);
 			printf("\nAverage bps  : %.3f", res / ratio);
 			printf("\nAverage rate : %.1f kbit/s\n", freq * chan * res / (ratio * 1000));
@@ -768,6 +732,7 @@ int main(int argc, char **argv)
 			}
 
 			decoder.OpenOutputFile("");
+			decoder.SetThreads(threads);
 
 			crc = decoder.DecodeAll( mp4info );
 
@@ -851,44 +816,30 @@ int main(int argc, char **argv)
 		if ( mp4file ) {
 			// Check options.
 			if ( strcmp( infile, " " ) == 0 ) { fprintf( stderr, "\nstdin is not available for MP4 file format.\n" ); exit( 3 ); }
-
-			// Build up MP4INFO structure.
-			mp4info.m_pInFile = infile;
-			mp4info.m_pOutFile = ALS_TMP_FILENAME;
-			mp4info.m_RMflag = true;
-			mp4info.m_StripRaInfo = true;	// true:Strip RA info / false:Do not strip RA info
-			mp4info.m_RaLocation = 0;		// RAU size location: 0=frames, 1=header, 2=none
-
-			// Convert MP4 to ALS.
-			A2MERR	A2mErr = Mp4ToAls( mp4info );
-			if ( A2mErr != A2MERR_NONE ) {
-				fprintf( stderr, "\nERROR: Unable to convert MP4 to ALS: %s\n", ToErrorString( A2mErr ) );
-				remove( ALS_TMP_FILENAME );
-				exit( 1 );
-			}
-			switch ( mp4info.m_audioProfileLevelIndication ) {
-				case 0x3c: ALSProfAddSet( IndicatedProfiles, ALS_SIMPLE_PROFILE_L1 ); break;
-				default: break;
-			}
 		}
 
 		// Open Input File
-		if (result = decoder.OpenInputFile(mp4file ? mp4info.m_pOutFile : infile, mp4file))
+		if (result = decoder.OpenInputFile(infile, mp4file))
 		{
-			fprintf(stderr, "\nUnable to open file %s for reading!\n", mp4file ? mp4info.m_pOutFile : infile);
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
+			fprintf(stderr, "\nUnable to open file %s for reading!\n", infile);
 			exit(3);
 		}
 
 		// Analyse Input File
 		if (result = decoder.AnalyseInputFile(&ainfo, &encinfo, mp4info))
 		{
-			fprintf(stderr, "\nERROR: %s is not a valid ALS file!\n", mp4file ? mp4info.m_pOutFile : infile);
+			fprintf(stderr, "\nERROR: %s is not a valid %s file!\n", infile, mp4file ? "MP4" : "ALS");
 			decoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(2);
 		}
 
+		if ( mp4file ) {
+			switch ( mp4info.m_audioProfileLevelIndication ) {
+				case 0x3c: ALSProfAddSet( IndicatedProfiles, ALS_SIMPLE_PROFILE_L1 ); break;
+				default: break;
+			}
+		}
+
 		if (verbose)
 		{
 			if (info)
@@ -959,16 +910,51 @@ int main(int argc, char **argv)
 
 			if (info) {
 				decoder.CloseFiles();
-				if ( mp4file ) remove( ALS_TMP_FILENAME );
 				exit(0);
 			}
 		}
 
+		// Build or update seek index only?
+		if (buildindex)
+		{
+			long rau = decoder.BuildIndex();
+			decoder.CloseFiles();
+			if (rau == -1)
+			{
+				fprintf(stderr, "\nERROR: %s needs no seek index (MP4 file, no random access, or RAU sizes in header)!\n", infile);
+				exit(1);
+			}
+			else if (rau < 0)
+			{
+				fprintf(stderr, "\nERROR: Unable to build seek index %s.idx!\n", infile);
+				exit(2);
+			}
+			if (verbose)
+			{
+				ALS_INT64 fr = (ainfo.Samples + encinfo.FrameLength - 1) / encinfo.FrameLength;
+				printf("\nSeek index: %s.idx (%ld of " PRINTF_LL " random access units)\n", infile, rau, (fr + encinfo.RandomAccess - 1) / encinfo.RandomAccess);
+				fflush(stdout);
+			}
+			exit(0);
+		}
+
+		// Decode part of the file only?
+		ALS_INT64 rstart = 0, rlength = 0;
+		bool range = GetRangeOption(argc, argv, rstart, rlength);
+		if (range && ((rstart < 0) || (rlength < 1) || (rstart >= ainfo.Samples)))
+		{
+			fprintf(stderr, "\nERROR: Invalid range, %s has " PRINTF_LL " samples!\n", infile, ainfo.Samples);
+			decoder.CloseFiles();
+			exit(1);
+		}
+		ALS_INT64 rend = (rlength > ainfo.Samples - rstart) ? ainfo.Samples : rstart + rlength;
+
 		if (autoname)
 		{
 			// Append original file extension (if known)
 			static const char* KnownExt[5] = { "wav", "aif", "bwf", "w64", "bwf" };
-			if ( ( ainfo.FileType >= 1 ) && ( ainfo.FileType <= 5 ) ) strcpy( tmp2+1, KnownExt[ ainfo.FileType-1 ] );
+			if ( range ) strcpy( tmp2+1, "raw" );	// no header
+			else if ( ( ainfo.FileType >= 1 ) && ( ainfo.FileType <= 5 ) ) strcpy( tmp2+1, KnownExt[ ainfo.FileType-1 ] );
 			else strcpy( tmp2+1, "raw" );
 			outfile = tmp;
 		}
@@ -978,13 +964,41 @@ int main(int argc, char **argv)
 		{
 			fprintf(stderr, "\nUnable to open file %s for writing!\n", outfile);
 			decoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(1);
 		}
 
 		// Decoding ///////////////////////////////////////////////////////////////////////////////
-		if (!verbose)
+		short threads = decoder.SetThreads(GetOptionValue(argc, argv, "-j", 1));	// decoder threads
+		decoder.SetLegacyRLSLMS(CheckOption(argc, argv, "-zold"));			// RLSLMS files of older builds
+		if (range)
+		{
+			if (verbose)
+			{
+				printf("\n%s file: %s", mp4file ? "MP4" : "ALS", strcmp(infile, " ") ? infile : "-");
+				printf("\nPCM file: %s (raw)\n", outfile);
+				printf("\nDecoding samples " PRINTF_LL " to " PRINTF_LL "...", rstart, rend - 1);
+				fflush(stdout);
+				playtime = (double)(rend - rstart) / ainfo.Freq;
+			}
+			crc = decoder.DecodeRange( rstart, rlength );
+		}
+		else if (!verbose)
 			crc = decoder.DecodeAll( mp4info );
+		else if (threads > 1)
+		{
+			printf("\n%s file: %s", mp4file ? "MP4" : "ALS", strcmp(infile, " ") ? infile : "-");
+			printf("\nPCM file: %s\n", outfile);
+
+			printf("\nDecoding...   0%%");
+			fflush(stdout);
+
+			crc = decoder.DecodeAll( mp4info );
+			if (crc >= 0)
+			{
+				printf("\b\b\b\b100%%");
+				fflush(stdout);
+			}
+		}
 		else
 		{
 			long fpro, fpro_alt = 0, step = 1;
@@ -1045,19 +1059,17 @@ int main(int argc, char **argv)
 		if (crc == -1)
 		{
 			fprintf(stderr, "\nERROR: %s is not a valid %s file!\n", infile, mp4file ? "MP4" : "ALS");
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(2);
 		}
 		else if (crc == -2)
 		{
 			fprintf(stderr, "\nERROR: Unable to write to %s - disk full?\n", outfile);
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(1);
 		}
 		else if (verbose)
 		{
 			printf(" done\n");
-			printf("\nCRC status: %s\n", encinfo.CRCenabled ? (crc ? "FAILED!" : "ok") : "n/a");
+			printf("\nCRC status: %s\n", (encinfo.CRCenabled && !range) ? (crc ? "FAILED!" : "ok") : "n/a");
 
 			printf("\nDeclared Profiles      : %s\n", ALSProfToString(IndicatedProfiles).c_str());
 			printf("Conformant Profiles    : %s\n", ALSProfToString(decoder.GetConformantProfiles()).c_str());
@@ -1070,12 +1082,13 @@ int main(int argc, char **argv)
 			fflush(stdout);
 		}
 		else if ((encinfo.CRCenabled) && (crc > 0))
+		{
 			fprintf(stderr, "\nDECODING ERROR: CRC failed for %s\n", infile);
+			if (encinfo.RLSLMS && !CheckOption(argc, argv, "-zold"))
+				fprintf(stderr, "If it was encoded with -z# by an older build (C++11, e.g. CMake), try -zold.\n");
+		}
 	}
 
-	// Removing temporary file.
-	if ( mp4file ) remove( ALS_TMP_FILENAME );
-
 	// Delete input file?
 	if (!crc && CheckOption(argc, argv, "-d"))
 		remove(infile);
@@ -1099,6 +1112,18 @@ int main(int argc, char **argv)
 	return(0);
 }
 
+// Get -range option, e.g. -range441000,44100 (start,length in samples)
+// Returns true if the option is set (values are not checked)
+bool GetRangeOption(short argc, char **argv, ALS_INT64 &Start, ALS_INT64 &Length)
+{
+	for (short i = 1; i < argc; i++)
+	{
+		if (!strncmp(argv[i], "-range", 6))
+			return(sscanf(argv[i] + 6, PRINTF_LL "," PRINTF_LL, &Start, &Length) == 2);
+	}
+	return(false);
+}
+
 // Show usage message
 void ShowUsage()
 {
@@ -1134,8 +1159,15 @@ void ShowHelp()
 	printf("\n  -c  : Check accuracy by decoding the whole file after encoding.");
 	printf("\n  -d  : Delete input file after completion.");
 	printf("\n  -h  : Help (this message)");
+	printf("\n  -j# : Number of threads: 1 = single-threaded (default), 0 = auto");
 	printf("\n  -v  : Verbose mode (file info, processing time)");
-	printf("\n  -x  : Extract (all options except -v and -MP4 are ignored)");
+	printf("\n  -x  : Extract (all options except -v, -j, -range, -zold and -MP4 are ignored)");
+	printf("\n  -range#,#: Extract only # samples from sample # on (start,length),");
+	printf("\n        as raw PCM without header and trailer");
+	printf("\n  -index: Build or update the seek index infile.idx (for files encoded with");
+	printf("\n        -u0 or -u2), used by -range and -j");
+	printf("\n  -zold: Extract RLSLMS files (-z#) of older C++11 builds (e.g. with CMake),");
+	printf("\n        which updated the RLSLMS filter history differently");
 	printf("\nEncoding Options:");
 	printf("\n  -7  : Set parameters for optimum compression (except LTP, MCC, RLSLMS)");
 	printf("\n  -a  : Adaptive prediction order");
@@ -1179,6 +1211,7 @@ void ShowHelp()
 	printf("\n  %s -x sound.als", CODEC_STR);
 	printf("\n  %s -x sound.als - > sound.wav", CODEC_STR);
 	printf("\n  %s -I -x sound.als", CODEC_STR);
+	printf("\n  %s -index sound.als", CODEC_STR);
 	printf("\n");
 	return;
 }
@@ -44,6 +44,16 @@
 #ifndef __RN_BITIO_H__
 #define __RN_BITIO_H__  1           /* prevents multiple loading            */
 
+/*
+ * 64-bit bit cache:
+ */
+#if defined(WIN32) || defined(WIN64)
+typedef unsigned __int64 BITIO_CACHE;
+#else
+#include <stdint.h>
+typedef uint64_t BITIO_CACHE;
+#endif
+
 #ifdef __cplusplus
 extern "C" {                        /* be nice to our friends in C++        */
 #endif
@@ -54,8 +64,13 @@ extern "C" {                        /* be nice to our friends in C++        */
 typedef struct
 {
     /* bitstream variables: */
-    unsigned char *start_pbs, *pbs; /* start/current byte position          */
-    unsigned int bit_offset;        /* # of leftmost bits read/written      */
+    unsigned char *start_pbs, *pbs; /* start/next byte position             */
+    unsigned char *end_pbs;         /* reader: end of the bitstream         */
+    BITIO_CACHE cache;              /* bit cache, first bit in the MSB:     */
+                                    /* writer: bits not yet stored at pbs   */
+                                    /* reader: bits already loaded from pbs */
+    unsigned int cache_bits;        /* # of valid bits in the cache         */
+    int write;                      /* nonzero if writing                   */
 
     /* bgmc encoder/decoder state: */
     unsigned int low, high;         /* current code region                  */
@@ -68,6 +83,7 @@ typedef struct
  * Function prototypes:
  */
 void bitio_init (unsigned char *buffer, int write, BITIO *p);
+void bitio_set_size (long size, BITIO *p);
 long bitio_term (BITIO *p);
 
 /* generic bit-level IO functions: */
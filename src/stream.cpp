@@ -32,8 +32,12 @@ contents : Bridge functions to stream classes in AlsImf
 
 *************************************************************************/
 
+#include	<cstring>
+#include	<new>
+#include	<vector>
 #include	"stream.h"
 #include	"ImfFileStream.h"
+#include	"bgstream.h"
 
 using namespace NAlsImf;
 
@@ -41,13 +45,26 @@ using namespace NAlsImf;
 typedef enum tagALSSTREAM_MODE {
 	ALSSTRMODE_READER,		// File reader mode
 	ALSSTRMODE_WRITER,		// File writer mode
+	ALSSTRMODE_MEMORY,		// Memory reader mode
+	ALSSTRMODE_MEMWRITER,	// Memory writer mode (also readable)
+	ALSSTRMODE_MEMSTREAM,	// CMemoryStream mode (read and write)
 } ALSSTREAM_MODE;
 
 // Stream information
 typedef	struct tagALSSTREAM {
 	ALSSTREAM_MODE			m_Mode;		// Stream mode
 	NAlsImf::CFileReader	m_Reader;	// File reader object
+	NAlsImf::CMmapReader	m_Mapped;	// Mapped file reader object
+	CReadAheadStream		m_Ahead;	// Read-ahead thread on m_Reader
+	NAlsImf::CBaseStream*	m_pReader;	// m_Mapped, m_Ahead or m_Reader (reader mode)
 	NAlsImf::CFileWriter	m_Writer;	// File writer object
+	CWriteBehindStream		m_Behind;	// Write-behind thread on m_Writer
+	NAlsImf::CBaseStream*	m_pWriter;	// m_Behind or m_Writer (writer mode), m_pMemory (memory stream mode)
+	CMemoryStream*			m_pMemory;	// Memory stream (memory stream mode)
+	const unsigned char*	m_pData;	// Memory reader data
+	ALS_UINT32				m_Size;		// Memory reader data size
+	ALS_UINT32				m_Pos;		// Memory reader position
+	std::vector<unsigned char>	m_Buffer;	// Memory writer data
 } ALSSTREAM;
 
 ////////////////////////////////////////
@@ -62,11 +79,33 @@ int	fclose( HALSSTREAM fp )
 	// Check parameter.
 	if ( fp == NULL ) return EOF;
 
-	// Close files.
+	// Close files (pending data is written first).
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	int			Result = pStream->m_Behind.Close() ? 0 : EOF;
+	pStream->m_Ahead.Close();
 	pStream->m_Reader.Close();
+	pStream->m_Mapped.Close();
 	pStream->m_Writer.Close();
 	delete pStream;
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//         Flush file stream          //
+//                                    //
+////////////////////////////////////////
+// fp = File handle
+// Return value = 0:Success / EOF:Error
+// * Waits until the write-behind thread has written all data, so that
+//   write errors are known.
+int	fflush( HALSSTREAM fp )
+{
+	// Check parameter.
+	if ( fp == NULL ) return EOF;
+
+	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	if ( ( pStream->m_Mode == ALSSTRMODE_WRITER ) && ( pStream->m_pWriter == &pStream->m_Behind ) ) return pStream->m_Behind.Flush() ? 0 : EOF;
 	return 0;
 }
 
@@ -83,7 +122,8 @@ ALS_INT64	ftell( HALSSTREAM fp )
 	if ( fp == NULL ) return -1;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	return ( pStream->m_Mode == ALSSTRMODE_READER ) ? pStream->m_Reader.Tell() : pStream->m_Writer.Tell();
+	if ( ( pStream->m_Mode == ALSSTRMODE_MEMORY ) || ( pStream->m_Mode == ALSSTRMODE_MEMWRITER ) ) return pStream->m_Pos;
+	return ( pStream->m_Mode == ALSSTRMODE_READER ) ? pStream->m_pReader->Tell() : pStream->m_pWriter->Tell();
 }
 
 ////////////////////////////////////////
@@ -98,8 +138,9 @@ void	rewind( HALSSTREAM fp )
 	if ( fp == NULL ) return;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( pStream->m_Mode == ALSSTRMODE_READER ) pStream->m_Reader.Seek( 0, CBaseStream::S_BEGIN );
-	else pStream->m_Writer.Seek( 0, CBaseStream::S_BEGIN );
+	if ( ( pStream->m_Mode == ALSSTRMODE_MEMORY ) || ( pStream->m_Mode == ALSSTRMODE_MEMWRITER ) ) pStream->m_Pos = 0;
+	else if ( pStream->m_Mode == ALSSTRMODE_READER ) pStream->m_pReader->Seek( 0, CBaseStream::S_BEGIN );
+	else pStream->m_pWriter->Seek( 0, CBaseStream::S_BEGIN );
 }
 
 ////////////////////////////////////////
@@ -117,10 +158,17 @@ int	fseek( HALSSTREAM fp, ALS_INT64 offset, int origin )
 	if ( fp == NULL ) return -1;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( pStream->m_Mode == ALSSTRMODE_READER ) {
-		return pStream->m_Reader.Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
+	if ( ( pStream->m_Mode == ALSSTRMODE_MEMORY ) || ( pStream->m_Mode == ALSSTRMODE_MEMWRITER ) ) {
+		ALS_INT64	Pos = offset;
+		if ( origin == SEEK_CUR ) Pos += pStream->m_Pos;
+		else if ( origin == SEEK_END ) Pos += pStream->m_Size;
+		if ( ( Pos < 0 ) || ( Pos > pStream->m_Size ) ) return -1;
+		pStream->m_Pos = static_cast<ALS_UINT32>( Pos );
+		return 0;
+	} else if ( pStream->m_Mode == ALSSTRMODE_READER ) {
+		return pStream->m_pReader->Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
 	} else {
-		return pStream->m_Writer.Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
+		return pStream->m_pWriter->Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
 	}
 }
 
@@ -140,11 +188,23 @@ ALS_UINT32	fwrite( const void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSST
 	if ( fp == NULL ) return 0;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( ( pStream->m_Mode != ALSSTRMODE_WRITER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
+	if ( ( pStream->m_Mode == ALSSTRMODE_READER ) || ( pStream->m_Mode == ALSSTRMODE_MEMORY ) || ( size == 0 ) || ( count == 0 ) ) return 0;
 
 	ALS_UINT64	TotalSize = static_cast<ALS_UINT64>( size ) * static_cast<ALS_UINT64>( count );
 	if ( TotalSize > 0xffffffff ) TotalSize = 0xffffffff;
-	return pStream->m_Writer.Write( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+	if ( pStream->m_Mode == ALSSTRMODE_MEMWRITER ) {
+		if ( TotalSize > 0xffffffff - pStream->m_Pos ) TotalSize = 0xffffffff - pStream->m_Pos;
+		ALS_UINT32	End = pStream->m_Pos + static_cast<ALS_UINT32>( TotalSize );
+		if ( End > pStream->m_Size ) {
+			pStream->m_Buffer.resize( End );
+			pStream->m_Size = End;
+		}
+		if ( TotalSize > 0 ) memcpy( &pStream->m_Buffer[pStream->m_Pos], buffer, static_cast<size_t>( TotalSize ) );
+		pStream->m_pData = pStream->m_Buffer.empty() ? NULL : &pStream->m_Buffer[0];
+		pStream->m_Pos = End;
+		return static_cast<ALS_UINT32>( TotalSize ) / size;
+	}
+	return pStream->m_pWriter->Write( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
 }
 
 ////////////////////////////////////////
@@ -163,11 +223,59 @@ ALS_UINT32	fread( void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp
 	if ( fp == NULL ) return 0;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( ( pStream->m_Mode != ALSSTRMODE_READER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
+	if ( ( pStream->m_Mode == ALSSTRMODE_WRITER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
 
 	ALS_UINT64	TotalSize = static_cast<ALS_UINT64>( size ) * static_cast<ALS_UINT64>( count );
 	if ( TotalSize > 0xffffffff ) TotalSize = 0xffffffff;
-	return pStream->m_Reader.Read( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+	if ( ( pStream->m_Mode == ALSSTRMODE_MEMORY ) || ( pStream->m_Mode == ALSSTRMODE_MEMWRITER ) ) {
+		if ( TotalSize > pStream->m_Size - pStream->m_Pos ) TotalSize = pStream->m_Size - pStream->m_Pos;
+		memcpy( buffer, pStream->m_pData + pStream->m_Pos, static_cast<size_t>( TotalSize ) );
+		pStream->m_Pos += static_cast<ALS_UINT32>( TotalSize );
+		return static_cast<ALS_UINT32>( TotalSize ) / size;
+	}
+	if ( pStream->m_Mode == ALSSTRMODE_MEMSTREAM ) return pStream->m_pMemory->Read( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+	return pStream->m_pReader->Read( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Access data in place         //
+//                                    //
+////////////////////////////////////////
+// fp = File handle
+// pSize = Pointer to variable which receives the number of bytes
+//         from the current position to the end of the stream
+// Return value = Pointer to the data at the current position, or NULL
+//                if the stream data is not in memory (or at the end)
+// * Only for memory readers, memory streams and mapped files. The
+//   position is not changed, use fseek() to skip the data.
+const void*	fpeek( HALSSTREAM fp, ALS_UINT32* pSize )
+{
+	// Check parameters.
+	if ( pSize == NULL ) return NULL;
+	*pSize = 0;
+	if ( fp == NULL ) return NULL;
+
+	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	if ( pStream->m_Mode == ALSSTRMODE_MEMORY ) {
+		if ( pStream->m_Pos >= pStream->m_Size ) return NULL;
+		*pSize = pStream->m_Size - pStream->m_Pos;
+		return pStream->m_pData + pStream->m_Pos;
+	}
+	if ( pStream->m_Mode == ALSSTRMODE_MEMSTREAM ) {
+		IMF_INT64	Pos = pStream->m_pMemory->Tell();
+		IMF_INT64	Size = pStream->m_pMemory->GetEnd() - Pos;
+		if ( ( Pos < pStream->m_pMemory->GetStart() ) || ( Size <= 0 ) ) return NULL;
+		*pSize = ( Size > 0xffffffff ) ? 0xffffffff : static_cast<ALS_UINT32>( Size );
+		return pStream->m_pMemory->GetData( Pos );
+	}
+	if ( ( pStream->m_Mode == ALSSTRMODE_READER ) && ( pStream->m_pReader == &pStream->m_Mapped ) ) {
+		IMF_UINT32	Size;
+		const IMF_UINT8*	pData = pStream->m_Mapped.Peek( Size );
+		*pSize = Size;
+		return pData;
+	}
+	return NULL;
 }
 
 ////////////////////////////////////////
@@ -191,9 +299,14 @@ int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream )
 		pStream = new ALSSTREAM;
 		if ( pStream == NULL ) throw -2;
 		pStream->m_Mode = ALSSTRMODE_READER;
+		pStream->m_pData = NULL;
+		pStream->m_Size = pStream->m_Pos = 0;
 
-		// Open a file.
-		if ( !pStream->m_Reader.Open( pFilename ) ) throw -3;
+		// Open a file (regular files are mapped into memory if possible,
+		// other files are read ahead on a separate thread).
+		if ( pStream->m_Mapped.Open( pFilename ) ) pStream->m_pReader = &pStream->m_Mapped;
+		else if ( pStream->m_Reader.Open( pFilename ) ) pStream->m_pReader = pStream->m_Ahead.Open( &pStream->m_Reader ) ? static_cast<CBaseStream*>( &pStream->m_Ahead ) : &pStream->m_Reader;
+		else throw -3;
 
 		// Save pStream as HALSSTREAM.
 		*phStream = reinterpret_cast<HALSSTREAM>( pStream );
@@ -229,9 +342,12 @@ int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream )
 		pStream = new ALSSTREAM;
 		if ( pStream == NULL ) throw -2;
 		pStream->m_Mode = ALSSTRMODE_WRITER;
+		pStream->m_pData = NULL;
+		pStream->m_Size = pStream->m_Pos = 0;
 
-		// Create a file.
+		// Create a file (written on a separate thread if possible).
 		if ( !pStream->m_Writer.Open( pFilename, 0, CFileWriter::FW_NO_TRUNCATE ) ) throw -3;
+		pStream->m_pWriter = pStream->m_Behind.Open( &pStream->m_Writer ) ? static_cast<CBaseStream*>( &pStream->m_Behind ) : &pStream->m_Writer;
 
 		// Save pStream as HALSSTREAM.
 		*phStream = reinterpret_cast<HALSSTREAM>( pStream );
@@ -246,4 +362,229 @@ int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream )
 	return RetCode;
 }
 
+////////////////////////////////////////
+//                                    //
+//   Open memory block for reading    //
+//                                    //
+////////////////////////////////////////
+// pData = Data to read (must be valid until the stream is closed)
+// Size = Data size in bytes
+// phStream = Pointer to variable which receives stream handle
+// Return value = Error code (0 means no error)
+int	OpenMemoryReader( const void* pData, ALS_UINT32 Size, HALSSTREAM* phStream )
+{
+	// Check parameters.
+	if ( ( ( pData == NULL ) && ( Size != 0 ) ) || ( phStream == NULL ) ) return -1;
+
+	// Create ALSSTREAM structure.
+	ALSSTREAM*	pStream = new ALSSTREAM;
+	if ( pStream == NULL ) return -2;
+	pStream->m_Mode = ALSSTRMODE_MEMORY;
+	pStream->m_pData = static_cast<const unsigned char*>( pData );
+	pStream->m_Size = Size;
+	pStream->m_Pos = 0;
+
+	// Save pStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pStream );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//   Open memory block for writing    //
+//                                    //
+////////////////////////////////////////
+// phStream = Pointer to variable which receives stream handle
+// Return value = Error code (0 means no error)
+// * The memory grows as needed. The written data can be read back
+//   through the same handle after seeking.
+int	OpenMemoryWriter( HALSSTREAM* phStream )
+{
+	// Check parameter.
+	if ( phStream == NULL ) return -1;
+
+	// Create ALSSTREAM structure.
+	ALSSTREAM*	pStream = new ALSSTREAM;
+	if ( pStream == NULL ) return -2;
+	pStream->m_Mode = ALSSTRMODE_MEMWRITER;
+	pStream->m_pData = NULL;
+	pStream->m_Size = 0;
+	pStream->m_Pos = 0;
+
+	// Save pStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pStream );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//   Open memory stream as a handle   //
+//                                    //
+////////////////////////////////////////
+// pMemory = Memory stream (must be valid until the handle is closed)
+// phStream = Pointer to variable which receives stream handle
+// Return value = Error code (0 means no error)
+// * Reads and writes go to pMemory at its current position. Closing
+//   the handle does not destroy pMemory.
+int	OpenMemoryStream( CMemoryStream* pMemory, HALSSTREAM* phStream )
+{
+	// Check parameters.
+	if ( ( pMemory == NULL ) || ( phStream == NULL ) ) return -1;
+
+	// Create ALSSTREAM structure.
+	ALSSTREAM*	pStream = new ALSSTREAM;
+	if ( pStream == NULL ) return -2;
+	pStream->m_Mode = ALSSTRMODE_MEMSTREAM;
+	pStream->m_pData = NULL;
+	pStream->m_Size = pStream->m_Pos = 0;
+	pStream->m_pMemory = pMemory;
+	pStream->m_pWriter = pMemory;
+
+	// Save pStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pStream );
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                       CMemoryStream class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//             Read data              //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Read data buffer
+// Size = Number of bytes to read
+// Return value = Number of actually read bytes
+IMF_UINT32	CMemoryStream::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	IMF_INT64	Left = GetEnd() - m_Pos;
+
+	if ( m_Pos < m_Start ) Left = 0;
+	if ( Left < static_cast<IMF_INT64>( Size ) ) {
+		SetLastError( E_READ_STREAM );
+		Size = static_cast<IMF_UINT32>( Left );
+	}
+	if ( Size == 0 ) return 0;
+	memcpy( pBuffer, GetData( m_Pos ), Size );
+	m_Pos += Size;
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//             Write data             //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Data to write
+// Size = Number of bytes to write
+// Return value = Number of actually written bytes
+IMF_UINT32	CMemoryStream::Write( const void* pBuffer, IMF_UINT32 Size )
+{
+	if ( m_Pos < m_Start ) {
+		SetLastError( E_WRITE_STREAM );
+		return 0;
+	}
+	if ( Size == 0 ) return 0;
+
+	size_t	Offset = m_Skip + static_cast<size_t>( m_Pos - m_Start );
+	if ( Offset + Size > m_Data.size() ) {
+		try {
+			m_Data.resize( Offset + Size );
+		}
+		catch( std::bad_alloc& ) {
+			SetLastError( E_MEMORY );
+			return 0;
+		}
+	}
+	memcpy( &m_Data[Offset], pBuffer, Size );
+	m_Pos += Size;
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset position from origin
+// Origin = Base point
+// Return value = true:Success / false:Error
+// * Positions in front of GetStart() are not available any more.
+bool	CMemoryStream::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	IMF_INT64	Pos = Offset;
+
+	if ( Origin == S_CURRENT ) Pos += m_Pos;
+	else if ( Origin == S_END ) Pos += GetEnd();
+	if ( ( Pos < m_Start ) || ( Pos > GetEnd() ) ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	m_Pos = Pos;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Append data at the end       //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Data to append
+// Size = Number of bytes to append
+// Return value = true:Success / false:Out of memory
+bool	CMemoryStream::Append( const void* pBuffer, IMF_UINT32 Size )
+{
+	if ( Size == 0 ) return true;
+	try {
+		const IMF_UINT8*	pData = static_cast<const IMF_UINT8*>( pBuffer );
+		m_Data.insert( m_Data.end(), pData, pData + Size );
+	}
+	catch( std::bad_alloc& ) {
+		SetLastError( E_MEMORY );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//   Drop data in front of position   //
+//                                    //
+////////////////////////////////////////
+// Pos = First position to keep
+// * The memory is reused once the dropped part is larger than the
+//   data which is kept.
+void	CMemoryStream::Discard( IMF_INT64 Pos )
+{
+	if ( Pos > GetEnd() ) Pos = GetEnd();
+	if ( Pos <= m_Start ) return;
+	m_Skip += static_cast<size_t>( Pos - m_Start );
+	m_Start = Pos;
+	if ( m_Skip == m_Data.size() ) {
+		m_Data.clear();
+		m_Skip = 0;
+	} else if ( m_Skip >= m_Data.size() - m_Skip ) {
+		m_Data.erase( m_Data.begin(), m_Data.begin() + m_Skip );
+		m_Skip = 0;
+	}
+}
+
+////////////////////////////////////////
+//                                    //
+//       Get data at a position       //
+//                                    //
+////////////////////////////////////////
+// Pos = Position (GetStart() <= Pos <= GetEnd())
+// Return value = Pointer to the data at Pos, or NULL if Pos is out of range
+// * The pointer is valid until the stream is modified.
+const IMF_UINT8*	CMemoryStream::GetData( IMF_INT64 Pos ) const
+{
+	if ( ( Pos < m_Start ) || ( Pos > GetEnd() ) || m_Data.empty() ) return NULL;
+	return &m_Data[0] + m_Skip + static_cast<size_t>( Pos - m_Start );
+}
+
 // End of stream.cpp
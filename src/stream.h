@@ -36,6 +36,7 @@ contents : Header file for stream.cpp
 #define	STREAM_INCLUDED
 
 #include	<cstdio>
+#include	<vector>
 #include	"ImfFileStream.h"
 
 //////////////////////////////////////////////////////////////////////
@@ -66,6 +67,8 @@ typedef	uint64_t	ALS_UINT64;
 // Stream handle type
 typedef	void*	HALSSTREAM;
 
+class	CMemoryStream;
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                      Prototype declaration                       //
@@ -73,14 +76,73 @@ typedef	void*	HALSSTREAM;
 //////////////////////////////////////////////////////////////////////
 int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream );
 int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream );
+int	OpenMemoryReader( const void* pData, ALS_UINT32 Size, HALSSTREAM* phStream );
+int	OpenMemoryWriter( HALSSTREAM* phStream );
+int	OpenMemoryStream( CMemoryStream* pMemory, HALSSTREAM* phStream );
 
 // Function overloads
 int			fclose( HALSSTREAM fp );
+int			fflush( HALSSTREAM fp );
 ALS_INT64	ftell( HALSSTREAM fp );
 void		rewind( HALSSTREAM fp );
 int			fseek( HALSSTREAM fp, ALS_INT64 offset, int origin );
 ALS_UINT32	fwrite( const void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp );
 ALS_UINT32	fread( void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp );
+const void*	fpeek( HALSSTREAM fp, ALS_UINT32* pSize );
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         CAlsStream class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// CBaseStream interface on a stream handle, e.g. for CMp4aWriter.
+class	CAlsStream : public NAlsImf::CBaseStream {
+public:
+	CAlsStream( HALSSTREAM hStream = NULL ) : m_hStream( hStream ) {}
+	void		Attach( HALSSTREAM hStream ) { m_hStream = hStream; }
+	NAlsImf::IMF_UINT32	Read( void* pBuffer, NAlsImf::IMF_UINT32 Size ) {
+		NAlsImf::IMF_UINT32	Result = fread( pBuffer, 1, Size, m_hStream );
+		if ( Result != Size ) SetLastError( NAlsImf::E_READ_STREAM );
+		return Result;
+	}
+	NAlsImf::IMF_UINT32	Write( const void* pBuffer, NAlsImf::IMF_UINT32 Size ) {
+		NAlsImf::IMF_UINT32	Result = fwrite( pBuffer, 1, Size, m_hStream );
+		if ( Result != Size ) SetLastError( NAlsImf::E_WRITE_STREAM );
+		return Result;
+	}
+	NAlsImf::IMF_INT64	Tell( void ) { return ftell( m_hStream ); }
+	bool		Seek( NAlsImf::IMF_INT64 Offset, SEEK_ORIGIN Origin ) { return fseek( m_hStream, Offset, static_cast<int>( Origin ) ) == 0; }
+protected:
+	HALSSTREAM	m_hStream;		// Stream handle
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                       CMemoryStream class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// Stream in memory which grows as needed. The data in front of a
+// position can be dropped by Discard(), while positions stay absolute,
+// so that the stream can be used as a queue: one side writes or
+// appends data, the other side consumes it and discards it.
+class	CMemoryStream : public NAlsImf::CBaseStream {
+public:
+	CMemoryStream( void ) : m_Start( 0 ), m_Skip( 0 ), m_Pos( 0 ) {}
+	NAlsImf::IMF_UINT32	Read( void* pBuffer, NAlsImf::IMF_UINT32 Size );
+	NAlsImf::IMF_UINT32	Write( const void* pBuffer, NAlsImf::IMF_UINT32 Size );
+	NAlsImf::IMF_INT64	Tell( void ) { return m_Pos; }
+	bool		Seek( NAlsImf::IMF_INT64 Offset, SEEK_ORIGIN Origin );
+	bool		Append( const void* pBuffer, NAlsImf::IMF_UINT32 Size );	// Add data at the end (position is kept)
+	void		Discard( NAlsImf::IMF_INT64 Pos );							// Drop the data in front of Pos
+	NAlsImf::IMF_INT64	GetStart( void ) const { return m_Start; }		// Position of the first byte kept
+	NAlsImf::IMF_INT64	GetEnd( void ) const { return m_Start + static_cast<NAlsImf::IMF_INT64>( m_Data.size() - m_Skip ); }
+	const NAlsImf::IMF_UINT8*	GetData( NAlsImf::IMF_INT64 Pos ) const;	// Data at Pos (GetStart() <= Pos <= GetEnd())
+protected:
+	std::vector<NAlsImf::IMF_UINT8>	m_Data;	// Data (m_Data[m_Skip] is at m_Start)
+	NAlsImf::IMF_INT64	m_Start;	// Position of the first byte kept
+	size_t		m_Skip;				// Number of dropped bytes at the beginning of m_Data
+	NAlsImf::IMF_INT64	m_Pos;		// Current position
+};
 
 #endif	// STREAM_INCLUDED
 
@@ -0,0 +1,121 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : workers.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : Thread pool for frame-parallel processing
+
+*************************************************************************/
+
+#include "workers.h"
+
+// Start threads (returns false if no thread could be created)
+bool CWorkerPool::Start( short Threads )
+{
+	short	i;
+
+	Stop();
+	m_Quit = false;
+	try {
+		for( i=0; i<Threads; i++ ) m_Threads.push_back( std::thread( &CWorkerPool::Main, this, i ) );
+	}
+	catch( ... ) {
+		// Continue with the threads which could be created
+	}
+	return !m_Threads.empty();
+}
+
+// Finish all queued jobs and join threads
+void CWorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> Lock( m_Mutex );
+		m_Quit = true;
+	}
+	m_Ready.notify_all();
+	for( size_t i=0; i<m_Threads.size(); i++ ) m_Threads[i].join();
+	m_Threads.clear();
+}
+
+// Queue a job (executed immediately if no thread is running)
+void CWorkerPool::Push( CWorkerJob* pJob )
+{
+	if ( m_Threads.empty() ) {
+		pJob->Run( 0 );
+		pJob->m_Done = true;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> Lock( m_Mutex );
+		pJob->m_Done = false;
+		m_Queue.push_back( pJob );
+	}
+	m_Ready.notify_one();
+}
+
+// Wait until a queued job has finished
+void CWorkerPool::Wait( CWorkerJob* pJob )
+{
+	std::unique_lock<std::mutex> Lock( m_Mutex );
+	while( !pJob->m_Done ) m_Done.wait( Lock );
+}
+
+// Number of hardware threads (at least 1)
+short CWorkerPool::GetDefaultThreads()
+{
+	unsigned int	n = std::thread::hardware_concurrency();
+	if ( n < 1 ) return 1;
+	if ( n > 64 ) return 64;
+	return static_cast<short>( n );
+}
+
+// Thread main loop
+void CWorkerPool::Main( short Worker )
+{
+	CWorkerJob*	pJob;
+
+	for( ;; ) {
+		{
+			std::unique_lock<std::mutex> Lock( m_Mutex );
+			while( !m_Quit && m_Queue.empty() ) m_Ready.wait( Lock );
+			if ( m_Queue.empty() ) return;
+			pJob = m_Queue.front();
+			m_Queue.pop_front();
+		}
+
+		pJob->Run( Worker );
+
+		{
+			std::lock_guard<std::mutex> Lock( m_Mutex );
+			pJob->m_Done = true;
+		}
+		m_Done.notify_all();
+	}
+}
+
+// End of workers.cpp
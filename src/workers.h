@@ -0,0 +1,86 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : workers.h
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 17, 2026
+contents : Header file for workers.cpp
+
+*************************************************************************/
+
+#ifndef	WORKERS_INCLUDED
+#define	WORKERS_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Unit of work which is executed by a CWorkerPool thread.
+// Run() receives the index of the executing thread (0..Threads-1),
+// so that per-thread contexts can be selected without locking.
+class CWorkerJob
+{
+	friend class CWorkerPool;
+
+public:
+	CWorkerJob() : m_Done( false ) {}
+	virtual ~CWorkerJob() {}
+	virtual void Run( short Worker ) = 0;
+
+private:
+	bool m_Done;					// true:Run() has finished
+};
+
+// Fixed number of threads executing queued jobs in FIFO order
+class CWorkerPool
+{
+public:
+	CWorkerPool() : m_Quit( false ) {}
+	~CWorkerPool() { Stop(); }
+
+	bool Start( short Threads );	// Start threads
+	void Stop();					// Finish all queued jobs and join threads
+	void Push( CWorkerJob* pJob );	// Queue a job
+	void Wait( CWorkerJob* pJob );	// Wait until a queued job has finished
+	short GetThreads() const { return static_cast<short>( m_Threads.size() ); }
+
+	static short GetDefaultThreads();	// Number of hardware threads
+
+protected:
+	void Main( short Worker );
+
+	std::vector<std::thread> m_Threads;
+	std::deque<CWorkerJob*> m_Queue;
+	std::mutex m_Mutex;
+	std::condition_variable m_Ready;	// Signalled when a job is queued
+	std::condition_variable m_Done;		// Signalled when a job has finished
+	bool m_Quit;
+};
+
+#endif	// WORKERS_INCLUDED
@@ -0,0 +1,150 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : bench_bitio.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 18, 2026
+contents : Throughput benchmark for the bit-level I/O of rn_bitio.cpp
+
+*************************************************************************/
+
+/*************************************************************************
+ * Measures the throughput of the Rice block coder and of put_bits() and
+ * get_bits() on Laplacian distributed symbols, in MB/s of bitstream.
+ * Every decoded block is compared with the input, so the benchmark also
+ * checks that the bitstreams can be read back. Build with optimization
+ * (e.g. CMAKE_BUILD_TYPE=Release) for meaningful numbers.
+ *
+ * Usage: bench_bitio [symbols [s]]	(s = 0..24)
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "rn_bitio.h"
+
+#define	SYMBOLS		1000000		// Default number of symbols
+#define	RICE_PARAM	4			// Default Rice parameter
+#define	BLOCK		4096		// Symbols per block (as in a frame)
+#define	BITS		11			// Length of the put_bits()/get_bits() vectors
+#define	MIN_TIME	0.2			// Each test is repeated for at least this many seconds
+
+typedef	std::chrono::steady_clock	CLOCK;
+
+// Seconds since Start
+static	double	Elapsed( CLOCK::time_point Start )
+{
+	return std::chrono::duration<double>( CLOCK::now() - Start ).count();
+}
+
+static	void	Report( const char* pName, long Bytes, long Runs, double Time )
+{
+	printf( "%-20s : %8.1f MB/s\n", pName, (double)Bytes * Runs / Time / 1e6 );
+}
+
+int		main( int argc, char* argv[] )
+{
+	long	N = ( argc > 1 ) ? atol( argv[1] ) : SYMBOLS;
+	int		s = ( argc > 2 ) ? atoi( argv[2] ) : RICE_PARAM;
+	int		Errors = 0;
+	long	Bytes, Runs, i, b;
+	double	Time;
+	BITIO	bio;
+	CLOCK::time_point	Start;
+
+	if ( ( N < 1 ) || ( s < 0 ) || ( s > 24 ) ) {
+		fprintf( stderr, "Usage: %s [symbols [s]]\n", argv[0] );
+		return 2;
+	}
+
+	// Laplacian symbols with a mean magnitude of about 2^s
+	std::vector<int>			Symbols( N ), Decoded( N );
+	std::vector<unsigned int>	Vectors( N );
+	unsigned int	Seed = 1;
+	for( i=0; i<N; i++ ) {
+		Seed = Seed * 1103515245 + 12345;
+		double	u = ( ( Seed >> 8 ) + 0.5 ) / 16777216.0;
+		int		m = (int)floor( -log( u ) * ldexp( 1.0, s ) );
+		Symbols[i] = ( Seed & 0x80 ) ? -m - 1 : m;
+		Vectors[i] = ( Seed >> 5 ) & ( ( 1u << BITS ) - 1 );
+	}
+	std::vector<unsigned char>	Buffer( (size_t)N * 8 + 1024 );
+
+	printf( "%ld symbols, s = %d\n", N, s );
+
+	// rice_encode_block()
+	Start = CLOCK::now();
+	for( Runs=0; ( Runs == 0 ) || ( Elapsed( Start ) < MIN_TIME ); Runs++ ) {
+		bitio_init( &Buffer[0], 1, &bio );
+		for( i=0; i<N; i+=BLOCK ) rice_encode_block( &Symbols[i], s, ( N - i < BLOCK ) ? N - i : BLOCK, &bio );
+		Bytes = bitio_term( &bio );
+	}
+	Report( "rice_encode_block", Bytes, Runs, Elapsed( Start ) );
+
+	// rice_decode_block()
+	Start = CLOCK::now();
+	for( Runs=0; ( Runs == 0 ) || ( Elapsed( Start ) < MIN_TIME ); Runs++ ) {
+		bitio_init( &Buffer[0], 0, &bio );
+		bitio_set_size( Bytes, &bio );
+		for( i=0; i<N; i+=BLOCK ) rice_decode_block( &Decoded[i], s, ( N - i < BLOCK ) ? N - i : BLOCK, &bio );
+		bitio_term( &bio );
+	}
+	Time = Elapsed( Start );
+	Report( "rice_decode_block", Bytes, Runs, Time );
+	if ( Decoded != Symbols ) {
+		printf( "rice_decode_block    : decoded symbols differ\n" );
+		Errors++;
+	}
+
+	// put_bits()
+	Start = CLOCK::now();
+	for( Runs=0; ( Runs == 0 ) || ( Elapsed( Start ) < MIN_TIME ); Runs++ ) {
+		bitio_init( &Buffer[0], 1, &bio );
+		for( i=0; i<N; i++ ) put_bits( Vectors[i], BITS, &bio );
+		Bytes = bitio_term( &bio );
+	}
+	Report( "put_bits", Bytes, Runs, Elapsed( Start ) );
+
+	// get_bits()
+	Start = CLOCK::now();
+	for( Runs=0; ( Runs == 0 ) || ( Elapsed( Start ) < MIN_TIME ); Runs++ ) {
+		bitio_init( &Buffer[0], 0, &bio );
+		bitio_set_size( Bytes, &bio );
+		for( i=0, b=0; i<N; i++ ) b += ( get_bits( BITS, &bio ) != Vectors[i] );
+		bitio_term( &bio );
+	}
+	Report( "get_bits", Bytes, Runs, Elapsed( Start ) );
+	if ( b ) {
+		printf( "get_bits             : %ld vectors differ\n", b );
+		Errors++;
+	}
+
+	return Errors ? 1 : 0;
+}
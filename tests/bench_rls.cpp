@@ -0,0 +1,134 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : bench_rls.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 18, 2026
+contents : Per-sample cost of the RLS stage of the RLS-LMS mode
+
+*************************************************************************/
+
+/*************************************************************************
+ * Measures the cost per sample of the RLS stage (gen_rls_predictor() and
+ * UpdateRLSFilter()) for the RLS orders of the mode tables and the
+ * joint-stereo maximum, on a synthetic 16-bit signal with lambda = 0.999.
+ * The stage is fed with the DPCM residual, as in predict(). The result
+ * is given in CPU cycles (rdtsc) on x86, in nanoseconds elsewhere. Build
+ * with optimization (e.g. CMAKE_BUILD_TYPE=Release) for meaningful
+ * numbers.
+ *
+ * lms.cpp is included here, because the RLS functions are not exported
+ * by lms.h.
+ *
+ * Usage: bench_rls [samples]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "lms.cpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define	TICKS()		( (double)__rdtsc() )
+#define	TICK_UNIT	"cycles"
+#else
+#define	TICKS()		( std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now().time_since_epoch() ).count() )
+#define	TICK_UNIT	"ns"
+#endif
+
+#define	SAMPLES		44100		// Default number of samples (one second)
+#define	WARMUP		1000		// Samples before the measurement starts
+#define	LAMBDA		999			// Forgetting factor (normal frames, see the mode tables)
+
+// Synthetic 16-bit signal: a few modulated sines plus noise
+static	void	MakeSignal( std::vector<int>& x )
+{
+	unsigned int	Seed = 1;
+
+	for( size_t i=0; i<x.size(); i++ ) {
+		Seed = Seed * 1103515245 + 12345;
+		double	Noise = (double)( ( Seed >> 8 ) & 0xffff ) / 65536.0 - 0.5;
+		double	v = 0.5 * sin( i * 0.031 ) * ( 0.6 + 0.4 * sin( i * 0.0007 ) ) + 0.25 * sin( i * 0.117 ) + 0.1 * sin( i * 0.59 ) + 0.02 * Noise;
+		x[i] = (int)floor( v * 32767.0 + 0.5 );
+	}
+}
+
+// Run the RLS stage of order M over x, returns the ticks per sample (excluding the warm-up)
+static	double	RunRls( const std::vector<int>& x, short M, INT64* pChecksum )
+{
+	std::vector<BUF_TYPE>	buf( 2 * JS_LEN );
+	std::vector<W_TYPE>		w( JS_LEN );
+	std::vector<P_TYPE>		P( JS_LEN * JS_LEN );
+	short	pos = 0;
+	int		prev = 0, y, temp;
+	double	Start = 0;
+	INT64	Sum = 0;
+
+	reinit_P( &P[0], M );
+	for( size_t i=0; i<x.size(); i++ ) {
+		if ( i == WARMUP ) Start = TICKS();
+		temp = ( x[i] << 4 ) - ( prev << 4 );
+		prev = x[i];
+		y = gen_rls_predictor( &buf[pos], &w[0], M );
+		UpdateRLSFilter( &temp, y, &w[0], M, &buf[0], &pos, &P[0], LAMBDA, 0 );
+		Sum += temp;
+	}
+
+	*pChecksum = Sum;
+	return ( TICKS() - Start ) / (double)( x.size() - WARMUP );
+}
+
+int		main( int argc, char* argv[] )
+{
+	static	const short	Orders[] = { 8, 12, 16, 20, JS_LEN1 };
+	long	N = ( argc > 1 ) ? atol( argv[1] ) : SAMPLES;
+	INT64	Checksum;
+
+	if ( N < 1 ) {
+		fprintf( stderr, "Usage: %s [samples]\n", argv[0] );
+		return 2;
+	}
+
+	std::vector<int>	x( N + WARMUP );
+	MakeSignal( x );
+
+	printf( "%ld samples, lambda = 0.%d\n", N, LAMBDA );
+	for( size_t o=0; o<sizeof(Orders)/sizeof(Orders[0]); o++ ) {
+		double	Ticks = RunRls( x, Orders[o], &Checksum );
+		printf( "RLS order %2d : %8.0f %s/sample  (residual sum %lld)\n", Orders[o], Ticks, TICK_UNIT, (long long)Checksum );
+	}
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : lms_kernels.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 18, 2026
+contents : Exactness test for the SIMD NLMS kernels of lms.cpp
+
+*************************************************************************/
+
+/*************************************************************************
+ * The SIMD NLMS kernels must give exactly the same weights and filter
+ * output as the scalar code. Each kernel that the CPU supports is
+ * compared with the original two-pass NLMS update (weight update, then
+ * the filter output of the next sample with gen_predictor()) for all
+ * filter lengths of the mode tables and beyond, misaligned data and
+ * extreme values.
+ *
+ * lms.cpp is included here, because the kernels are static functions.
+ *
+ * Usage: lms_kernels [seed]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "lms.cpp"
+
+#define	MAX_LEN		1100	// Longest filter (the mode tables use up to 1024)
+#define	PAD			8		// Extra elements for misaligned data
+
+static	unsigned int	Seed = 1;
+
+// Random 32-bit value
+static	unsigned int	Rand32()
+{
+	Seed = Seed * 1103515245 + 12345;
+	unsigned int	Hi = Seed >> 16;
+	Seed = Seed * 1103515245 + 12345;
+	return ( Hi << 16 ) | ( Seed >> 16 );
+}
+
+// Random value in -2^Bits..2^Bits-1 (Bits < 32), with extreme values now and then
+static	int		RandInt( int Bits )
+{
+	unsigned int	r = Rand32();
+	if ( Bits >= 32 ) return (int)r;
+	switch( r & 15 ) {
+	case 0:	return -( 1 << Bits );
+	case 1:	return ( 1 << Bits ) - 1;
+	default: return (int)( Rand32() & ( ( 2u << Bits ) - 1 ) ) - ( 1 << Bits );
+	}
+}
+
+// Original NLMS update: weight update, then the filter output of the next sample
+static	INT64	RefUpdate( const BUF_TYPE* hist, W_TYPE* w, long M, INT64 fact )
+{
+	INT64	y = 0;
+
+	for( long j=0; j<M; j++ ) w[j] = w[j] + (int)( ( (INT64)hist[j] * fact + 0x8000 ) >> 16 );
+	for( long j=0; j<M; j++ ) y += (INT64)w[j] * hist[j+1];
+	return y;
+}
+
+// Compare an NLMS kernel with the reference
+static	int		TestKernel( const char* pName, LMSUPDATEPROC Update )
+{
+	std::vector<BUF_TYPE>	hist( MAX_LEN + 1 + PAD );
+	std::vector<W_TYPE>		w( MAX_LEN + PAD ), wRef( MAX_LEN + PAD );
+	int		Errors = 0;
+
+	for( long M=0; M<=MAX_LEN; M++ ) {
+		for( int k=0; k<8; k++ ) {
+			// Step factors over the full 32-bit range with short history (or vice versa),
+			// small enough that neither the weights nor the 64-bit sum can overflow
+			long	Ofs = Rand32() % PAD;
+			int		hBits = ( k & 1 ) ? 20 : 15;
+			INT64	fact = RandInt( ( k & 1 ) ? 25 : 32 );
+			for( long j=0; j<M+1+PAD; j++ ) hist[j] = RandInt( hBits );
+			for( long j=0; j<M+PAD; j++ ) w[j] = wRef[j] = RandInt( 29 );
+
+			INT64	y = Update( &hist[Ofs], &w[PAD-Ofs], M, fact );
+			INT64	yRef = RefUpdate( &hist[Ofs], &wRef[PAD-Ofs], M, fact );
+			if ( ( y != yRef ) || ( w != wRef ) ) Errors++;
+		}
+	}
+
+	printf( "%-8s kernel : %s\n", pName, Errors ? "FAILED" : "Ok!" );
+	return Errors;
+}
+
+int		main( int argc, char* argv[] )
+{
+	int		Errors = 0;
+
+	if ( argc > 1 ) Seed = (unsigned int)atoi( argv[1] );
+
+	Errors += TestKernel( "scalar", LmsUpdateScalar );
+#ifdef	LMS_SIMD
+	if ( CpuFeatures() & CPU_SSE41 ) Errors += TestKernel( "SSE4.1", LmsUpdateSSE41 );
+	else printf( "SSE4.1   kernel : not supported by this CPU\n" );
+	if ( CpuFeatures() & CPU_AVX2 ) Errors += TestKernel( "AVX2", LmsUpdateAVX2 );
+	else printf( "AVX2     kernel : not supported by this CPU\n" );
+#endif
+
+	return Errors ? 1 : 0;
+}
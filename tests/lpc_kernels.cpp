@@ -0,0 +1,219 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : lpc_kernels.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 18, 2026
+contents : Exactness test for the SIMD prediction filter kernels of lpc.cpp
+
+*************************************************************************/
+
+/*************************************************************************
+ * The SIMD kernels must give exactly the same results as the scalar
+ * code. Each kernel that the CPU supports is compared with a plain
+ * 64-bit dot product for all orders, misaligned data and extreme values.
+ * GetResidual() and GetResidualRA() (with the kernel selected for this
+ * CPU) are compared with the original scalar filters, and GetSignal()
+ * and GetSignalRA() must restore the input signal.
+ *
+ * lpc.cpp is included here, because the kernels are static functions.
+ *
+ * Usage: lpc_kernels [seed]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "lpc.cpp"
+
+#define	MAX_ORDER	1023
+#define	MAX_N		4096
+#define	PAD			8		// Extra samples for misaligned data
+
+static	unsigned int	Seed = 1;
+
+// Random 32-bit value
+static	unsigned int	Rand32()
+{
+	Seed = Seed * 1103515245 + 12345;
+	unsigned int	Hi = Seed >> 16;
+	Seed = Seed * 1103515245 + 12345;
+	return ( Hi << 16 ) | ( Seed >> 16 );
+}
+
+// Random value in -2^Bits..2^Bits-1 (Bits < 32), with extreme values now and then
+static	int		RandInt( int Bits )
+{
+	unsigned int	r = Rand32();
+	if ( Bits >= 32 ) return (int)r;
+	switch( r & 15 ) {
+	case 0:	return -( 1 << Bits );
+	case 1:	return ( 1 << Bits ) - 1;
+	default: return (int)( Rand32() & ( ( 2u << Bits ) - 1 ) ) - ( 1 << Bits );
+	}
+}
+
+// Reference dot product
+static	INT64	RefDot( const int* c, const int* x, long P )
+{
+	INT64	y = 0;
+	for( long i=0; i<P; i++ ) y += (INT64)c[i] * x[i];
+	return y;
+}
+
+// Original scalar prediction residual
+static	void	RefResidual( const int* x, long N, short P, short Q, const int* cof, int* d )
+{
+	INT64	korr = 1 << ( Q - 1 );
+	for( long n=0; n<N; n++ ) {
+		INT64	y = korr;
+		for( long i=1; i<=P; i++ ) y += (INT64)cof[i-1] * x[n-i];
+		d[n] = x[n] + (int)( y >> Q );
+	}
+}
+
+// Original scalar prediction residual for random access blocks
+static	short	RefResidualRA( const int* x, long N, short P, short Q, const int* par, int* cof, int* d )
+{
+	INT64	korr = 1 << ( Q - 1 ), y, temp, temp2;
+	long	n, i, m;
+
+	if ( N < P ) P = (short)N;
+	par--;
+	cof--;
+
+	for( n=0; n<N; n++ ) {
+		y = korr;
+		for( i=1; i<=( ( n < P ) ? n : P ); i++ ) y += (INT64)cof[i] * x[n-i];
+		d[n] = x[n] + (int)( y >> Q );
+		if ( n >= P ) continue;
+
+		m = n + 1;
+		for( i=1; i<=m/2; i++ ) {
+			temp = cof[i] + ( ( ( (INT64)par[m] * cof[m-i] ) + korr ) >> Q );
+			if ( ( temp > INT_MAX ) || ( temp < INT_MIN ) ) return 1;
+			temp2 = cof[m-i] + ( ( ( (INT64)par[m] * cof[i] ) + korr ) >> Q );
+			if ( ( temp2 > INT_MAX ) || ( temp2 < INT_MIN ) ) return 1;
+			cof[m-i] = (int)temp2;
+			cof[i] = (int)temp;
+		}
+		cof[m] = par[m];
+	}
+	return 0;
+}
+
+// Compare a dot product kernel with the reference
+static	int		TestKernel( const char* pName, DOTPROC Dot )
+{
+	std::vector<int>	c( MAX_ORDER + PAD ), x( MAX_ORDER + PAD );
+	int		Errors = 0;
+
+	for( long P=0; P<=MAX_ORDER; P++ ) {
+		for( int k=0; k<8; k++ ) {
+			// One operand over the full 32-bit range, the other one small enough for an exact 64-bit sum
+			long	Ofs = Rand32() % PAD;
+			int		cBits = ( k & 1 ) ? 32 : 20;
+			int		xBits = ( k & 1 ) ? 20 : 32;
+			for( long i=0; i<P+PAD; i++ ) {
+				c[i] = RandInt( cBits );
+				x[i] = RandInt( xBits );
+			}
+			if ( Dot( &c[0], &x[Ofs], P ) != RefDot( &c[0], &x[Ofs], P ) ) Errors++;
+			if ( Dot( &c[Ofs], &x[0], P ) != RefDot( &c[Ofs], &x[0], P ) ) Errors++;
+		}
+	}
+
+	printf( "%-8s kernel : %s\n", pName, Errors ? "FAILED" : "Ok!" );
+	return Errors;
+}
+
+// Compare the prediction filters with the original scalar code
+static	int		TestFilters()
+{
+	static	const short	Orders[] = { 1, 2, 3, 7, 8, 9, 10, 15, 16, 17, 20, 31, 32, 33, 63, 100, 255, 1023 };
+	std::vector<int>	x( MAX_ORDER + MAX_N ), y( MAX_ORDER + MAX_N ), d( MAX_N ), dRef( MAX_N );
+	std::vector<int>	cof( MAX_ORDER ), par( MAX_ORDER ), cofRA( MAX_ORDER ), cofRef( MAX_ORDER );
+	int		Errors = 0, Tests = 0;
+
+	for( size_t o=0; o<sizeof(Orders)/sizeof(Orders[0]); o++ ) {
+		for( int k=0; k<20; k++ ) {
+			short	P = Orders[o];
+			short	Q = 20;
+			long	N = ( k < 4 ) ? ( k + 1 ) * P / 2 + 1 : 1 + (long)( Rand32() % MAX_N );
+			int*	px = &x[MAX_ORDER];
+			int*	py = &y[MAX_ORDER];
+			int		Bits = ( k & 1 ) ? 23 : 15;
+
+			for( long i=0; i<MAX_ORDER+N; i++ ) x[i] = y[i] = RandInt( Bits );
+			for( long i=0; i<P; i++ ) {
+				cof[i] = RandInt( 20 - ( P > 32 ) * 6 );
+				par[i] = RandInt( 19 ) / ( ( i > 20 ) ? 64 : 1 );
+			}
+
+			// Normal blocks
+			RefResidual( px, N, P, Q, &cof[0], &dRef[0] );
+			GetResidual( px, N, P, Q, &cof[0], &d[0] );
+			for( long i=0; i<MAX_ORDER+N; i++ ) y[i] = ( i < MAX_ORDER ) ? x[i] : 0;
+			GetSignal( py, N, P, Q, &cof[0], &d[0] );
+			if ( ( d != dRef ) || ( y != x ) ) Errors++;
+
+			// Random access blocks
+			short	Ret = RefResidualRA( px, N, P, Q, &par[0], &cofRef[0], &dRef[0] );
+			if ( Ret == 0 ) {
+				if ( ( GetResidualRA( px, N, P, Q, &par[0], &cofRA[0], &d[0] ) != 0 ) || ( d != dRef ) ) Errors++;
+				for( long i=0; i<N; i++ ) py[i] = 0;
+				if ( ( GetSignalRA( py, N, P, Q, &par[0], &cofRA[0], &d[0] ) != 0 ) || ( y != x ) ) Errors++;
+			} else {
+				if ( GetResidualRA( px, N, P, Q, &par[0], &cofRA[0], &d[0] ) == 0 ) Errors++;
+			}
+			Tests++;
+			for( long i=0; i<N; i++ ) dRef[i] = d[i] = 0;
+		}
+	}
+
+	printf( "filters         : %d blocks %s\n", Tests, Errors ? "FAILED" : "Ok!" );
+	return Errors;
+}
+
+int		main( int argc, char* argv[] )
+{
+	int		Errors = 0;
+
+	if ( argc > 1 ) Seed = (unsigned int)atoi( argv[1] );
+
+	Errors += TestKernel( "scalar", DotScalar );
+#ifdef	LPC_SIMD
+	if ( CpuFeatures() & CPU_SSE41 ) Errors += TestKernel( "SSE4.1", DotSSE41 );
+	else printf( "SSE4.1   kernel : not supported by this CPU\n" );
+	if ( CpuFeatures() & CPU_AVX2 ) Errors += TestKernel( "AVX2", DotAVX2 );
+	else printf( "AVX2     kernel : not supported by this CPU\n" );
+#endif
+	Errors += TestFilters();
+
+	return Errors ? 1 : 0;
+}
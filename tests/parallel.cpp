@@ -0,0 +1,262 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was developed by
+
+the mp4als contributors
+
+as an extension of the reference software for the MPEG-4 Audio standard
+ISO/IEC 14496-3 and associated amendments. This software module is an
+implementation of a part of one or more MPEG-4 Audio lossless coding
+tools as specified by the MPEG-4 Audio standard. ISO/IEC gives users of
+the MPEG-4 Audio standards free license to this software module or
+modifications thereof for use in hardware or software products claiming
+conformance to the MPEG-4 Audio standards. Those intending to use this
+software module in hardware or software products are advised that this
+use may infringe existing patents. The original developer of this
+software module, the subsequent editors and their companies, and ISO/IEC
+have no liability for use of this software module or modifications
+thereof in an implementation. Copyright is not released for non MPEG-4
+Audio conforming products. The original developer retains full right to
+use the code for the developer's own purpose, assign or donate the code
+to a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2026.
+
+filename : parallel.cpp
+project  : MPEG-4 Audio Lossless Coding
+author   : mp4als contributors
+date     : October 18, 2026
+contents : Stress test for encoders and decoders running in parallel threads
+
+*************************************************************************/
+
+/*************************************************************************
+ * Every test case is first encoded and decoded once in the main thread.
+ * Then THREADS threads encode and decode the same PCM data at the same
+ * time, each with its own contexts, and the ALS streams and the decoded
+ * PCM data must be identical to the serial results. Any shared state in
+ * the codec (static tables, buffers, CRC or filter state) shows up as a
+ * mismatch or a crash here.
+ *
+ * Usage: parallel [threads [rounds]]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+#include "libmp4als.h"
+
+#define	THREADS		8		// Default number of parallel threads
+#define	ROUNDS		1		// Default number of parallel rounds
+#define	PUSH_SIZE	10000	// Bytes per push (not a multiple of the frame size)
+
+typedef	std::vector<unsigned char>	BYTES;
+
+// Test case
+struct TESTCASE {
+	const char*	pName;
+	long		Channels;
+	long		SampleRate;
+	short		BitsPerSample;
+	short		FloatSamples;
+	long		Samples;
+	short		Order;
+	short		Adapt;
+	short		RandomAccess;
+	short		BGMC;
+	short		BlockSwitching;
+	long		MCC;
+	short		RLSLMS;
+	short		PITCH;
+	short		Threads;
+};
+
+static	const TESTCASE	TestCases[] = {
+//	  Name                 Ch  Rate   Bits Flt Samples  -o  -a  -r  -b  -g  -t  -z  -p  -j
+	{ "stereo 16-bit",      2, 44100, 16,  0,  44100,   10, 0,  0,  0,  0,  0,  0,  0,  1 },
+	{ "adaptive, RA, BGMC", 2, 48000, 16,  0,  24000,   20, 1,  5,  1,  3,  0,  0,  1,  1 },
+	{ "5.1 24-bit, MCC",    6, 48000, 24,  0,  12000,   10, 1,  0,  0,  2,  6,  0,  0,  2 },
+	{ "mono 8-bit",         1, 22050,  8,  0,  44100,   10, 1, 10,  1,  1,  0,  0,  0,  1 },
+	{ "stereo float",       2, 44100, 32,  1,  22050,   10, 0,  0,  0,  0,  0,  0,  0,  1 },
+	{ "stereo RLS-LMS",     2, 44100, 16,  0,  11025,   10, 0,  0,  0,  0,  0,  1,  0,  1 },
+	{ "stereo 384 kHz",     2,384000, 24,  0,  38400,   10, 1,  0,  0,  0,  0,  0,  0,  1 },
+};
+
+// Serial results of one test case
+struct REFERENCE {
+	BYTES	Pcm;
+	BYTES	Als;
+};
+
+// Deterministic test signal: a few sines per channel plus noise
+static	void	MakePcm( const TESTCASE& Case, BYTES& Pcm )
+{
+	long	Bytes = Case.BitsPerSample / 8;
+	double	Peak = Case.FloatSamples ? 1.0 : ldexp( 0.4, Case.BitsPerSample - 1 );
+	unsigned int	Seed = 12345;
+
+	Pcm.resize( (size_t)Case.Samples * Case.Channels * Bytes );
+	unsigned char*	p = &Pcm[0];
+
+	for( long i=0; i<Case.Samples; i++ ) {
+		for( long c=0; c<Case.Channels; c++ ) {
+			Seed = Seed * 1103515245 + 12345;
+			double	Noise = (double)( ( Seed >> 8 ) & 0xffff ) / 65536.0 - 0.5;
+			double	x = 0.6 * sin( i * ( 0.01 + 0.003 * c ) ) + 0.3 * sin( i * 0.173 + c ) + 0.02 * Noise;
+			if ( Case.FloatSamples ) {
+				float			f = (float)( x * Peak );
+				unsigned int	u;
+				memcpy( &u, &f, 4 );
+				for( long b=0; b<4; b++ ) *p++ = (unsigned char)( u >> ( b * 8 ) );
+			} else {
+				long	v = (long)floor( x * Peak + 0.5 );
+				if ( Case.BitsPerSample == 8 ) v += 128;
+				for( long b=0; b<Bytes; b++ ) *p++ = (unsigned char)( v >> ( b * 8 ) );
+			}
+		}
+	}
+}
+
+// Encode the PCM data (returns MP4ALS_OK or an error code)
+static	int		Encode( const TESTCASE& Case, const BYTES& Pcm, BYTES& Als )
+{
+	MP4ALS_ENCODER_OPTIONS	Options;
+	MP4ALS_ENCODER*			pEncoder;
+	const void*				pData;
+	unsigned long			Size;
+	size_t					Pos, Chunk;
+	int						Ret;
+
+	mp4als_encoder_default_options( &Options );
+	Options.Audio.Channels = Case.Channels;
+	Options.Audio.SampleRate = Case.SampleRate;
+	Options.Audio.BitsPerSample = Case.BitsPerSample;
+	Options.Audio.FloatSamples = Case.FloatSamples;
+	Options.Order = Case.Order;
+	Options.Adapt = Case.Adapt;
+	Options.RandomAccess = Case.RandomAccess;
+	Options.BGMC = Case.BGMC;
+	Options.BlockSwitching = Case.BlockSwitching;
+	Options.MCC = Case.MCC;
+	Options.RLSLMS = Case.RLSLMS;
+	Options.PITCH = Case.PITCH;
+	Options.Threads = Case.Threads;
+
+	Ret = mp4als_encoder_create( &Options, &pEncoder );
+	if ( Ret != MP4ALS_OK ) return Ret;
+
+	Als.clear();
+	for( Pos=0; ( Ret == MP4ALS_OK ) && ( Pos < Pcm.size() ); Pos += Chunk ) {
+		Chunk = ( Pcm.size() - Pos < PUSH_SIZE ) ? Pcm.size() - Pos : PUSH_SIZE;
+		Ret = mp4als_encoder_push( pEncoder, &Pcm[Pos], (unsigned long)Chunk );
+		while( ( Ret == MP4ALS_OK ) && ( ( Ret = mp4als_encoder_pull( pEncoder, &pData, &Size ) ) == MP4ALS_OK ) )
+			Als.insert( Als.end(), (const unsigned char*)pData, (const unsigned char*)pData + Size );
+		if ( Ret == MP4ALS_NEED_MORE ) Ret = MP4ALS_OK;
+	}
+
+	if ( Ret == MP4ALS_OK ) Ret = mp4als_encoder_finish( pEncoder );
+	while( ( Ret == MP4ALS_OK ) && ( ( Ret = mp4als_encoder_pull( pEncoder, &pData, &Size ) ) == MP4ALS_OK ) )
+		Als.insert( Als.end(), (const unsigned char*)pData, (const unsigned char*)pData + Size );
+	if ( Ret == MP4ALS_END ) Ret = MP4ALS_OK;
+
+	// The header is final only now, and it precedes the frames
+	if ( Ret == MP4ALS_OK ) Ret = mp4als_encoder_header( pEncoder, &pData, &Size );
+	if ( Ret == MP4ALS_OK ) Als.insert( Als.begin(), (const unsigned char*)pData, (const unsigned char*)pData + Size );
+
+	mp4als_encoder_destroy( pEncoder );
+	return Ret;
+}
+
+// Decode the ALS stream (returns MP4ALS_OK or an error code)
+static	int		Decode( const BYTES& Als, BYTES& Pcm )
+{
+	MP4ALS_DECODER*	pDecoder;
+	const void*		pData;
+	unsigned long	Size;
+	size_t			Pos, Chunk;
+	int				Ret;
+
+	Ret = mp4als_decoder_create( &pDecoder );
+	if ( Ret != MP4ALS_OK ) return Ret;
+
+	Pcm.clear();
+	for( Pos=0; ( Ret == MP4ALS_OK ) && ( Pos < Als.size() ); Pos += Chunk ) {
+		Chunk = ( Als.size() - Pos < PUSH_SIZE ) ? Als.size() - Pos : PUSH_SIZE;
+		Ret = mp4als_decoder_push( pDecoder, &Als[Pos], (unsigned long)Chunk );
+		while( ( Ret == MP4ALS_OK ) && ( ( Ret = mp4als_decoder_pull( pDecoder, &pData, &Size ) ) == MP4ALS_OK ) )
+			Pcm.insert( Pcm.end(), (const unsigned char*)pData, (const unsigned char*)pData + Size );
+		if ( Ret == MP4ALS_NEED_MORE ) Ret = MP4ALS_OK;
+	}
+
+	if ( Ret == MP4ALS_OK ) Ret = mp4als_decoder_finish( pDecoder );
+	while( ( Ret == MP4ALS_OK ) && ( ( Ret = mp4als_decoder_pull( pDecoder, &pData, &Size ) ) == MP4ALS_OK ) )
+		Pcm.insert( Pcm.end(), (const unsigned char*)pData, (const unsigned char*)pData + Size );
+	if ( Ret == MP4ALS_END ) Ret = MP4ALS_OK;
+
+	mp4als_decoder_destroy( pDecoder );
+	return Ret;
+}
+
+// Encode and decode all test cases, compare with the serial results
+static	void	Worker( const std::vector<REFERENCE>* pRefs, int Rounds, int* pErrors )
+{
+	BYTES	Als, Pcm;
+
+	*pErrors = 0;
+	for( int r=0; r<Rounds; r++ ) {
+		for( size_t i=0; i<pRefs->size(); i++ ) {
+			const REFERENCE&	Ref = (*pRefs)[i];
+			if ( ( Encode( TestCases[i], Ref.Pcm, Als ) != MP4ALS_OK ) || ( Als != Ref.Als ) ) (*pErrors)++;
+			else if ( ( Decode( Als, Pcm ) != MP4ALS_OK ) || ( Pcm != Ref.Pcm ) ) (*pErrors)++;
+		}
+	}
+}
+
+int		main( int argc, char* argv[] )
+{
+	int		Threads = ( argc > 1 ) ? atoi( argv[1] ) : THREADS;
+	int		Rounds = ( argc > 2 ) ? atoi( argv[2] ) : ROUNDS;
+	size_t	Cases = sizeof(TestCases) / sizeof(TestCases[0]);
+	int		Failed = 0;
+	BYTES	Pcm;
+	std::vector<REFERENCE>	Refs( Cases );
+
+	if ( ( Threads < 1 ) || ( Rounds < 1 ) ) {
+		fprintf( stderr, "Usage: %s [threads [rounds]]\n", argv[0] );
+		return 2;
+	}
+
+	// Serial reference results (which must also be lossless)
+	for( size_t i=0; i<Cases; i++ ) {
+		MakePcm( TestCases[i], Refs[i].Pcm );
+		int	Ret = Encode( TestCases[i], Refs[i].Pcm, Refs[i].Als );
+		if ( Ret == MP4ALS_OK ) Ret = Decode( Refs[i].Als, Pcm );
+		if ( ( Ret != MP4ALS_OK ) || ( Pcm != Refs[i].Pcm ) ) {
+			printf( "%-20s : serial run failed (%d)\n", TestCases[i].pName, Ret );
+			Failed++;
+		} else {
+			printf( "%-20s : %lu -> %lu bytes\n", TestCases[i].pName, (unsigned long)Refs[i].Pcm.size(), (unsigned long)Refs[i].Als.size() );
+		}
+	}
+	if ( Failed ) return 1;
+
+	// Same work in parallel threads
+	std::vector<std::thread>	Pool;
+	std::vector<int>			Errors( Threads );
+
+	for( int t=0; t<Threads; t++ ) Pool.push_back( std::thread( Worker, &Refs, Rounds, &Errors[t] ) );
+	for( int t=0; t<Threads; t++ ) {
+		Pool[t].join();
+		if ( Errors[t] ) printf( "Thread %d : %d mismatches\n", t, Errors[t] );
+		Failed += Errors[t];
+	}
+
+	printf( "%d threads x %d rounds x %lu cases : %s\n", Threads, Rounds, (unsigned long)Cases, Failed ? "FAILED" : "Ok!" );
+	return Failed ? 1 : 0;
+}